@@ -0,0 +1,79 @@
+/*
+ * AssetLoader.h - loads samples and other assets in the background
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QString>
+
+#include <functional>
+
+#include "lmms_export.h"
+
+
+/// \brief Runs expensive loading jobs, like decoding samples, on a thread
+/// pool
+///
+/// The job runs on a pool thread and must not touch anything used for
+/// rendering. Once it is finished, the completion callback runs in the
+/// thread of the given context object, usually the GUI thread, where the
+/// loaded data can be swapped in, e.g. inside Mixer::requestChangeInModel().
+/// The callback is dropped if the context object got deleted meanwhile.
+class LMMS_EXPORT AssetLoader
+{
+public:
+	typedef std::function<void()> Job;
+
+	/// Run \p job in the background and \p done in the thread of
+	/// \p context afterwards. The time the job took is reported through
+	/// PerfLog under \p name.
+	static void load( const QString & name, const Job & job,
+					QObject * context, const Job & done );
+
+	/// Wait for all jobs and run their pending callbacks, if called from
+	/// the thread of their context objects
+	static void waitForDone();
+
+} ;
+
+
+class AssetLoadJob : public QObject, public QRunnable
+{
+	Q_OBJECT
+public:
+	AssetLoadJob( const QString & name, const AssetLoader::Job & job );
+
+	void run() override;
+
+signals:
+	void finished();
+
+private:
+	QString m_name;
+	AssetLoader::Job m_job;
+
+} ;
+
+
+#endif
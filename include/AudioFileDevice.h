@@ -47,6 +47,11 @@ public:
 
 	OutputSettings const & getOutputSettings() const { return m_outputSettings; }
 
+	// encode a buffer rendered at the mixer's processing sample rate which
+	// did not come from the mixer's output (e.g. a single audio port)
+	void writeProcessedBuffer( const surroundSampleFrame * _ab,
+							const fpp_t _frames );
+
 
 protected:
 	int writeData( const void* data, int len );
@@ -64,6 +69,8 @@ protected:
 private:
 	QFile m_outputFile;
 	OutputSettings m_outputSettings;
+
+	surroundSampleFrame * m_resampleBuffer;
 } ;
 
 
@@ -25,6 +25,7 @@
 #ifndef AUDIO_PORT_H
 #define AUDIO_PORT_H
 
+#include <atomic>
 #include <memory>
 #include <QtCore/QString>
 #include <QtCore/QMutex>
@@ -34,6 +35,8 @@
 #include "PlayHandle.h"
 
 class EffectChain;
+class FxChannel;
+class StemWriter;
 class FloatModel;
 class BoolModel;
 
@@ -83,10 +86,7 @@ public:
 		return m_effects.get();
 	}
 
-	void setNextFxChannel( const fx_ch_t _chnl )
-	{
-		m_nextFxChannel = _chnl;
-	}
+	void setNextFxChannel( const fx_ch_t _chnl );
 
 
 	const QString & name() const
@@ -99,6 +99,10 @@ public:
 
 	bool processEffects();
 
+	// delay of the port's output in frames, from the latency of the play
+	// handles feeding it and of its effects
+	f_cnt_t latency();
+
 	// ThreadableJob stuff
 	void doProcessing() override;
 	bool requiresProcessing() const override
@@ -109,7 +113,20 @@ public:
 	void addPlayHandle( PlayHandle * handle );
 	void removePlayHandle( PlayHandle * handle );
 
+	// render graph stuff: the port gets queued as soon as all play
+	// handles feeding it have been processed
+	void incrementDeps();
+
+	// additionally hand the port's output to the given writer, used for
+	// rendering all tracks in a single pass
+	void setStemWriter( StemWriter * writer )
+	{
+		m_stemWriter = writer;
+	}
+
 private:
+	void processed();
+
 	volatile bool m_bufferUsage;
 
 	sampleFrame * m_portBuffer;
@@ -129,6 +146,14 @@ private:
 	FloatModel * m_panningModel;
 	BoolModel * m_mutedModel;
 
+	// number of play handles to wait for in current period
+	int m_dependencies;
+	std::atomic_int m_dependenciesMet;
+	// FX channel this port feeds, set up when the render graph is built
+	FxChannel * m_graphFxChannel;
+
+	StemWriter * m_stemWriter;
+
 	friend class Mixer;
 	friend class MixerWorkerThread;
 
@@ -25,6 +25,8 @@
 #ifndef AUTOMATABLE_MODEL_H
 #define AUTOMATABLE_MODEL_H
 
+#include <atomic>
+
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 
@@ -199,6 +201,10 @@ public:
 	void setInitValue( const float value );
 
 	void setAutomatedValue( const float value );
+	//! Set the automated value at the given frame of the current period and
+	//! let valueBuffer() ramp towards nextValue over the following frames
+	void setAutomatedValue( const float value, const float nextValue,
+				const f_cnt_t frameOffset, const f_cnt_t rampFrames );
 	void setValue( const float value );
 
 	void incValue( int steps )
@@ -298,6 +304,13 @@ public:
 		s_periodCounter = 0;
 	}
 
+	//! Number of models destroyed so far, to tell whether pointers to
+	//! models kept from an earlier period may still be used
+	static unsigned int destroyedCount()
+	{
+		return s_destroyedCount.load();
+	}
+
 public slots:
 	virtual void reset();
 	void unlinkControllerConnection();
@@ -389,6 +402,31 @@ private:
 	ValueBuffer m_valueBuffer;
 	long m_lastUpdatedPeriod;
 	static long s_periodCounter;
+	static std::atomic<unsigned int> s_destroyedCount;
+
+	// linear ramps between the automated values of consecutive ticks,
+	// rendered into m_valueBuffer for sample-exact automation
+	struct AutomationRamp
+	{
+		qint64 start; // in frames, counted like s_periodCounter
+		f_cnt_t length;
+		float from;
+		float to;
+	} ;
+	// ring of at most one ramp per tick of the current period plus the
+	// ones still running from before, so the audio thread doesn't allocate
+	static const int MaxAutomationRamps = 16;
+	AutomationRamp m_automationRamps[MaxAutomationRamps];
+	int m_firstAutomationRamp;
+	int m_automationRampCount;
+	AutomationRamp & automationRamp( int i )
+	{
+		return m_automationRamps[( m_firstAutomationRamp + i ) %
+							MaxAutomationRamps];
+	}
+	//! Append a ramp, dropping the oldest one if the ring is full
+	void pushAutomationRamp( const AutomationRamp & ramp );
+	bool renderAutomationRamps();
 
 	bool m_hasSampleExactData;
 
@@ -28,8 +28,11 @@
 #define AUTOMATION_PATTERN_H
 
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 #include <QtCore/QPointer>
 
+#include <atomic>
+
 #include "Track.h"
 
 
@@ -171,7 +174,22 @@ private:
 	void cleanObjects();
 	void generateTangents();
 	void generateTangents( timeMap::const_iterator it, int numToGenerate );
-	float valueAt( timeMap::const_iterator v, int offset ) const;
+
+	// The curve between two points, compiled into the coefficients of a
+	// cubic polynomial in t = ( time - start ) / length, t in [0, 1]
+	struct Segment
+	{
+		int start;
+		float length;
+		float a, b, c, d;
+	} ;
+	void compileSegments() const;
+	// to be called after changing the curve; valueAt() might compile it
+	// during the change, so flagging it before would lose the change
+	void markDirty()
+	{
+		m_segmentsDirty = true;
+	}
 
 	AutomationTrack * m_autoTrack;
 	QVector<jo_id_t> m_idsToResolve;
@@ -183,6 +201,12 @@ private:
 	bool m_hasAutomation;
 	ProgressionTypes m_progressionType;
 
+	// flat copy of the curve for fast lookups in valueAt(), rebuilt on
+	// first use after any change
+	mutable QVector<Segment> m_segments;
+	mutable std::atomic_bool m_segmentsDirty;
+	mutable QMutex m_segmentsMutex;
+
 	bool m_dragging;
 	
 	bool m_isRecording;
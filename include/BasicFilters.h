@@ -36,6 +36,7 @@
 #define __USE_XOPEN
 #endif
 
+#include <array>
 #include <math.h>
 
 #include "lmms_basics.h"
@@ -249,6 +250,10 @@ public:
 		NumFilters
 	};
 
+	// frames between checking whether the coefficients need an update in
+	// process()
+	static const fpp_t CoeffInterval = 8;
+
 	static inline float minFreq()
 	{
 		return( 5.0f );
@@ -283,6 +288,8 @@ public:
 	}
 
 	inline BasicFilters( const sample_rate_t _sample_rate ) :
+		m_cut( 0.0f ),
+		m_res( 0.0f ),
 		m_doubleFilter( false ),
 		m_sampleRate( (float) _sample_rate ),
 		m_sampleRatio( 1.0f / m_sampleRate ),
@@ -329,8 +336,235 @@ public:
 
 	inline sample_t update( sample_t _in0, ch_cnt_t _chnl )
 	{
-		sample_t out;
 		switch( m_type )
+		{
+			case Moog: return updateFilter<Moog>( _in0, _chnl );
+			case Tripole: return updateFilter<Tripole>( _in0, _chnl );
+			case Lowpass_SV: return updateFilter<Lowpass_SV>( _in0, _chnl );
+			case Bandpass_SV: return updateFilter<Bandpass_SV>( _in0, _chnl );
+			case Highpass_SV: return updateFilter<Highpass_SV>( _in0, _chnl );
+			case Notch_SV: return updateFilter<Notch_SV>( _in0, _chnl );
+			case Lowpass_RC12: return updateFilter<Lowpass_RC12>( _in0, _chnl );
+			case Bandpass_RC12: return updateFilter<Bandpass_RC12>( _in0, _chnl );
+			case Highpass_RC12: return updateFilter<Highpass_RC12>( _in0, _chnl );
+			case Lowpass_RC24: return updateFilter<Lowpass_RC24>( _in0, _chnl );
+			case Bandpass_RC24: return updateFilter<Bandpass_RC24>( _in0, _chnl );
+			case Highpass_RC24: return updateFilter<Highpass_RC24>( _in0, _chnl );
+			case Formantfilter: return updateFilter<Formantfilter>( _in0, _chnl );
+			case FastFormant: return updateFilter<FastFormant>( _in0, _chnl );
+			// biquads
+			default: return updateFilter<LowPass>( _in0, _chnl );
+		}
+	}
+
+	// filter a block of frames in place, picking the code for the filter
+	// type once instead of per sample. cutBuf and resBuf hold the cutoff
+	// and resonance of each frame, either may be NULL to keep the value
+	// passed to calcFilterCoeffs() last. The coefficients are only updated
+	// every CoeffInterval frames, if the cutoff changed by at least 1 Hz or
+	// the resonance by 0.001.
+	inline void process( std::array<sample_t, CHANNELS> * buffer, fpp_t frames,
+				const float * cutBuf = NULL, const float * resBuf = NULL )
+	{
+		switch( m_type )
+		{
+			case Moog: processBlock<Moog>( buffer, frames, cutBuf, resBuf ); break;
+			case Tripole: processBlock<Tripole>( buffer, frames, cutBuf, resBuf ); break;
+			case Lowpass_SV: processBlock<Lowpass_SV>( buffer, frames, cutBuf, resBuf ); break;
+			case Bandpass_SV: processBlock<Bandpass_SV>( buffer, frames, cutBuf, resBuf ); break;
+			case Highpass_SV: processBlock<Highpass_SV>( buffer, frames, cutBuf, resBuf ); break;
+			case Notch_SV: processBlock<Notch_SV>( buffer, frames, cutBuf, resBuf ); break;
+			case Lowpass_RC12: processBlock<Lowpass_RC12>( buffer, frames, cutBuf, resBuf ); break;
+			case Bandpass_RC12: processBlock<Bandpass_RC12>( buffer, frames, cutBuf, resBuf ); break;
+			case Highpass_RC12: processBlock<Highpass_RC12>( buffer, frames, cutBuf, resBuf ); break;
+			case Lowpass_RC24: processBlock<Lowpass_RC24>( buffer, frames, cutBuf, resBuf ); break;
+			case Bandpass_RC24: processBlock<Bandpass_RC24>( buffer, frames, cutBuf, resBuf ); break;
+			case Highpass_RC24: processBlock<Highpass_RC24>( buffer, frames, cutBuf, resBuf ); break;
+			case Formantfilter: processBlock<Formantfilter>( buffer, frames, cutBuf, resBuf ); break;
+			case FastFormant: processBlock<FastFormant>( buffer, frames, cutBuf, resBuf ); break;
+			// biquads
+			default: processBlock<LowPass>( buffer, frames, cutBuf, resBuf ); break;
+		}
+	}
+
+
+	inline void calcFilterCoeffs( float _freq, float _q )
+	{
+		m_cut = _freq;
+		m_res = _q;
+
+		// temp coef vars
+		_q = qMax( _q, minQ() );
+
+		if( m_type == Lowpass_RC12  ||
+			m_type == Bandpass_RC12 ||
+			m_type == Highpass_RC12 ||
+			m_type == Lowpass_RC24 ||
+			m_type == Bandpass_RC24 ||
+			m_type == Highpass_RC24 )
+		{
+			_freq = qBound( 50.0f, _freq, 20000.0f );
+			const float sr = m_sampleRatio * 0.25f;
+			const float f = 1.0f / ( _freq * F_2PI );
+			
+			m_rca = 1.0f - sr / ( f + sr );
+			m_rcb = 1.0f - m_rca;
+			m_rcc = f / ( f + sr );
+
+			// Stretch Q/resonance, as self-oscillation reliably starts at a q of ~2.5 - ~2.6
+			m_rcq = _q * 0.25f;
+			return;
+		}
+
+		if( m_type == Formantfilter ||
+			m_type == FastFormant )
+		{
+			_freq = qBound( minFreq(), _freq, 20000.0f ); // limit freq and q for not getting bad noise out of the filter...
+
+			// formats for a, e, i, o, u, a
+			static const float _f[6][2] = { { 1000, 1400 }, { 500, 2300 },
+							{ 320, 3200 },
+							{ 500, 1000 },
+							{ 320, 800 },
+							{ 1000, 1400 } };
+			static const float freqRatio = 4.0f / 14000.0f;
+
+			// Stretch Q/resonance
+			m_vfq = _q * 0.25f;
+
+			// frequency in lmms ranges from 1Hz to 14000Hz
+			const float vowelf = _freq * freqRatio;
+			const int vowel = static_cast<int>( vowelf );
+			const float fract = vowelf - vowel;
+
+			// interpolate between formant frequencies
+			const float f0 = 1.0f / ( linearInterpolate( _f[vowel+0][0], _f[vowel+1][0], fract ) * F_2PI );
+			const float f1 = 1.0f / ( linearInterpolate( _f[vowel+0][1], _f[vowel+1][1], fract ) * F_2PI );
+
+			// samplerate coeff: depends on oversampling
+			const float sr = m_type == FastFormant ? m_sampleRatio : m_sampleRatio * 0.25f;
+
+			m_vfa[0] = 1.0f - sr / ( f0 + sr );
+			m_vfb[0] = 1.0f - m_vfa[0];
+			m_vfc[0] = f0 /	( f0 + sr );
+			m_vfa[1] = 1.0f - sr / ( f1 + sr );
+			m_vfb[1] = 1.0f - m_vfa[1];
+			m_vfc[1] = f1 /	( f1 + sr );
+			return;
+		}
+
+		if( m_type == Moog ||
+			m_type == DoubleMoog )
+		{
+			// [ 0 - 0.5 ]
+			const float f = qBound( minFreq(), _freq, 20000.0f ) * m_sampleRatio;
+			// (Empirical tunning)
+			m_p = ( 3.6f - 3.2f * f ) * f;
+			m_k = 2.0f * m_p - 1;
+			m_r = _q * powf( F_E, ( 1 - m_p ) * 1.386249f );
+
+			if( m_doubleFilter )
+			{
+				m_subFilter->m_r = m_r;
+				m_subFilter->m_p = m_p;
+				m_subFilter->m_k = m_k;
+			}
+			return;
+		}
+		
+		if( m_type == Tripole )
+		{
+			const float f = qBound( 20.0f, _freq, 20000.0f ) * m_sampleRatio * 0.25f;
+			
+			m_p = ( 3.6f - 3.2f * f ) * f;
+			m_k = 2.0f * m_p - 1.0f;
+			m_r = _q * 0.1f * powf( F_E, ( 1 - m_p ) * 1.386249f );
+			
+			return;
+		}
+
+		if( m_type == Lowpass_SV || 
+			m_type == Bandpass_SV ||
+			m_type == Highpass_SV ||
+			m_type == Notch_SV )
+		{
+			const float f = sinf( qMax( minFreq(), _freq ) * m_sampleRatio * F_PI );
+			m_svf1 = qMin( f, 0.825f );
+			m_svf2 = qMin( f * 2.0f, 0.825f );
+			m_svq = qMax( 0.0001f, 2.0f - ( _q * 0.1995f ) );
+			return;
+		}
+
+		// other filters
+		_freq = qBound( minFreq(), _freq, 20000.0f );
+		const float omega = F_2PI * _freq * m_sampleRatio;
+		const float tsin = sinf( omega ) * 0.5f;
+		const float tcos = cosf( omega );
+
+		const float alpha = tsin / _q;
+
+		const float a0 = 1.0f / ( 1.0f + alpha );
+
+		const float a1 = -2.0f * tcos * a0;
+		const float a2 = ( 1.0f - alpha ) * a0;
+
+		switch( m_type )
+		{
+			case LowPass:
+			{
+				const float b1 = ( 1.0f - tcos ) * a0;
+				const float b0 = b1 * 0.5f;
+				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
+				break;
+			}
+			case HiPass:
+			{
+				const float b1 = ( -1.0f - tcos ) * a0;
+				const float b0 = b1 * -0.5f;
+				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
+				break;
+			}
+			case BandPass_CSG:
+			{
+				const float b0 = tsin * a0;
+				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
+				break;
+			}
+			case BandPass_CZPG:
+			{
+				const float b0 = alpha * a0;
+				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
+				break;
+			}
+			case Notch:
+			{
+				m_biQuad.setCoeffs( a1, a2, a0, a1, a0 );
+				break;
+			}
+			case AllPass:
+			{
+				m_biQuad.setCoeffs( a1, a2, a2, a1, 1.0f );
+				break;
+			}
+			default:
+				break;
+		}
+
+		if( m_doubleFilter )
+		{
+			m_subFilter->m_biQuad.setCoeffs( m_biQuad.m_a1, m_biQuad.m_a2, m_biQuad.m_b0, m_biQuad.m_b1, m_biQuad.m_b2 );
+		}
+	}
+
+
+private:
+	// one sample of the filter type TYPE, so that the compiler drops the
+	// code of the other types
+	template<FilterTypes TYPE>
+	inline sample_t updateFilter( sample_t _in0, ch_cnt_t _chnl )
+	{
+		sample_t out;
+		switch( TYPE )
 		{
 			case Moog:
 			{
@@ -419,7 +653,7 @@ public:
 				}
 
 				/* mix filter output into output buffer */
-				return m_type == Lowpass_SV 
+				return TYPE == Lowpass_SV 
 					? m_delay4[_chnl]
 					: m_delay3[_chnl];
 			}
@@ -506,7 +740,7 @@ public:
 					m_rchp0[_chnl] = hp;
 					m_rcbp0[_chnl] = bp;
 				}
-				return m_type == Highpass_RC12 ? hp : bp;
+				return TYPE == Highpass_RC12 ? hp : bp;
 			}
 
 			case Lowpass_RC24:
@@ -573,7 +807,7 @@ public:
 					m_rcbp0[_chnl] = bp;
 
 					// second stage gets the output of the first stage as input...
-					in = m_type == Highpass_RC24
+					in = TYPE == Highpass_RC24
 						? hp + m_rcbp1[_chnl] * m_rcq
 						: bp + m_rcbp1[_chnl] * m_rcq;
 
@@ -589,7 +823,7 @@ public:
 					m_rchp1[_chnl] = hp;
 					m_rcbp1[_chnl] = bp;
 				}
-				return m_type == Highpass_RC24 ? hp : bp;
+				return TYPE == Highpass_RC24 ? hp : bp;
 			}
 
 			case Formantfilter:
@@ -599,7 +833,7 @@ public:
 				sample_t hp, bp, in;
 
 				out = 0;
-				const int os = m_type == FastFormant ? 1 : 4; // no oversampling for fast formant
+				const int os = TYPE == FastFormant ? 1 : 4; // no oversampling for fast formant
 				for( int o = 0; o < os; ++o )
 				{
 					// first formant
@@ -686,7 +920,7 @@ public:
 
 					out += bp;
 				}
-            	return m_type == FastFormant ? out * 2.0f : out * 0.5f;
+            	return TYPE == FastFormant ? out * 2.0f : out * 0.5f;
 			}
 
 			default:
@@ -696,184 +930,51 @@ public:
 
 		if( m_doubleFilter )
 		{
-			return m_subFilter->update( out, _chnl );
+			return m_subFilter->template updateFilter<TYPE>( out, _chnl );
 		}
 
 		// Clipper band limited sigmoid
 		return out;
 	}
 
-
-	inline void calcFilterCoeffs( float _freq, float _q )
+	template<FilterTypes TYPE>
+	void processBlock( std::array<sample_t, CHANNELS> * buffer, fpp_t frames,
+					const float * cutBuf, const float * resBuf )
 	{
-		// temp coef vars
-		_q = qMax( _q, minQ() );
-
-		if( m_type == Lowpass_RC12  ||
-			m_type == Bandpass_RC12 ||
-			m_type == Highpass_RC12 ||
-			m_type == Lowpass_RC24 ||
-			m_type == Bandpass_RC24 ||
-			m_type == Highpass_RC24 )
-		{
-			_freq = qBound( 50.0f, _freq, 20000.0f );
-			const float sr = m_sampleRatio * 0.25f;
-			const float f = 1.0f / ( _freq * F_2PI );
-			
-			m_rca = 1.0f - sr / ( f + sr );
-			m_rcb = 1.0f - m_rca;
-			m_rcc = f / ( f + sr );
-
-			// Stretch Q/resonance, as self-oscillation reliably starts at a q of ~2.5 - ~2.6
-			m_rcq = _q * 0.25f;
-			return;
-		}
-
-		if( m_type == Formantfilter ||
-			m_type == FastFormant )
+		int oldCut = static_cast<int>( m_cut );
+		int oldRes = static_cast<int>( m_res * 1000.0f );
+		for( fpp_t start = 0; start < frames; start += CoeffInterval )
 		{
-			_freq = qBound( minFreq(), _freq, 20000.0f ); // limit freq and q for not getting bad noise out of the filter...
-
-			// formats for a, e, i, o, u, a
-			static const float _f[6][2] = { { 1000, 1400 }, { 500, 2300 },
-							{ 320, 3200 },
-							{ 500, 1000 },
-							{ 320, 800 },
-							{ 1000, 1400 } };
-			static const float freqRatio = 4.0f / 14000.0f;
-
-			// Stretch Q/resonance
-			m_vfq = _q * 0.25f;
-
-			// frequency in lmms ranges from 1Hz to 14000Hz
-			const float vowelf = _freq * freqRatio;
-			const int vowel = static_cast<int>( vowelf );
-			const float fract = vowelf - vowel;
-
-			// interpolate between formant frequencies
-			const float f0 = 1.0f / ( linearInterpolate( _f[vowel+0][0], _f[vowel+1][0], fract ) * F_2PI );
-			const float f1 = 1.0f / ( linearInterpolate( _f[vowel+0][1], _f[vowel+1][1], fract ) * F_2PI );
-
-			// samplerate coeff: depends on oversampling
-			const float sr = m_type == FastFormant ? m_sampleRatio : m_sampleRatio * 0.25f;
-
-			m_vfa[0] = 1.0f - sr / ( f0 + sr );
-			m_vfb[0] = 1.0f - m_vfa[0];
-			m_vfc[0] = f0 /	( f0 + sr );
-			m_vfa[1] = 1.0f - sr / ( f1 + sr );
-			m_vfb[1] = 1.0f - m_vfa[1];
-			m_vfc[1] = f1 /	( f1 + sr );
-			return;
-		}
-
-		if( m_type == Moog ||
-			m_type == DoubleMoog )
-		{
-			// [ 0 - 0.5 ]
-			const float f = qBound( minFreq(), _freq, 20000.0f ) * m_sampleRatio;
-			// (Empirical tunning)
-			m_p = ( 3.6f - 3.2f * f ) * f;
-			m_k = 2.0f * m_p - 1;
-			m_r = _q * powf( F_E, ( 1 - m_p ) * 1.386249f );
-
-			if( m_doubleFilter )
+			if( cutBuf || resBuf )
 			{
-				m_subFilter->m_r = m_r;
-				m_subFilter->m_p = m_p;
-				m_subFilter->m_k = m_k;
+				const float cut = cutBuf ? cutBuf[start] : m_cut;
+				const float res = resBuf ? resBuf[start] : m_res;
+				if( static_cast<int>( cut ) != oldCut ||
+					static_cast<int>( res * 1000.0f ) != oldRes )
+				{
+					calcFilterCoeffs( cut, res );
+					oldCut = static_cast<int>( cut );
+					oldRes = static_cast<int>( res * 1000.0f );
+				}
 			}
-			return;
-		}
-		
-		if( m_type == Tripole )
-		{
-			const float f = qBound( 20.0f, _freq, 20000.0f ) * m_sampleRatio * 0.25f;
-			
-			m_p = ( 3.6f - 3.2f * f ) * f;
-			m_k = 2.0f * m_p - 1.0f;
-			m_r = _q * 0.1f * powf( F_E, ( 1 - m_p ) * 1.386249f );
-			
-			return;
-		}
 
-		if( m_type == Lowpass_SV || 
-			m_type == Bandpass_SV ||
-			m_type == Highpass_SV ||
-			m_type == Notch_SV )
-		{
-			const float f = sinf( qMax( minFreq(), _freq ) * m_sampleRatio * F_PI );
-			m_svf1 = qMin( f, 0.825f );
-			m_svf2 = qMin( f * 2.0f, 0.825f );
-			m_svq = qMax( 0.0001f, 2.0f - ( _q * 0.1995f ) );
-			return;
-		}
-
-		// other filters
-		_freq = qBound( minFreq(), _freq, 20000.0f );
-		const float omega = F_2PI * _freq * m_sampleRatio;
-		const float tsin = sinf( omega ) * 0.5f;
-		const float tcos = cosf( omega );
-
-		const float alpha = tsin / _q;
-
-		const float a0 = 1.0f / ( 1.0f + alpha );
-
-		const float a1 = -2.0f * tcos * a0;
-		const float a2 = ( 1.0f - alpha ) * a0;
-
-		switch( m_type )
-		{
-			case LowPass:
-			{
-				const float b1 = ( 1.0f - tcos ) * a0;
-				const float b0 = b1 * 0.5f;
-				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
-				break;
-			}
-			case HiPass:
-			{
-				const float b1 = ( -1.0f - tcos ) * a0;
-				const float b0 = b1 * -0.5f;
-				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
-				break;
-			}
-			case BandPass_CSG:
+			const fpp_t end = qMin<fpp_t>( start + CoeffInterval, frames );
+			for( fpp_t f = start; f < end; ++f )
 			{
-				const float b0 = tsin * a0;
-				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
-				break;
-			}
-			case BandPass_CZPG:
-			{
-				const float b0 = alpha * a0;
-				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
-				break;
-			}
-			case Notch:
-			{
-				m_biQuad.setCoeffs( a1, a2, a0, a1, a0 );
-				break;
-			}
-			case AllPass:
-			{
-				m_biQuad.setCoeffs( a1, a2, a2, a1, 1.0f );
-				break;
+				for( ch_cnt_t ch = 0; ch < CHANNELS; ++ch )
+				{
+					buffer[f][ch] = updateFilter<TYPE>( buffer[f][ch], ch );
+				}
 			}
-			default:
-				break;
-		}
-
-		if( m_doubleFilter )
-		{
-			m_subFilter->m_biQuad.setCoeffs( m_biQuad.m_a1, m_biQuad.m_a2, m_biQuad.m_b0, m_biQuad.m_b1, m_biQuad.m_b2 );
 		}
 	}
 
-
-private:
 	// biquad filter
 	BiQuad<CHANNELS> m_biQuad;
 
+	// arguments of the last calcFilterCoeffs() call
+	float m_cut, m_res;
+
 	// coeffs for moog-filter
 	float m_r, m_p, m_k;
 
@@ -0,0 +1,105 @@
+/*
+ * BinaryProjectFile.h - binary container for LMMS projects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BINARY_PROJECT_FILE_H
+#define BINARY_PROJECT_FILE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QDomDocument>
+
+#include "lmms_export.h"
+
+
+//! Binary form of a DataFile (*.mmpb). The file starts with a table of
+//! typed sections, followed by their contents:
+//!  - the document section holds the DOM tree with element and attribute
+//!    names stored once and referenced by index afterwards
+//!  - each blob section holds the raw bytes of one large base64 encoded
+//!    attribute, such as embedded samples or plugin chunks
+//! Sections may be zlib compressed, blobs only where that makes them
+//! smaller. section() reads and uncompresses a single section, but read()
+//! has to decode all of them and encode the blobs as base64 again, as
+//! the DOM and everything loading from it expects the attributes as text.
+//! Converting from and to XML is lossless, apart from comments.
+class LMMS_EXPORT BinaryProjectFile
+{
+public:
+	enum SectionTypes
+	{
+		DocumentSection = 1,
+		BlobSection = 2
+	} ;
+
+	//! Sections are read from @p data on demand, which may be created with
+	//! QByteArray::fromRawData() for a mapped file
+	explicit BinaryProjectFile( const QByteArray & data );
+
+	static bool isBinary( const QByteArray & data );
+
+	//! Serialize @p doc, compressing the document section if requested
+	static QByteArray write( const QDomDocument & doc, bool compress = true );
+
+	//! False if the section table is damaged
+	bool isValid() const
+	{
+		return m_valid;
+	}
+
+	int sectionCount() const
+	{
+		return m_sections.size();
+	}
+
+	SectionTypes sectionType( int index ) const
+	{
+		return m_sections[index].type;
+	}
+
+	//! The uncompressed contents of a section, empty on errors
+	QByteArray section( int index ) const;
+
+	//! Rebuild the document, turning blobs back into base64 attributes
+	bool read( QDomDocument & doc ) const;
+
+
+private:
+	struct Section
+	{
+		SectionTypes type;
+		quint32 flags;
+		quint64 offset;
+		quint64 size;
+		quint64 rawSize;
+	} ;
+
+	QByteArray m_data;
+	//! Like section(), but referencing m_data where possible
+	QByteArray contents( int index ) const;
+
+	QVector<Section> m_sections;
+	bool m_valid;
+
+} ;
+
+
+#endif
@@ -95,6 +95,7 @@ private:
 	static QString typeName( Type type );
 
 	void cleanMetaNodes( QDomElement de );
+	void cleanForWriting();
 
 	// helper upgrade routines
 	void upgrade_0_2_1_20070501();
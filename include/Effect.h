@@ -59,6 +59,13 @@ public:
 	virtual bool processAudioBuffer( sampleFrame * _buf,
 						const fpp_t _frames ) = 0;
 
+	// number of frames the effect delays its output by, for effects that
+	// don't process in place, e.g. remote plugins processing concurrently
+	virtual f_cnt_t latency() const
+	{
+		return 0;
+	}
+
 	inline ch_cnt_t processorCount() const
 	{
 		return m_processors;
@@ -26,6 +26,8 @@
 #ifndef EFFECT_CHAIN_H
 #define EFFECT_CHAIN_H
 
+#include <atomic>
+
 #include "Model.h"
 #include "SerializingObject.h"
 #include "AutomatableModel.h"
@@ -55,12 +57,23 @@ public:
 	bool processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, bool hasInputNoise );
 	void startRunning();
 
+	//! Sum of the latencies of the enabled effects, in frames
+	f_cnt_t latency() const;
+
 	void clear();
 
 
 private:
 	typedef QVector<Effect *> EffectList;
+
+	//! Replace the list processed by the audio threads with a copy of
+	//! m_effects, the old one gets retired
+	void publishEffects();
+
+	// edited by the GUI thread only
 	EffectList m_effects;
+	// immutable snapshot of m_effects processed by the audio threads
+	std::atomic<EffectList *> m_processedEffects;
 
 	BoolModel m_enabledModel;
 
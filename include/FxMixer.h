@@ -40,7 +40,7 @@ typedef QVector<FxRoute *> FxRouteVector;
 class FxChannel : public ThreadableJob
 {
 	public:
-		FxChannel( int idx, Model * _parent );
+		FxChannel( int idx );
 		virtual ~FxChannel();
 
 		EffectChain m_fxChain;
@@ -72,6 +72,10 @@ class FxChannel : public ThreadableJob
 		bool requiresProcessing() const override { return true; }
 		void unmuteForSolo();
 
+		// delay of the channel's output in frames, from the latency of
+		// the audio ports and channels sending to it and of its effects
+		f_cnt_t latency();
+
 
 		void setColor (QColor newColor)
 		{
@@ -84,6 +88,9 @@ class FxChannel : public ThreadableJob
 		bool m_hasColor;
 
 	
+		// number of senders and audio ports feeding this channel,
+		// updated whenever the render graph is rebuilt
+		int m_dependencies;
 		std::atomic_int m_dependenciesMet;
 		void incrementDeps();
 		void processed();
@@ -144,6 +151,9 @@ public:
 	void mixToChannel( const sampleFrame * _buf, fx_ch_t _ch );
 
 	void prepareMasterMix();
+	// determine muted channels and queue all channels without inputs
+	void startMasterMix();
+	// wait for the render graph to finish and mix master channel into _buf
 	void masterMix( sampleFrame * _buf );
 
 	void saveSettings( QDomDocument & _doc, QDomElement & _parent ) override;
@@ -98,6 +98,14 @@ public:
 		return 0;
 	}
 
+	// number of frames the instrument delays its output by, for
+	// instruments that don't render right away, e.g. remote plugins
+	// processing concurrently
+	virtual f_cnt_t latency() const
+	{
+		return 0;
+	}
+
 	virtual Flags flags() const
 	{
 		return NoFlags;
@@ -75,6 +75,11 @@ public:
 		return m_instrument->isFromTrack( _track );
 	}
 
+	f_cnt_t latency() const override
+	{
+		return m_instrument->latency();
+	}
+
 
 private:
 	Instrument* m_instrument;
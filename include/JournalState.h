@@ -0,0 +1,92 @@
+/*
+ * JournalState.h - compact form of journalled states and their deltas
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef JOURNAL_STATE_H
+#define JOURNAL_STATE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QDomElement>
+
+#include "lmms_export.h"
+
+
+//! The saved state of a journalling object in binary form: one record per
+//! DOM node in document order, holding its depth, name, attributes or text.
+//! As e.g. every note of a pattern is a record of its own, the difference
+//! between two states usually consists of a few records only.
+class LMMS_EXPORT JournalState
+{
+public:
+	//! Changes turning one state into another
+	class Delta
+	{
+	public:
+		size_t memoryUsage() const;
+
+	private:
+		struct Edit
+		{
+			int pos;
+			int removed;
+			QVector<QByteArray> inserted;
+		} ;
+		QVector<Edit> m_edits;
+
+		friend class JournalState;
+	} ;
+
+	JournalState() = default;
+	explicit JournalState( const QDomElement & element );
+
+	bool isEmpty() const
+	{
+		return m_records.isEmpty();
+	}
+
+	//! Recreate the element and append it to @p parent
+	QDomElement toElement( QDomDocument & doc, QDomNode & parent ) const;
+
+	//! Approximate heap memory used by this state
+	size_t memoryUsage() const;
+
+	bool operator==( const JournalState & other ) const
+	{
+		return m_records == other.m_records;
+	}
+
+	//! Compute the changes turning @p from into @p to
+	static Delta diff( const JournalState & from, const JournalState & to );
+
+	//! Apply changes which were computed with this state as @p from
+	void apply( const Delta & delta );
+
+
+private:
+	void addNode( const QDomNode & node, int depth );
+
+	QVector<QByteArray> m_records;
+
+} ;
+
+
+#endif
@@ -36,6 +36,7 @@
 #include <QtCore/QStringList>
 
 
+#include "LadspaPluginCache.h"
 #include "lmms_export.h"
 #include "lmms_basics.h"
 
@@ -48,9 +49,11 @@ typedef QList<sortable_plugin_t> l_sortable_plugin_t;
 typedef QList<ladspa_key_t> l_ladspa_key_t;
 
 /* ladspaManager provides a database of LADSPA plug-ins.  Upon instantiation,
-it loads all of the plug-ins found in the LADSPA_PATH environmental variable
-and stores their access descriptors according in a dictionary keyed on
-the filename the plug-in was loaded from and the label of the plug-in.
+it finds all of the plug-ins in the LADSPA_PATH environmental variable
+and stores their descriptions in a dictionary keyed on the filename the
+plug-in was found in and the label of the plug-in.  The descriptions come
+from LadspaPluginCache, so a library is only loaded at startup if it is new
+or changed, and otherwise once one of its plug-ins is used.
 
 The can be retrieved by using ladspa_key_t.  For example, to get the
 "Phase Modulated Voice" plug-in from the cmt library, you would perform the
@@ -72,11 +75,20 @@ enum ladspaPluginType
 
 typedef struct ladspaManagerStorage
 {
+	// NULL until the library has been loaded
 	LADSPA_Descriptor_Function descriptorFunction;
 	uint32_t index;
 	ladspaPluginType type;
 	uint16_t inputChannels;
 	uint16_t outputChannels;
+	// the absolute path of the library
+	QString file;
+	bool loadFailed;
+	QString label;
+	QString name;
+	QString maker;
+	QString copyright;
+	LADSPA_Properties properties;
 } ladspaManagerDescription;
 
 
@@ -329,8 +341,13 @@ public:
 						LADSPA_Handle _instance );
 
 private:
-	void  addPlugins( LADSPA_Descriptor_Function _descriptor_func,
-						const QString & _file );
+	QVector<LadspaPluginCache::Plugin>  describePlugins(
+				LADSPA_Descriptor_Function _descriptor_func );
+	void  addPlugins( const QVector<LadspaPluginCache::Plugin> & _plugins,
+				const QFileInfo & _file,
+				LADSPA_Descriptor_Function _descriptor_func );
+	// load the library of the plug-in if that hasn't happened yet
+	bool  loadPlugin( ladspaManagerDescription * _plugin );
 	uint16_t  getPluginInputs( const LADSPA_Descriptor * _descriptor );
 	uint16_t  getPluginOutputs( const LADSPA_Descriptor * _descriptor );
 
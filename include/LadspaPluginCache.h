@@ -0,0 +1,91 @@
+/*
+ * LadspaPluginCache.h - persistent index of the plugins in LADSPA libraries
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef LADSPA_PLUGIN_CACHE_H
+#define LADSPA_PLUGIN_CACHE_H
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+
+
+//! What LadspaManager needs to know about the plugins of each LADSPA
+//! library before one of them is used.
+//!
+//! Entries are keyed by the absolute path of the library and only valid as
+//! long as its size and modification time haven't changed, so libraries
+//! only have to be loaded at startup if they are new or were updated.
+//! Libraries without plugins are kept as well, so they aren't tried again.
+class LMMS_EXPORT LadspaPluginCache
+{
+public:
+	struct Plugin
+	{
+		QString label;
+		quint32 index;
+		QString name;
+		QString maker;
+		QString copyright;
+		//! LADSPA_Properties of the descriptor
+		qint32 properties;
+		quint16 inputChannels;
+		quint16 outputChannels;
+	} ;
+
+	//! The index saved at @p path, an empty one if there is none yet
+	LadspaPluginCache( const QString & path );
+
+	//! The cache file in the user's cache directory
+	static QString defaultPath();
+
+	//! The plugins of @p file, false if it isn't indexed or changed since
+	bool lookup( const QFileInfo & file, QVector<Plugin> & plugins );
+	void insert( const QFileInfo & file, const QVector<Plugin> & plugins );
+
+	//! Write the index if anything changed. Libraries which weren't looked
+	//! up or inserted since loading are dropped, as they were removed.
+	bool save();
+
+
+private:
+	struct Entry
+	{
+		qint64 size;
+		qint64 modified;
+		QVector<Plugin> plugins;
+	} ;
+
+	static bool matches( const Entry & entry, const QFileInfo & file );
+
+	QString m_path;
+	QHash<QString, Entry> m_entries;
+	QSet<QString> m_used;
+	bool m_modified;
+
+} ;
+
+
+#endif
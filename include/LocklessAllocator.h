@@ -33,9 +33,15 @@ class LocklessAllocator
 public:
 	LocklessAllocator( size_t nmemb, size_t size );
 	virtual ~LocklessAllocator();
+	// NULL if all elements are in use
 	void * alloc();
 	void free( void * ptr );
 
+	bool contains( const void * ptr ) const
+	{
+		return ptr >= m_pool && ptr < m_pool + m_capacity * m_elementSize;
+	}
+
 
 private:
 	char * m_pool;
@@ -76,6 +82,11 @@ public:
 		LocklessAllocator::free( ptr );
 	}
 
+	bool contains( const T * ptr ) const
+	{
+		return LocklessAllocator::contains( ptr );
+	}
+
 } ;
 
 
@@ -0,0 +1,107 @@
+/*
+ * MidiEventQueue.h - timestamped queue of incoming MIDI events
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef MIDI_EVENT_QUEUE_H
+#define MIDI_EVENT_QUEUE_H
+
+#include <chrono>
+
+#include "LocklessList.h"
+#include "MidiEvent.h"
+#include "MidiTime.h"
+
+
+//! Collects MIDI events from any number of input threads without locking,
+//! stamped with their time of arrival, until the mixer takes them at the
+//! start of a period.
+class MidiEventQueue
+{
+public:
+	struct TimedEvent
+	{
+		MidiEvent event;
+		MidiTime time;
+		//! Arrival in nanoseconds, see now()
+		qint64 arrival;
+	} ;
+
+	MidiEventQueue( size_t capacity ) :
+		m_events( capacity )
+	{
+	}
+
+	~MidiEventQueue()
+	{
+		drain( []( const TimedEvent & ) {} );
+	}
+
+	//! Monotonic time in nanoseconds
+	static qint64 now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	//! Queue @p event, stamped with the current time. Returns false and
+	//! drops the event if the queue is full.
+	bool push( const MidiEvent & event, const MidiTime & time )
+	{
+		TimedEvent e;
+		e.event = event;
+		e.time = time;
+		e.arrival = now();
+		return m_events.push( e );
+	}
+
+	//! Remove all queued events, passing them to @p process in the order
+	//! they arrived in
+	template<class Processor>
+	void drain( Processor process )
+	{
+		// the list is newest first
+		typename LocklessList<TimedEvent>::Element * e = m_events.popList();
+		typename LocklessList<TimedEvent>::Element * oldest = nullptr;
+		while( e )
+		{
+			typename LocklessList<TimedEvent>::Element * next = e->next;
+			e->next = oldest;
+			oldest = e;
+			e = next;
+		}
+
+		while( oldest )
+		{
+			typename LocklessList<TimedEvent>::Element * next = oldest->next;
+			process( oldest->value );
+			m_events.free( oldest );
+			oldest = next;
+		}
+	}
+
+
+private:
+	LocklessList<TimedEvent> m_events;
+
+} ;
+
+
+#endif
@@ -30,7 +30,10 @@
 #include <QtCore/QList>
 #include <QtCore/QMap>
 
+#include <atomic>
+
 #include "Midi.h"
+#include "MidiEventQueue.h"
 #include "MidiTime.h"
 #include "AutomatableModel.h"
 
@@ -102,7 +105,12 @@ public:
 		return outputChannel() ? outputChannel() - 1 : 0;
 	}
 
+	//! Queue an event from the MIDI client, may be called from any thread
 	void processInEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
+	//! Pass the queued events on to the event processor, called by the
+	//! mixer at the start of each period. Returns the number of events
+	//! dropped since the last call because the queue was full.
+	int processQueuedInEvents();
 	void processOutEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
 
 
@@ -164,6 +172,9 @@ private:
 	Map m_readablePorts;
 	Map m_writablePorts;
 
+	MidiEventQueue m_inEvents;
+	std::atomic_int m_droppedInEvents;
+
 
 	friend class ControllerConnectionDialog;
 	friend class InstrumentMidiIOView;
@@ -39,6 +39,9 @@ void setNaNHandler( bool use );
 
 bool sanitize( sampleFrame * src, int frames );
 
+/*! \brief Get the highest absolute sample value of each channel in src */
+void getPeakValues( const sampleFrame* src, int frames, sample_t& peakLeft, sample_t& peakRight );
+
 /*! \brief Add samples from src to dst */
 void add( sampleFrame* dst, const sampleFrame* src, int frames );
 
@@ -73,6 +76,9 @@ void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float c
 /*! \brief Multiply dst by coeffDst and add samples from srcLeft/srcRight multiplied by coeffSrc */
 void multiplyAndAddMultipliedJoined( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames );
 
+/*! \brief Apply volume and panning in percent to dst, taking per-frame values from volumeBuf/panningBuf unless they are NULL */
+void multiplyByVolumePanning( sampleFrame* dst, const sample_t* volumeBuf, float volume, const sample_t* panningBuf, float panning, int frames );
+
 }
 
 #endif
@@ -31,21 +31,27 @@
 #include <QtCore/QWaitCondition>
 #include <samplerate.h>
 
+#include <atomic>
+
 
 #include "lmms_basics.h"
 #include "LocklessList.h"
 #include "Note.h"
-#include "fifo_buffer.h"
 #include "MixerProfiler.h"
+#include "PeriodFifo.h"
 
 
 class AudioDevice;
 class MidiClient;
+class MidiPort;
 class AudioPort;
+class SampleBuffer;
 
 
 const fpp_t MINIMUM_BUFFER_SIZE = 32;
 const fpp_t DEFAULT_BUFFER_SIZE = 256;
+// frames per period when rendering in offline mode
+const fpp_t OFFLINE_BUFFER_SIZE = 4096;
 
 const int BYTES_PER_SAMPLE = sizeof( sample_t );
 const int BYTES_PER_INT_SAMPLE = sizeof( int_sample_t );
@@ -188,15 +194,13 @@ public:
 
 
 	// audio-port-stuff
-	inline void addAudioPort( AudioPort * _port )
-	{
-		requestChangeInModel();
-		m_audioPorts.push_back( _port );
-		doneChangeInModel();
-	}
-
+	void addAudioPort( AudioPort * _port );
+	//! Returns once no period renders the port anymore, so it can be
+	//! deleted afterwards
 	void removeAudioPort( AudioPort * _port );
 
+	QVector<AudioPort *> audioPorts() const;
+
 
 	// MIDI-client-stuff
 	inline const QString & midiClientName() const
@@ -209,6 +213,15 @@ public:
 		return m_midiClient;
 	}
 
+	//! Ports whose queued input events are processed at the start of
+	//! each period
+	void addMidiInputPort( MidiPort * port );
+	void removeMidiInputPort( MidiPort * port );
+
+	//! Frame offset in the current period to play a MIDI input event at,
+	//! given its arrival time from MidiEventQueue::now()
+	f_cnt_t midiInputOffset( qint64 arrival );
+
 
 	// play-handle stuff
 	bool addPlayHandle( PlayHandle* handle );
@@ -293,6 +306,13 @@ public:
 		return m_fifoWriter != NULL;
 	}
 
+	//! The FIFO between rendering and the audio device, for showing its
+	//! fill level and underruns
+	const PeriodFifo & outputFifo() const
+	{
+		return *m_fifo;
+	}
+
 	void pushInputFrames( sampleFrame * _ab, const f_cnt_t _frames );
 
 	inline const sampleFrame * inputBuffer()
@@ -305,6 +325,7 @@ public:
 		return m_inputBufferFrames[ m_inputBufferRead ];
 	}
 
+	//! The next period to play, valid until the next call
 	inline const surroundSampleFrame * nextBuffer()
 	{
 		return hasFifoWriter() ? m_fifo->read() : renderNextBuffer();
@@ -313,15 +334,57 @@ public:
 	void changeQuality( const struct qualitySettings & _qs );
 
 	inline bool isMetronomeActive() const { return m_metronomeActive; }
-	inline void setMetronomeActive(bool value = true) { m_metronomeActive = value; }
+	//! Loads the metronome samples first, so the audio thread doesn't have
+	//! to touch the files for every click
+	void setMetronomeActive(bool value = true);
 
 	//! Block until a change in model can be done (i.e. wait for audio thread)
 	void requestChangeInModel();
 	void doneChangeInModel();
 
+	//! Rebuild dependencies between audio ports and FX channels before
+	//! rendering the next period
+	void invalidateRenderGraph()
+	{
+		m_renderGraphDirty = true;
+	}
+
+	//! Delete an object the audio threads might still be using once all
+	//! periods which started before are done. Objects are deleted in the
+	//! mixer's thread, so this is for data which got unpublished without
+	//! requestChangeInModel(), e.g. a replaced snapshot. If no period is in
+	//! flight, e.g. inside requestChangeInModel() or once processing
+	//! stopped, the object is deleted right away.
+	template<typename T>
+	void retire( T * object )
+	{
+		retire( object, []( void * p ) { delete static_cast<T *>( p ); } );
+	}
+	void retire( void * object, void ( * deleter )( void * ) );
+
 	static bool isAudioDevNameValid(QString name);
 	static bool isMidiDevNameValid(QString name);
 
+	//! Command line overrides of the mixer configuration. They apply to
+	//! mixers created afterwards and are never saved.
+	struct RunOptions
+	{
+		//! Total number of render threads, 0 for the configured number
+		int threads;
+		//! 1 or 0 to (not) use the work-stealing scheduler, -1 for the
+		//! configured one
+		int workStealing;
+		//! Render with OFFLINE_BUFFER_SIZE frames per period, if only
+		//! rendering
+		bool offline;
+	} ;
+	static void setRunOptions( const RunOptions & options );
+
+
+public slots:
+	//! Delete all retired objects no period can see anymore
+	void reclaimRetired();
+
 
 signals:
 	void qualitySettingsChanged();
@@ -330,7 +393,7 @@ signals:
 
 
 private:
-	typedef fifoBuffer<surroundSampleFrame *> fifo;
+	typedef PeriodFifo fifo;
 
 	class fifoWriter : public QThread
 	{
@@ -347,7 +410,7 @@ private:
 
 		void run() override;
 
-		void write( surroundSampleFrame * buffer );
+		void write( const surroundSampleFrame * buffer );
 
 	} ;
 
@@ -371,9 +434,36 @@ private:
 	//! such that they can do changes in the model (like e.g. removing effects)
 	void runChangesInModel();
 
+	//! Count the inputs of each FX channel, i.e. its senders and the audio
+	//! ports feeding it
+	void buildRenderGraph( const QVector<AudioPort *> & ports );
+
+	void processMidiInput();
+
+	static RunOptions s_runOptions;
+
 	bool m_renderOnly;
 
-	QVector<AudioPort *> m_audioPorts;
+	// immutable list of the audio ports rendered by the audio threads,
+	// replaced as a whole on every change and retired afterwards
+	struct AudioPortList
+	{
+		QVector<AudioPort *> ports;
+		// increased with every change, so the render graph gets rebuilt
+		quint64 version;
+	} ;
+	//! Replace the published list by \p ports, returns the old one
+	AudioPortList * publishAudioPorts( AudioPortList * ports );
+
+	std::atomic<AudioPortList *> m_audioPorts;
+	// the list the current period renders, NULL once its ports are done
+	std::atomic<AudioPortList *> m_renderedAudioPorts;
+	// serializes adding and removing ports
+	mutable QMutex m_audioPortsMutex;
+	quint64 m_renderGraphVersion;
+
+	QVector<MidiPort *> m_midiInputPorts;
+	qint64 m_periodStartTime;
 
 	fpp_t m_framesPerPeriod;
 
@@ -425,11 +515,15 @@ private:
 	MixerProfiler m_profiler;
 
 	bool m_metronomeActive;
+	// first beat of a bar and the other beats
+	SampleBuffer * m_metronomeBar;
+	SampleBuffer * m_metronomeBeat;
 
 	bool m_clearSignal;
 
 	bool m_changesSignal;
 	unsigned int m_changes;
+	std::atomic_bool m_renderGraphDirty;
 	QMutex m_changesMutex;
 	QMutex m_doChangesMutex;
 	QMutex m_waitChangesMutex;
@@ -438,6 +532,19 @@ private:
 
 	bool m_waitingForWrite;
 
+	// grace periods for retired objects: an object retired while
+	// m_periodsStarted was n can be deleted once m_periodsFinished >= n
+	struct RetiredObject
+	{
+		void * object;
+		void ( * deleter )( void * );
+		quint64 period;
+	} ;
+	std::atomic<quint64> m_periodsStarted;
+	std::atomic<quint64> m_periodsFinished;
+	QVector<RetiredObject> m_retired;
+	QMutex m_retiredMutex;
+
 	friend class LmmsCore;
 	friend class MixerWorkerThread;
 	friend class ProjectRenderer;
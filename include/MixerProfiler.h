@@ -50,12 +50,36 @@ public:
 
 	void setOutputFile( const QString& outputFile );
 
+	//! Record the time from the arrival of a MIDI input event until the
+	//! frame it is played at, in nanoseconds
+	void addMidiLatency( qint64 latency );
+
+	//! Log the latency of each MIDI input event in microseconds, and print
+	//! its range when done
+	void setMidiLatencyFile( const QString& outputFile );
+
+	//! Count MIDI input events which were dropped as their port's queue
+	//! was full, printed when done
+	void addDroppedMidiEvents( int count )
+	{
+		m_droppedMidiEvents += count;
+	}
+
 
 private:
+	void printMidiLatency();
+
 	MicroTimer m_periodTimer;
 	int m_cpuLoad;
 	QFile m_outputFile;
 
+	QFile m_midiLatencyFile;
+	int m_midiEvents;
+	qint64 m_minMidiLatency;
+	qint64 m_maxMidiLatency;
+	qint64 m_totalMidiLatency;
+	int m_droppedMidiEvents;
+
 };
 
 #endif
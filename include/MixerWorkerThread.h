@@ -28,6 +28,7 @@
 #include <QtCore/QThread>
 
 #include <atomic>
+#include <vector>
 
 class QWaitCondition;
 class Mixer;
@@ -59,7 +60,7 @@ public:
 
 		void reset( OperationMode _opMode );
 
-		void addJob( ThreadableJob * _job );
+		bool addJob( ThreadableJob * _job );
 
 		void run();
 		void wait();
@@ -72,6 +73,73 @@ public:
 
 	} ;
 
+	// work-stealing alternative to JobQueue: every worker owns a deque it
+	// pushes to and pops from at the back, idle workers steal from the
+	// front of the other deques - all functions are thread-safe
+	class WorkStealingQueue
+	{
+	public:
+		WorkStealingQueue() :
+			m_deques(),
+			m_itemsQueued( 0 ),
+			m_itemsDone( 0 ),
+			m_nextDeque( 0 ),
+			m_opMode( JobQueue::Static )
+		{
+		}
+
+		~WorkStealingQueue();
+
+		void addDeque();
+
+		void reset( JobQueue::OperationMode _opMode );
+
+		bool addJob( ThreadableJob * _job );
+
+		void run( int _worker );
+		void wait();
+
+	private:
+		class Deque
+		{
+		public:
+			Deque();
+
+			void clear();
+			bool push( ThreadableJob * _job );
+			ThreadableJob * pop();
+			ThreadableJob * steal();
+
+		private:
+			void lock();
+			void unlock()
+			{
+				m_lock.clear( std::memory_order_release );
+			}
+
+			std::atomic_flag m_lock;
+			ThreadableJob * m_items[JOB_QUEUE_SIZE];
+			int m_head;
+			int m_tail;
+
+		} ;
+
+		ThreadableJob * nextJob( int _worker );
+
+		std::vector<Deque *> m_deques;
+		std::atomic_int m_itemsQueued;
+		std::atomic_int m_itemsDone;
+		std::atomic_int m_nextDeque;
+		JobQueue::OperationMode m_opMode;
+
+	} ;
+
+	enum SchedulerMode
+	{
+		GlobalQueue,	// all workers scan one shared job array
+		WorkStealing	// per-worker deques with stealing
+	} ;
+
 
 	MixerWorkerThread( Mixer* mixer );
 	virtual ~MixerWorkerThread();
@@ -81,12 +149,26 @@ public:
 	static void resetJobQueue( JobQueue::OperationMode _opMode =
 													JobQueue::Static )
 	{
-		globalJobQueue.reset( _opMode );
+		if( s_schedulerMode == WorkStealing )
+		{
+			stealingJobQueue.reset( _opMode );
+		}
+		else
+		{
+			globalJobQueue.reset( _opMode );
+		}
 	}
 
-	static void addJob( ThreadableJob * _job )
+	// returns false if the job did not require processing and thus
+	// has not been queued - if the queue is full, the job is processed
+	// by the calling thread before returning
+	static bool addJob( ThreadableJob * _job )
 	{
-		globalJobQueue.addJob( _job );
+		if( s_schedulerMode == WorkStealing )
+		{
+			return stealingJobQueue.addJob( _job );
+		}
+		return globalJobQueue.addJob( _job );
 	}
 
 	// a convenient helper function allowing to pass a container with pointers
@@ -104,14 +186,28 @@ public:
 
 	static void startAndWaitForJobs();
 
+	//! must be called before the first worker thread is created
+	static void setSchedulerMode( SchedulerMode _mode )
+	{
+		s_schedulerMode = _mode;
+	}
+
+	static SchedulerMode schedulerMode()
+	{
+		return s_schedulerMode;
+	}
+
 
 private:
 	void run() override;
 
 	static JobQueue globalJobQueue;
+	static WorkStealingQueue stealingJobQueue;
+	static SchedulerMode s_schedulerMode;
 	static QWaitCondition * queueReadyWaitCond;
 	static QList<MixerWorkerThread *> workerThreads;
 
+	int m_index;
 	volatile bool m_quit;
 
 } ;
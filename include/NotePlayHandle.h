@@ -26,15 +26,16 @@
 #ifndef NOTE_PLAY_HANDLE_H
 #define NOTE_PLAY_HANDLE_H
 
+#include <atomic>
 #include <memory>
 
 #include "BasicFilters.h"
+#include "LocklessAllocator.h"
 #include "Note.h"
 #include "PlayHandle.h"
 #include "Track.h"
 #include "MemoryManager.h"
 
-class QReadWriteLock;
 class InstrumentTrack;
 class NotePlayHandle;
 
@@ -125,6 +126,8 @@ public:
 	/*! Returns whether the play handle plays on a certain track */
 	bool isFromTrack( const Track* _track ) const override;
 
+	f_cnt_t latency() const override;
+
 	/*! Releases the note (and plays release frames */
 	void noteOff( const f_cnt_t offset = 0 );
 
@@ -332,8 +335,7 @@ private:
 } ;
 
 
-const int INITIAL_NPH_CACHE = 256;
-const int NPH_CACHE_INCREMENT = 16;
+const int NPH_CACHE_SIZE = 2048;
 
 class NotePlayHandleManager
 {
@@ -348,14 +350,31 @@ public:
 					int midiEventChannel = -1,
 					NotePlayHandle::Origin origin = NotePlayHandle::OriginPattern );
 	static void release( NotePlayHandle * nph );
-	static void extend( int i );
 	static void free();
 
+	// pool statistics
+	static int poolHits()
+	{
+		return s_poolHits;
+	}
+	static int poolMisses()
+	{
+		return s_poolMisses;
+	}
+	static int highWaterMark()
+	{
+		return s_highWaterMark;
+	}
+
 private:
-	static NotePlayHandle ** s_available;
-	static QReadWriteLock s_mutex;
-	static std::atomic_int s_availableIndex;
-	static int s_size;
+	// fixed-size lockless pool, handles not fitting in are allocated
+	// from the heap
+	static LocklessAllocatorT<NotePlayHandle> * s_pool;
+
+	static std::atomic_int s_inUse;
+	static std::atomic_int s_highWaterMark;
+	static std::atomic_int s_poolHits;
+	static std::atomic_int s_poolMisses;
 };
 
 
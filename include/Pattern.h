@@ -79,6 +79,10 @@ public:
 		return m_notes;
 	}
 
+	// first note starting at or after the given position; notes are kept
+	// sorted by position, so this is a binary search
+	NoteVector::ConstIterator firstNoteFrom( const MidiTime & pos ) const;
+
 	Note * addStepNote( int step );
 	void setStep( int step, bool enabled );
 
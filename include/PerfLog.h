@@ -56,10 +56,11 @@ private:
 ///
 /// Measures time between construction and destruction and prints the result to
 /// stderr, along with \p name. Alternatively, call begin() and end() explicitly.
+/// With \p reportMemory, the peak resident memory of the process is printed, too.
 class PerfLogTimer
 {
  public:
-	PerfLogTimer(const QString& name);
+	PerfLogTimer(const QString& name, bool reportMemory = false);
 	~PerfLogTimer();
 
 	void begin();
@@ -68,6 +69,11 @@ class PerfLogTimer
  private:
 	QString name;
 	PerfTime begin_time;
+	bool report_memory;
 };
 
+/// Prints \p message to stderr along with \p name, formatted like the
+/// output of PerfLogTimer, for figures other than times
+void perfLog(const QString& name, const QString& message);
+
 #endif
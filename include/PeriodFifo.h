@@ -0,0 +1,114 @@
+/*
+ * PeriodFifo.h - preallocated single producer/single consumer queue of
+ *                audio periods
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PERIOD_FIFO_H
+#define PERIOD_FIFO_H
+
+#include <atomic>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+
+//! Hands rendered periods from the mixer's FIFO writer to the audio device.
+//!
+//! All buffers are allocated up front and used as a ring. Passing a period
+//! is a copy and an atomic index update; the mutex is only taken when one
+//! side has to sleep because the ring is full or empty.
+class LMMS_EXPORT PeriodFifo
+{
+public:
+	//! @p depth periods may be queued in addition to the one being read
+	PeriodFifo( int depth, fpp_t frames );
+	~PeriodFifo();
+
+	//! Queue a copy of @p buffer, waiting for a free slot. NULL marks the
+	//! end of the stream.
+	void write( const surroundSampleFrame * buffer );
+
+	//! The next period, waiting for one if none is queued, or NULL at the
+	//! end of the stream. The buffer stays valid until the next call.
+	const surroundSampleFrame * read();
+
+	//! Wait until the reader has seen the end of the stream
+	void waitUntilRead();
+
+	//! Start a new stream. Neither side may be active.
+	void reset();
+
+	int depth() const
+	{
+		return m_depth;
+	}
+
+	//! Number of periods ready to be read
+	int fillLevel() const
+	{
+		return static_cast<int>( m_written.load( std::memory_order_relaxed ) -
+				m_readPos.load( std::memory_order_relaxed ) );
+	}
+
+	//! Number of times the reader had to wait for a period since reset()
+	int underruns() const
+	{
+		return m_underruns.load( std::memory_order_relaxed );
+	}
+
+
+private:
+	template<class Condition>
+	void waitFor( Condition ready );
+	void notify();
+
+	const int m_depth;
+	const int m_slots;
+	const fpp_t m_frames;
+	surroundSampleFrame * m_buffers;
+
+	// running counts of periods written by the writer, taken and given
+	// back by the reader; they may wrap around
+	std::atomic<unsigned int> m_written;
+	std::atomic<unsigned int> m_readPos;
+	std::atomic<unsigned int> m_released;
+
+	// the slots each side uses next, only touched by that side
+	int m_writeSlot;
+	int m_readSlot;
+	bool m_holding;
+
+	std::atomic<bool> m_ended;
+	std::atomic<bool> m_endRead;
+	std::atomic<int> m_underruns;
+
+	// only for sleeping, see waitFor()
+	std::atomic<int> m_sleepers;
+	QMutex m_mutex;
+	QWaitCondition m_wakeUp;
+
+} ;
+
+
+#endif
@@ -124,6 +124,12 @@ public:
 
 	virtual bool isFromTrack( const Track * _track ) const = 0;
 
+	// number of frames the output of the handle is delayed by
+	virtual f_cnt_t latency() const
+	{
+		return 0;
+	}
+
 	bool usesBuffer() const
 	{
 		return m_usesBuffer;
@@ -26,10 +26,10 @@
 #define PROJECT_JOURNAL_H
 
 #include <QtCore/QHash>
-#include <QtCore/QStack>
+#include <QtCore/QVector>
 
 #include "lmms_basics.h"
-#include "DataFile.h"
+#include "JournalState.h"
 
 class JournallingObject;
 
@@ -38,7 +38,8 @@ class JournallingObject;
 class ProjectJournal
 {
 public:
-	static const int MAX_UNDO_STATES;
+	//! Default memory budget for undo and redo states in MiB
+	static const int DEFAULT_MEMORY_BUDGET;
 
 	ProjectJournal();
 	virtual ~ProjectJournal();
@@ -51,6 +52,12 @@ public:
 
 	void addJournalCheckPoint( JournallingObject *jo );
 
+	//! Approximate memory used by all undo and redo states in bytes
+	size_t memoryUsage() const
+	{
+		return m_memoryUsage;
+	}
+
 	bool isJournalling() const
 	{
 		return m_journalling;
@@ -97,23 +104,35 @@ public:
 private:
 	typedef QHash<jo_id_t, JournallingObject *> JoIdMap;
 
+	//! The newest check point of each object holds its whole state, older
+	//! ones only the changes turning the next newer state into theirs
 	struct CheckPoint
 	{
-		CheckPoint( jo_id_t initID = 0, const DataFile& initData = DataFile( DataFile::JournalData ) ) :
-			joID( initID ),
-			data( initData )
-		{
-		}
 		jo_id_t joID;
-		DataFile data;
+		JournalState state;
+		JournalState::Delta delta;
+		size_t size;
 	} ;
-	typedef QStack<CheckPoint> CheckPointStack;
+	typedef QVector<CheckPoint> CheckPointStack;
+
+	static JournalState saveState( JournallingObject * jo );
+	static void restoreState( JournallingObject * jo, const JournalState & state );
+
+	void pushCheckPoint( CheckPointStack & stack, jo_id_t id,
+						const JournalState & state );
+	JournalState popCheckPoint( CheckPointStack & stack, jo_id_t & id );
+	void clearCheckPoints( CheckPointStack & stack );
+	//! Drop the oldest undo states until the budget is met
+	void trimCheckPoints();
 
 	JoIdMap m_joIDs;
 
 	CheckPointStack m_undoCheckPoints;
 	CheckPointStack m_redoCheckPoints;
 
+	size_t m_memoryUsage;
+	size_t m_memoryBudget;
+
 	bool m_journalling;
 
 } ;
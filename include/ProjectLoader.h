@@ -0,0 +1,99 @@
+/*
+ * ProjectLoader.h - loads song projects without a DOM of the whole file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PROJECT_LOADER_H
+#define PROJECT_LOADER_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+#include <QDomDocument>
+
+#include "lmms_export.h"
+
+
+//! Streams an XML song project instead of parsing it into one DOM.
+//!
+//! A single QXmlStreamReader pass copies everything but the tracks of the
+//! song into a small skeleton document, which is loaded through DataFile
+//! as usual. Each track is parsed into a DOM of its own on a thread pool
+//! while the tracks before it get created, and dropped once the track
+//! exists. Only projects which don't need DataFile::upgrade() are
+//! streamed, older ones and binary projects are loaded as a whole.
+class LMMS_EXPORT ProjectLoader
+{
+public:
+	ProjectLoader( const QString & fileName );
+	~ProjectLoader();
+
+	//! False if the project has to be loaded through DataFile directly
+	bool isStreaming() const
+	{
+		return m_streaming;
+	}
+
+	//! The project without the song's tracks
+	const QByteArray & skeleton() const
+	{
+		return m_skeleton;
+	}
+
+	//! Number of tracks to be created, including the ones inside the
+	//! song's beat/bassline tracks
+	int trackCount() const
+	{
+		return m_tracks.size() + m_nestedTracks;
+	}
+
+	//! The next track of the song, a null element after the last one. The
+	//! element stays valid until the next call.
+	QDomElement nextTrack();
+
+
+private:
+	bool scan( const QString & text );
+	void scheduleParsing();
+	void parseTrack( int index );
+
+	bool m_streaming;
+	QByteArray m_skeleton;
+
+	// the text of each track, dropped once it is parsed
+	QVector<QString> m_tracks;
+	int m_nestedTracks;
+	QVector<QDomDocument> m_parsed;
+	QVector<bool> m_done;
+	int m_nextTrack;
+	int m_scheduled;
+
+	QThreadPool m_pool;
+	QMutex m_mutex;
+	QWaitCondition m_parsedCondition;
+
+	friend class TrackParser;
+
+} ;
+
+
+#endif
@@ -25,6 +25,9 @@
 #ifndef PROJECT_RENDERER_H
 #define PROJECT_RENDERER_H
 
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
 #include "AudioFileDevice.h"
 #include "lmmsconfig.h"
 #include "Mixer.h"
@@ -32,6 +35,9 @@
 
 #include "lmms_export.h"
 
+class AudioPort;
+class StemWriter;
+
 class LMMS_EXPORT ProjectRenderer : public QThread
 {
 	Q_OBJECT
@@ -67,6 +73,10 @@ public:
 		return m_fileDev != NULL;
 	}
 
+	//! Additionally render the output of \p port into \p outputFilename.
+	//! Must be called before startProcessing().
+	bool addStem( AudioPort * port, const QString & outputFilename );
+
 	static ExportFileFormats getFileFormatFromExtension(
 							const QString & _ext );
 
@@ -88,8 +98,20 @@ signals:
 private:
 	void run() override;
 
+	AudioFileDevice * createFileDevice( const QString & outputFilename );
+
 	AudioFileDevice * m_fileDev;
 	Mixer::qualitySettings m_qualitySettings;
+	OutputSettings m_outputSettings;
+	ExportFileFormats m_exportFileFormat;
+
+	struct Stem
+	{
+		AudioPort * port;
+		StemWriter * writer;
+	} ;
+	QVector<Stem> m_stems;
+	QThreadPool m_stemWriterPool;
 
 	volatile int m_progress;
 	volatile bool m_abort;
@@ -46,6 +46,7 @@
 #endif
 
 #include <QtCore/QtGlobal>
+#include <QtCore/QMutex>
 #include <QtCore/QSystemSemaphore>
 #endif
 
@@ -106,7 +107,9 @@ typedef int32_t key_t;
 const int SHM_FIFO_SIZE = 512*1024;
 
 
-// implements a FIFO inside a shared memory segment
+// implements a FIFO inside a shared memory segment. Each FIFO has a single
+// writing and a single reading process, so the data goes through a lock-free
+// ring buffer and only waiting for a message involves a semaphore.
 class shmFifo
 {
 	// need this union to handle different sizes of sem_t on 32 bit
@@ -118,11 +121,11 @@ class shmFifo
 	} ;
 	struct shmData
 	{
-		sem32_t dataSem;	// semaphore for locking this
-					// FIFO management data
 		sem32_t messageSem;	// semaphore for incoming messages
-		volatile int32_t startPtr; // current start of FIFO in memory
-		volatile int32_t endPtr;   // current end of FIFO in memory
+		// total number of bytes read and written, the ring buffer
+		// size divides 2^32 so these may wrap around
+		std::atomic<uint32_t> readPtr;
+		std::atomic<uint32_t> writePtr;
 		char data[SHM_FIFO_SIZE];  // actual data
 	} ;
 
@@ -138,9 +141,8 @@ public:
 		m_shmID( -1 ),
 #endif
 		m_data( NULL ),
-		m_dataSem( QString() ),
 		m_messageSem( QString() ),
-		m_lockDepth( 0 )
+		m_lock( QMutex::Recursive )
 	{
 #ifdef USE_QT_SHMEM
 		do
@@ -158,12 +160,10 @@ public:
 		m_data = (shmData *) shmat( m_shmID, 0, 0 );
 #endif
 		assert( m_data != NULL );
-		m_data->startPtr = m_data->endPtr = 0;
+		m_data->readPtr.store( 0 );
+		m_data->writePtr.store( 0 );
 		static int k = 0;
-		m_data->dataSem.semKey = ( getpid()<<10 ) + ++k;
 		m_data->messageSem.semKey = ( getpid()<<10 ) + ++k;
-		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ),
-						1, QSystemSemaphore::Create );
 		m_messageSem.setKey( QString::number(
 						m_data->messageSem.semKey ),
 						0, QSystemSemaphore::Create );
@@ -181,9 +181,8 @@ public:
 		m_shmID( shmget( _shm_key, 0, 0 ) ),
 #endif
 		m_data( NULL ),
-		m_dataSem( QString() ),
 		m_messageSem( QString() ),
-		m_lockDepth( 0 )
+		m_lock( QMutex::Recursive )
 	{
 #ifdef USE_QT_SHMEM
 		if( m_shmObj.attach() )
@@ -197,7 +196,6 @@ public:
 		}
 #endif
 		assert( m_data != NULL );
-		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ) );
 		m_messageSem.setKey( QString::number(
 						m_data->messageSem.semKey ) );
 	}
@@ -232,21 +230,21 @@ public:
 		return m_master;
 	}
 
-	// recursive lock
+	// keeps other threads of this process from reading or writing until
+	// a whole message is done, the other process doesn't need to wait
 	inline void lock()
 	{
-		if( !isInvalid() && m_lockDepth.fetch_add( 1 ) == 0 )
+		if( !isInvalid() )
 		{
-			m_dataSem.acquire();
+			m_lock.lock();
 		}
 	}
 
-	// recursive unlock
 	inline void unlock()
 	{
-		if( m_lockDepth.fetch_sub( 1 ) <= 1 )
+		if( !isInvalid() )
 		{
-			m_dataSem.release();
+			m_lock.unlock();
 		}
 	}
 
@@ -266,52 +264,14 @@ public:
 	}
 
 
-	inline int32_t readInt()
-	{
-		int32_t i;
-		read( &i, sizeof( i ) );
-		return i;
-	}
-
-	inline void writeInt( const int32_t & _i )
-	{
-		write( &_i, sizeof( _i ) );
-	}
-
-	inline std::string readString()
-	{
-		const int len = readInt();
-		if( len )
-		{
-			char * sc = new char[len + 1];
-			read( sc, len );
-			sc[len] = 0;
-			std::string s( sc );
-			delete[] sc;
-			return s;
-		}
-		return std::string();
-	}
-
-
-	inline void writeString( const std::string & _s )
-	{
-		const int len = _s.size();
-		writeInt( len );
-		write( _s.c_str(), len );
-	}
-
-
 	inline bool messagesLeft()
 	{
 		if( isInvalid() )
 		{
 			return false;
 		}
-		lock();
-		const bool empty = ( m_data->startPtr == m_data->endPtr );
-		unlock();
-		return !empty;
+		return m_data->readPtr.load( std::memory_order_relaxed ) !=
+			m_data->writePtr.load( std::memory_order_acquire );
 	}
 
 
@@ -321,79 +281,87 @@ public:
 	}
 
 
-private:
-	static inline void fastMemCpy( void * _dest, const void * _src,
-							const int _len )
-	{
-		// calling memcpy() for just an integer is obsolete overhead
-		if( _len == 4 )
-		{
-			*( (int32_t *) _dest ) = *( (int32_t *) _src );
-		}
-		else
-		{
-			memcpy( _dest, _src, _len );
-		}
-	}
-
 	void read( void * _buf, int _len )
 	{
-		if( isInvalid() )
-		{
-			memset( _buf, 0, _len );
-			return;
-		}
-		lock();
-		while( isInvalid() == false &&
-				_len > m_data->endPtr - m_data->startPtr )
+		char * buf = (char *) _buf;
+		const uint32_t start = m_data->readPtr.load( std::memory_order_relaxed );
+		int done = 0;
+
+		while( done < _len )
 		{
-			unlock();
+			if( isInvalid() )
+			{
+				memset( buf + done, 0, _len - done );
+				return;
+			}
+
+			const uint32_t pos = start + done;
+			const uint32_t avail = m_data->writePtr.load(
+					std::memory_order_acquire ) - pos;
+			if( avail == 0 )
+			{
 #ifndef LMMS_BUILD_WIN32
-			usleep( 5 );
+				usleep( 5 );
 #endif
-			lock();
-		}
-		fastMemCpy( _buf, m_data->data + m_data->startPtr, _len );
-		m_data->startPtr += _len;
-		// nothing left?
-		if( m_data->startPtr == m_data->endPtr )
-		{
-			// then reset to 0
-			m_data->startPtr = m_data->endPtr = 0;
+				continue;
+			}
+
+			// copy up to the end of the ring buffer at most
+			const uint32_t index = pos % SHM_FIFO_SIZE;
+			uint32_t len = _len - done;
+			len = len < avail ? len : avail;
+			len = len < SHM_FIFO_SIZE - index ? len : SHM_FIFO_SIZE - index;
+
+			memcpy( buf + done, m_data->data + index, len );
+			done += len;
+			m_data->readPtr.store( start + done, std::memory_order_release );
 		}
-		unlock();
 	}
 
+	// waits for the reader to make room, so data larger than the buffer
+	// has to be signalled before it's written, see sendMessage()
 	void write( const void * _buf, int _len )
 	{
-		if( isInvalid() || _len > SHM_FIFO_SIZE )
+		if( isInvalid() )
 		{
 			return;
 		}
-		lock();
-		while( _len > SHM_FIFO_SIZE - m_data->endPtr )
+
+		const char * buf = (const char *) _buf;
+		const uint32_t start = m_data->writePtr.load( std::memory_order_relaxed );
+		int done = 0;
+
+		while( done < _len )
 		{
-			// if no space is left, try to move data to front
-			if( m_data->startPtr > 0 )
+			if( isInvalid() )
 			{
-				memmove( m_data->data,
-					m_data->data + m_data->startPtr,
-					m_data->endPtr - m_data->startPtr );
-				m_data->endPtr = m_data->endPtr -
-							m_data->startPtr;
-				m_data->startPtr = 0;
+				return;
 			}
-			unlock();
+
+			const uint32_t pos = start + done;
+			const uint32_t space = SHM_FIFO_SIZE - ( pos -
+				m_data->readPtr.load( std::memory_order_acquire ) );
+			if( space == 0 )
+			{
 #ifndef LMMS_BUILD_WIN32
-			usleep( 5 );
+				usleep( 5 );
 #endif
-			lock();
+				continue;
+			}
+
+			const uint32_t index = pos % SHM_FIFO_SIZE;
+			uint32_t len = _len - done;
+			len = len < space ? len : space;
+			len = len < SHM_FIFO_SIZE - index ? len : SHM_FIFO_SIZE - index;
+
+			memcpy( m_data->data + index, buf + done, len );
+			done += len;
+			m_data->writePtr.store( start + done, std::memory_order_release );
 		}
-		fastMemCpy( m_data->data + m_data->endPtr, _buf, _len );
-		m_data->endPtr += _len;
-		unlock();
 	}
 
+
+private:
 	volatile bool m_invalid;
 	bool m_master;
 	key_t m_shmKey;
@@ -403,9 +371,8 @@ private:
 	int m_shmID;
 #endif
 	shmData * m_data;
-	QSystemSemaphore m_dataSem;
 	QSystemSemaphore m_messageSem;
-	std::atomic_int m_lockDepth;
+	QMutex m_lock;
 
 } ;
 #endif
@@ -475,23 +442,31 @@ public:
 
 		message & addInt( int _i )
 		{
-			char buf[32];
-			sprintf( buf, "%d", _i );
-			data.push_back( std::string( buf ) );
+			data.push_back( binaryField( IntField, &_i ) );
 			return *this;
 		}
 
 		message & addFloat( float _f )
 		{
-			char buf[32];
-			sprintf( buf, "%f", _f );
-			data.push_back( std::string( buf ) );
+			data.push_back( binaryField( FloatField, &_f ) );
 			return *this;
 		}
 
 		inline std::string getString( int _p = 0 ) const
 		{
-			return data[_p];
+			// numbers can still be read as text
+			char buf[32];
+			switch( fieldType( _p ) )
+			{
+				case IntField:
+					sprintf( buf, "%d", getInt( _p ) );
+					return std::string( buf );
+				case FloatField:
+					sprintf( buf, "%f", getFloat( _p ) );
+					return std::string( buf );
+				default:
+					return data[_p];
+			}
 		}
 
 #ifndef BUILD_REMOTE_PLUGIN_CLIENT
@@ -503,12 +478,87 @@ public:
 
 		inline int getInt( int _p = 0 ) const
 		{
-			return atoi( data[_p].c_str() );
+			switch( fieldType( _p ) )
+			{
+				case IntField:
+					return fieldValue<int32_t>( _p );
+				case FloatField:
+					return (int) fieldValue<float>( _p );
+				default:
+					// numbers sent as text
+					return atoi( data[_p].c_str() );
+			}
 		}
 
 		inline float getFloat( int _p ) const
 		{
-			return (float) atof( data[_p].c_str() );
+			switch( fieldType( _p ) )
+			{
+				case IntField:
+					return (float) fieldValue<int32_t>( _p );
+				case FloatField:
+					return fieldValue<float>( _p );
+				default:
+					return (float) atof( data[_p].c_str() );
+			}
+		}
+
+		inline int fieldCount() const
+		{
+			return data.size();
+		}
+
+		// Wire format: id, field count and size of the fields, followed
+		// by the length and the bytes of each field. The whole message is
+		// put together first so it can be sent with a single write.
+		void serialize( std::vector<char> & _buf ) const
+		{
+			int32_t header[3] = { id, (int32_t) data.size(), 0 };
+			for( unsigned int i = 0; i < data.size(); ++i )
+			{
+				header[2] += sizeof( int32_t ) + data[i].size();
+			}
+
+			_buf.resize( sizeof( header ) + header[2] );
+			char * p = &_buf[0];
+			memcpy( p, header, sizeof( header ) );
+			p += sizeof( header );
+
+			for( unsigned int i = 0; i < data.size(); ++i )
+			{
+				const int32_t len = data[i].size();
+				memcpy( p, &len, sizeof( len ) );
+				memcpy( p + sizeof( len ), data[i].data(), len );
+				p += sizeof( len ) + len;
+			}
+		}
+
+		// Parse the fields following the header, returns false if they
+		// don't match the sizes given
+		bool deserialize( const char * _fields, int _size, int _count )
+		{
+			data.clear();
+			data.reserve( _count );
+
+			const char * end = _fields + _size;
+			for( int i = 0; i < _count; ++i )
+			{
+				int32_t len;
+				if( end - _fields < (int) sizeof( len ) )
+				{
+					return false;
+				}
+				memcpy( &len, _fields, sizeof( len ) );
+				_fields += sizeof( len );
+				if( len < 0 || end - _fields < len )
+				{
+					return false;
+				}
+				data.push_back( std::string( _fields, len ) );
+				_fields += len;
+			}
+
+			return true;
 		}
 
 		inline bool operator==( const message & _m ) const
@@ -519,6 +569,42 @@ public:
 		int id;
 
 	private:
+		// Numbers are stored as a marker followed by their bytes. The
+		// leading zero can't start a text field, which is how numbers
+		// were sent before and are still understood.
+		enum FieldTypes
+		{
+			TextField,
+			IntField = 'i',
+			FloatField = 'f'
+		} ;
+
+		static std::string binaryField( char _type, const void * _value )
+		{
+			char buf[2 + 4] = { 0, _type };
+			memcpy( buf + 2, _value, 4 );
+			return std::string( buf, sizeof( buf ) );
+		}
+
+		FieldTypes fieldType( int _p ) const
+		{
+			const std::string & f = data[_p];
+			if( f.size() == 2 + 4 && f[0] == 0 &&
+					( f[1] == IntField || f[1] == FloatField ) )
+			{
+				return static_cast<FieldTypes>( f[1] );
+			}
+			return TextField;
+		}
+
+		template<typename T>
+		T fieldValue( int _p ) const
+		{
+			T value;
+			memcpy( &value, data[_p].data() + 2, sizeof( value ) );
+			return value;
+		}
+
 		std::vector<std::string> data;
 
 		friend class RemotePluginBase;
@@ -564,43 +650,6 @@ public:
 		return m;
 	}
 
-#ifndef SYNC_WITH_SHM_FIFO
-	inline int32_t readInt()
-	{
-		int32_t i;
-		read( &i, sizeof( i ) );
-		return i;
-	}
-
-	inline void writeInt( const int32_t & _i )
-	{
-		write( &_i, sizeof( _i ) );
-	}
-
-	inline std::string readString()
-	{
-		const int len = readInt();
-		if( len )
-		{
-			char * sc = new char[len + 1];
-			read( sc, len );
-			sc[len] = 0;
-			std::string s( sc );
-			delete[] sc;
-			return s;
-		}
-		return std::string();
-	}
-
-
-	inline void writeString( const std::string & _s )
-	{
-		const int len = _s.size();
-		writeInt( len );
-		write( _s.c_str(), len );
-	}
-#endif
-
 #ifndef BUILD_REMOTE_PLUGIN_CLIENT
 	inline bool messagesLeft()
 	{
@@ -807,6 +856,25 @@ public:
 
 	bool process( const sampleFrame * _in_buf, sampleFrame * _out_buf );
 
+	//! In pipelined mode process() hands the current period to the plugin
+	//! and returns the previous one, so the plugin runs concurrently with
+	//! the rest of the mixer instead of being waited for. This adds one
+	//! period of latency, reported by latency(). The mixer doesn't
+	//! compensate it yet, so it is off unless enabled with
+	//! app/pipelineremoteplugins. Not used when exporting.
+	void setPipelined( bool _on )
+	{
+		m_pipelined = _on;
+	}
+
+	bool isPipelined() const
+	{
+		return m_pipelined;
+	}
+
+	//! Delay of the output in frames, for latency compensation
+	f_cnt_t latency() const;
+
 	void processMidiEvent( const MidiEvent&, const f_cnt_t _offset );
 
 	void updateSampleRate( sample_rate_t _sr )
@@ -854,6 +922,12 @@ public slots:
 	virtual void hideUI();
 
 protected:
+	//! Called before every period, e.g. to send changes collected
+	//! since the last one
+	virtual void sendPendingChanges()
+	{
+	}
+
 	inline void setSplittedChannels( bool _on )
 	{
 		m_splitChannels = _on;
@@ -864,6 +938,9 @@ protected:
 private:
 	void resizeSharedProcessingMemory();
 
+	void writeInputs( const sampleFrame * _in_buf, const fpp_t frames );
+	void readOutputs( sampleFrame * _out_buf, const fpp_t frames );
+
 
 	QProcess m_process;
 	ProcessWatcher m_watcher;
@@ -884,6 +961,12 @@ private:
 	int m_inputCount;
 	int m_outputCount;
 
+	bool m_pipelined;
+	// IdStartProcessing was sent but IdProcessingDone not received yet
+	bool m_processingPending;
+	// a pipelined period whose output hasn't been returned yet
+	bool m_periodInFlight;
+
 #ifndef SYNC_WITH_SHM_FIFO
 	int m_server;
 	QString m_socketFile;
@@ -1055,32 +1138,32 @@ RemotePluginBase::~RemotePluginBase()
 
 int RemotePluginBase::sendMessage( const message & _m )
 {
+	std::vector<char> buf;
+	_m.serialize( buf );
+
 #ifdef SYNC_WITH_SHM_FIFO
+	// the reader only starts once a message is signalled. Messages that
+	// don't fit into the FIFO, like large plugin states, are signalled
+	// first, so the reader drains the FIFO while they're being written.
+	const bool streamed = buf.size() > SHM_FIFO_SIZE;
 	m_out->lock();
-	m_out->writeInt( _m.id );
-	m_out->writeInt( _m.data.size() );
-	int j = 8;
-	for( unsigned int i = 0; i < _m.data.size(); ++i )
+	if( streamed )
 	{
-		m_out->writeString( _m.data[i] );
-		j += 4 + _m.data[i].size();
+		m_out->messageSent();
 	}
+	m_out->write( &buf[0], buf.size() );
 	m_out->unlock();
-	m_out->messageSent();
-#else
-	pthread_mutex_lock( &m_sendMutex );
-	writeInt( _m.id );
-	writeInt( _m.data.size() );
-	int j = 8;
-	for( unsigned int i = 0; i < _m.data.size(); ++i )
+	if( !streamed )
 	{
-		writeString( _m.data[i] );
-		j += 4 + _m.data[i].size();
+		m_out->messageSent();
 	}
+#else
+	pthread_mutex_lock( &m_sendMutex );
+	write( &buf[0], buf.size() );
 	pthread_mutex_unlock( &m_sendMutex );
 #endif
 
-	return j;
+	return buf.size();
 }
 
 
@@ -1088,28 +1171,35 @@ int RemotePluginBase::sendMessage( const message & _m )
 
 RemotePluginBase::message RemotePluginBase::receiveMessage()
 {
+	int32_t header[3];
+	std::vector<char> fields;
+	message m;
+
 #ifdef SYNC_WITH_SHM_FIFO
 	m_in->waitForMessage();
 	m_in->lock();
-	message m;
-	m.id = m_in->readInt();
-	const int s = m_in->readInt();
-	for( int i = 0; i < s; ++i )
-	{
-		m.data.push_back( m_in->readString() );
-	}
+	m_in->read( header, sizeof( header ) );
+	const int size = header[2] > 0 ? header[2] : 0;
+	fields.resize( size + 1 );
+	m_in->read( &fields[0], size );
 	m_in->unlock();
 #else
 	pthread_mutex_lock( &m_receiveMutex );
-	message m;
-	m.id = readInt();
-	const int s = readInt();
-	for( int i = 0; i < s; ++i )
-	{
-		m.data.push_back( readString() );
-	}
+	read( header, sizeof( header ) );
+	const int size = header[2] > 0 ? header[2] : 0;
+	fields.resize( size + 1 );
+	read( &fields[0], size );
 	pthread_mutex_unlock( &m_receiveMutex );
 #endif
+
+	m.id = header[0];
+	if( !m.deserialize( &fields[0], size, header[1] ) )
+	{
+		fprintf( stderr, "RemotePluginBase: malformed message %d\n",
+								header[0] );
+		m.id = IdUndefined;
+	}
+
 	return m;
 }
 
@@ -50,6 +50,11 @@ public:
 	/// Export all unmuted tracks into individual file
 	void renderTracks();
 
+	/// Export all unmuted tracks into individual files in a single pass.
+	/// Stems are taken from the tracks' outputs before the FX mixer, the
+	/// master mix is written alongside them.
+	void renderStems();
+
 	void abortProcessing();
 
 signals:
@@ -61,10 +66,12 @@ private slots:
 	void updateConsoleProgress();
 
 private:
+	QVector<Track*> unmutedTracks() const;
 	QString pathForTrack( const Track *track, int num );
 	void restoreMutedState();
 
 	void render( QString outputPath );
+	void startRenderer();
 
 	const Mixer::qualitySettings m_qualitySettings;
 	const Mixer::qualitySettings m_oldQualitySettings;
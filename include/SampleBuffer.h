@@ -37,10 +37,12 @@
 #include "lmms_math.h"
 #include "shared_object.h"
 #include "MemoryManager.h"
+#include "SampleCache.h"
 
 
 class QPainter;
 class QRect;
+class SamplePeaks;
 
 // values for buffer margins, used for various libsamplerate interpolation modes
 // the array positions correspond to the converter_type parameter values in libsamplerate
@@ -254,6 +256,10 @@ public:
 
 public slots:
 	void setAudioFile( const QString & _audio_file );
+	// decode _audio_file in the background and swap it in afterwards,
+	// the current data is played until then, audioFileLoaded() is
+	// emitted once it is swapped in
+	void setAudioFileAsync( const QString & _audio_file );
 	void loadFromBase64( const QString & _data );
 	void setStartFrame( const f_cnt_t _s );
 	void setEndFrame( const f_cnt_t _e );
@@ -265,6 +271,22 @@ private:
 	static sample_rate_t mixerSampleRate();
 
 	void update( bool _keep_settings = false );
+	// decode file into m_data, returns false if it exceeds the size limits
+	bool loadAudioFile( const QString & file, bool _keep_settings );
+	static SampleCache::EntryPtr decodeToCache( const QString & file );
+	// decode and resample file straight into its disk cache file in
+	// chunks, for audio too large to be decoded into memory at once
+	static SampleCache::EntryPtr streamSampleSF( const QString & file );
+
+	// point m_data to decoded audio shared with other buffers
+	void setSharedData( const SampleCache::EntryPtr & entry );
+	void freeData();
+
+	// drop the waveform peaks after m_data changed
+	void invalidatePeaks();
+	// build the waveform peaks in the background, or load them from the
+	// sample cache directory
+	void requestPeaks();
 
 	void convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels);
 	void directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels);
@@ -285,6 +307,8 @@ private:
 	sampleFrame * m_origData;
 	f_cnt_t m_origFrames;
 	sampleFrame * m_data;
+	// set while m_data belongs to a SampleCache entry
+	SampleCache::EntryPtr m_sharedData;
 	QReadWriteLock m_varLock;
 	f_cnt_t m_frames;
 	f_cnt_t m_startFrame;
@@ -295,6 +319,12 @@ private:
 	bool m_reversed;
 	float m_frequency;
 	sample_rate_t m_sampleRate;
+	// to ignore outdated background loads
+	int m_loadGeneration;
+	// waveform peaks for visualize(), only used from the GUI thread
+	std::shared_ptr<const SamplePeaks> m_peaks;
+	bool m_peaksPending;
+	int m_peaksGeneration;
 
 	sampleFrame * getSampleFragment( f_cnt_t _index, f_cnt_t _frames,
 						LoopMode _loopmode,
@@ -307,6 +337,10 @@ private:
 
 signals:
 	void sampleUpdated();
+	// the file passed to setAudioFileAsync() has been swapped in
+	void audioFileLoaded();
+	// the waveform peaks have been built, so it should be redrawn
+	void peaksUpdated();
 
 } ;
 
@@ -0,0 +1,161 @@
+/*
+ * SampleCache.h - process-wide cache of decoded audio files
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <QtCore/QString>
+
+#include <functional>
+#include <memory>
+
+#include "lmms_export.h"
+#include "lmms_basics.h"
+
+class QFile;
+class QIODevice;
+
+
+/// \brief Shares decoded and resampled audio files between SampleBuffers
+///
+/// Entries are keyed by the file's absolute path, its size and modification
+/// time and the sample rate the audio was converted to. An entry stays alive
+/// as long as a SampleBuffer uses it. Additionally, the most recently used entries
+/// are kept up to a memory budget (app/samplecachesize in MB) so that files
+/// being loaded repeatedly, like the metronome, are only decoded once.
+///
+/// Audio larger than app/samplemapthreshold (in MB) is written to a file in
+/// the user's cache directory and memory-mapped instead of being kept on the
+/// heap. Its pages are backed by that file, so the OS can drop them from
+/// memory at any time, and later sessions don't have to decode it again.
+/// Such audio can be streamed into its cache file while being decoded, so
+/// it never has to fit into memory at once. Mappings are faulted in before
+/// they are handed out, so playing them doesn't wait for the disk.
+/// Cache files are named after the entry's key, so a changed file never
+/// matches an old one. The least recently used ones are deleted when they
+/// exceed app/samplediskcachesize (in MB).
+class LMMS_EXPORT SampleCache
+{
+public:
+	class Entry
+	{
+	public:
+		/// Takes ownership of \p data, which must be allocated with MM_ALLOC
+		Entry( sampleFrame * data, f_cnt_t frames,
+					const QString & key = QString() );
+		/// Takes ownership of \p file, \p data being its mapped contents
+		Entry( QFile * file, sampleFrame * data, f_cnt_t frames,
+					const QString & key );
+		~Entry();
+
+		/// Identifies the audio in the cache, empty if it isn't cached
+		const QString & key() const
+		{
+			return m_key;
+		}
+
+		const sampleFrame * data() const
+		{
+			return m_data;
+		}
+
+		f_cnt_t frames() const
+		{
+			return m_frames;
+		}
+
+		bool isMapped() const
+		{
+			return m_file != NULL;
+		}
+
+		/// Heap memory used by the audio
+		qint64 heapBytes() const
+		{
+			return isMapped() ? 0 : m_frames * sizeof( sampleFrame );
+		}
+
+	private:
+		QFile * m_file;
+		sampleFrame * m_data;
+		f_cnt_t m_frames;
+		QString m_key;
+	} ;
+
+	typedef std::shared_ptr<const Entry> EntryPtr;
+
+	/// Returns the cached audio of \p file at \p sampleRate, or an empty
+	/// pointer if it has to be decoded
+	static EntryPtr get( const QString & file, sample_rate_t sampleRate );
+
+	/// Adds decoded audio of \p file at \p sampleRate to the cache, taking
+	/// ownership of \p data
+	static EntryPtr insert( const QString & file, sample_rate_t sampleRate,
+					sampleFrame * data, f_cnt_t frames );
+
+	/// Adds audio of \p file at \p sampleRate which \p write streams into
+	/// the given device, for audio too large to be decoded into memory.
+	/// \p write returns false on failure.
+	static EntryPtr insertStreamed( const QString & file,
+				sample_rate_t sampleRate,
+				const std::function<bool( QIODevice & )> & write );
+
+	/// Whether audio of \p frames frames gets memory-mapped
+	static bool isMapped( qint64 frames );
+
+	/// Returns the audio of \p entry played backwards, cached like any
+	/// other entry. Reversing that again returns the original audio.
+	static EntryPtr reversed( const EntryPtr & entry );
+
+	/// Drops all entries not used by any SampleBuffer
+	static void clear();
+
+	static int hits();
+	static int misses();
+	/// Heap memory used by the entries retained by the cache in bytes
+	static qint64 retainedBytes();
+
+	/// Where the waveform peaks of \p entry are kept, next to its cache
+	/// file. Empty if the entry isn't cached.
+	static QString peaksFilePath( const EntryPtr & entry );
+
+	/// Delete the least recently used cache files and peaks exceeding the
+	/// disk budget, except the ones of \p keep which was just written
+	static void pruneCacheFiles( const QString & keep );
+
+private:
+	static QString key( const QString & file, sample_rate_t sampleRate );
+	static EntryPtr lookup( const QString & key );
+	static EntryPtr store( const QString & key,
+					sampleFrame * data, f_cnt_t frames );
+	static EntryPtr storeStreamed( const QString & key,
+				const std::function<bool( QIODevice & )> & write );
+	static EntryPtr publish( const QString & key, const EntryPtr & entry );
+	static void retain( const EntryPtr & entry );
+
+	static QString cacheFilePath( const QString & key );
+	static EntryPtr mapCacheFile( const QString & path, const QString & key );
+
+} ;
+
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * SamplePeaks.h - peak levels of a sample at several resolutions
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_PEAKS_H
+#define SAMPLE_PEAKS_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <memory>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+
+/// \brief Minimum, maximum and RMS of a sample's blocks, for drawing it
+///
+/// Level 0 describes blocks of BlockFrames frames, each further level
+/// combines LevelFactor blocks of the level below, until one block covers
+/// the whole sample. Drawing picks the level whose blocks are just smaller
+/// than a pixel, so it looks at a few blocks per pixel at any zoom level.
+/// Both channels are combined into one value.
+class LMMS_EXPORT SamplePeaks
+{
+public:
+	static const int BlockFrames = 256;
+	static const int LevelFactor = 4;
+
+	struct Peak
+	{
+		float min;
+		float max;
+		float rms;
+	} ;
+
+	SamplePeaks( const sampleFrame * data, f_cnt_t frames );
+
+	/// Peaks saved with save(), or an empty pointer if the file is missing,
+	/// damaged or describes a different number of frames
+	static std::shared_ptr<const SamplePeaks> load( const QString & path,
+								f_cnt_t frames );
+	bool save( const QString & path ) const;
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	int levels() const
+	{
+		return m_levels.size();
+	}
+
+	f_cnt_t blockFrames( int level ) const;
+
+	const QVector<Peak> & level( int level ) const
+	{
+		return m_levels[level];
+	}
+
+	/// The coarsest level with blocks of at most @p framesPerPixel frames
+	int levelFor( double framesPerPixel ) const;
+
+	/// Combined peak of the blocks of @p level overlapping the frames
+	/// [@p from, @p to)
+	Peak range( int level, f_cnt_t from, f_cnt_t to ) const;
+
+	/// Peak of every @p step th frame of the frames [@p from, @p to) of
+	/// @p data
+	static Peak fromFrames( const sampleFrame * data, f_cnt_t from, f_cnt_t to,
+							f_cnt_t step = 1 );
+
+
+private:
+	SamplePeaks( f_cnt_t frames, const QVector<Peak> & base );
+
+	/// Combined peak of the blocks [@p first, @p last) of @p level
+	Peak combine( int level, int first, int last ) const;
+	void buildLevels();
+
+	f_cnt_t m_frames;
+	QVector<QVector<Peak> > m_levels;
+
+} ;
+
+
+#endif
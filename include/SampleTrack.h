@@ -82,11 +82,17 @@ public slots:
 	void playbackPositionChanged();
 	void updateTrackTcos();
 
+private slots:
+	void sampleLoaded();
+
 
 private:
 	SampleBuffer* m_sampleBuffer;
 	BoolModel m_recordModel;
 	bool m_isPlaying;
+	// sample rate saved with the project, applied once the file is
+	// loaded in the background, 0 if none
+	sample_rate_t m_savedSampleRate;
 
 
 	friend class SampleTCOView;
@@ -96,6 +96,7 @@ private slots:
 	// Audio settings widget.
 	void audioInterfaceChanged(const QString & driver);
 	void toggleHQAudioDev(bool enabled);
+	void toggleWorkStealing(bool enabled);
 	void setBufferSize(int value);
 	void resetBufferSize();
 
@@ -170,6 +171,7 @@ private:
 	bool m_NaNHandler;
 	bool m_hqAudioDev;
 	int m_bufferSize;
+	bool m_workStealing;
 	QSlider * m_bufferSizeSlider;
 	QLabel * m_bufferSizeLbl;
 
@@ -405,7 +405,7 @@ private:
 
 	void removeAllControllers();
 
-	void processAutomations(const TrackList& tracks, MidiTime timeStart, fpp_t frames);
+	void processAutomations(const TrackList& tracks, MidiTime timeStart, f_cnt_t frameOffset);
 
 	void setModified(bool value);
 
@@ -464,6 +464,18 @@ private:
 	MidiTime m_exportSongEnd;
 	MidiTime m_exportEffectiveLength;
 
+	// the automated values looked up for the tick after the last processed
+	// one, reused by processAutomations() when playback got there
+	struct NextAutomation
+	{
+		AutomatedValueMap values;
+		MidiTime time;
+		const TrackContainer * container;
+		int tcoNum;
+		unsigned int destroyedModels;
+	} ;
+	NextAutomation m_nextAutomation;
+
 	friend class LmmsCore;
 	friend class SongEditor;
 	friend class mainWindow;
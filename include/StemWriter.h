@@ -0,0 +1,96 @@
+/*
+ * StemWriter.h - encodes the output of a single audio port into a file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef STEM_WRITER_H
+#define STEM_WRITER_H
+
+#include <atomic>
+
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QWaitCondition>
+
+#include "lmms_basics.h"
+
+
+class AudioFileDevice;
+class QThreadPool;
+
+
+/// \brief Writes the buffers of one stem to its file device
+///
+/// Buffers are handed in by the thread rendering the audio port and get
+/// encoded on a thread pool. Each writer encodes its buffers in order, while
+/// different writers are encoded in parallel.
+///
+/// The buffers are a preallocated ring with a single producer and a single
+/// consumer, so the audio threads never lock or wait. Instead the export
+/// loop waits for room in the ring before rendering the next period.
+class StemWriter : public QRunnable
+{
+public:
+	/// Takes ownership of \p fileDev
+	StemWriter( AudioFileDevice * fileDev, QThreadPool * pool );
+	virtual ~StemWriter();
+
+	/// Queue one period of audio for encoding; NULL writes silence.
+	/// Never blocks, waitForSpace() has to be called before each period.
+	void write( const sampleFrame * buf );
+
+	/// Start encoding the queued buffers and wait until there is room for
+	/// one more period. Must not be called while a period is rendered.
+	void waitForSpace();
+
+	/// Wait until all queued buffers have been encoded
+	void finish();
+
+	AudioFileDevice * fileDevice()
+	{
+		return m_fileDev;
+	}
+
+	void run() override;
+
+
+private:
+	static const int MaxPendingBuffers = 64;
+
+	// start encoding unless the encoder is running, m_mutex must be held
+	void schedule();
+
+	AudioFileDevice * m_fileDev;
+	QThreadPool * m_pool;
+	const fpp_t m_frames;
+	sampleFrame * m_buffers;
+
+	// running counts of buffers written and encoded; they may wrap around
+	std::atomic<unsigned int> m_written;
+	std::atomic<unsigned int> m_encoded;
+
+	bool m_scheduled;
+	QMutex m_mutex;
+	QWaitCondition m_drained;
+
+} ;
+
+
+#endif
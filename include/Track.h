@@ -26,6 +26,8 @@
 #ifndef TRACK_H
 #define TRACK_H
 
+#include <atomic>
+
 #include <QtCore/QVector>
 #include <QtCore/QList>
 #include <QWidget>
@@ -607,6 +609,9 @@ public:
 	// -- for usage by TrackContentObject only ---------------
 	TrackContentObject * addTCO( TrackContentObject * tco );
 	void removeTCO( TrackContentObject * tco );
+	void updateTCOPosition( TrackContentObject * tco );
+	void updateTCOLength( TrackContentObject * tco,
+						const MidiTime & oldLength );
 	// -------------------------------------------------------
 	void deleteTCOs();
 
@@ -711,6 +716,27 @@ private:
 	bool m_simpleSerializingMode;
 
 	tcoVector m_trackContentObjects;
+	// the same TCOs sorted by start position for range queries, edited by
+	// the GUI thread only
+	tcoVector m_tcosByStart;
+	tick_t m_maxTCOLength;
+
+	struct TCOIndex
+	{
+		tcoVector tcos;
+		tick_t maxLength;
+	} ;
+	// immutable snapshot of m_tcosByStart queried by the audio threads
+	std::atomic<TCOIndex *> m_tcoIndex;
+	// set while adding or removing many TCOs, which get published at once
+	bool m_deferTCOIndex;
+
+	void updateMaxTCOLength();
+	//! Replace the index queried by the audio threads with a copy of
+	//! m_tcosByStart unless deferred, the old one gets retired
+	void publishTCOIndex();
+	void deferTCOIndex();
+	void endDeferTCOIndex();
 
 	QMutex m_processingLock;
 	
@@ -28,6 +28,8 @@
 
 #include <QtCore/QReadWriteLock>
 
+#include <functional>
+
 #include "Track.h"
 #include "JournallingObject.h"
 
@@ -55,6 +57,11 @@ public:
 
 	void loadSettings( const QDomElement & _this ) override;
 
+	//! Create tracks from the elements returned by @p nextTrack until it
+	//! returns a null element, optionally showing a progress dialog
+	void loadTracks( const std::function<QDomElement()> & nextTrack,
+						bool showProgress = true );
+
 
 	virtual AutomationPattern * tempoAutomationPattern()
 	{
@@ -35,6 +35,7 @@
 #include <QLayout>
 #include <QLabel>
 #include <QDomDocument>
+#include <QElapsedTimer>
 
 #include "ConfigManager.h"
 #include "endian_handling.h"
@@ -86,6 +87,8 @@ GigInstrument::GigInstrument( InstrumentTrack * _instrument_track ) :
 	m_patchNum( 0, 0, 127, this, tr( "Patch" ) ),
 	m_gain( 1.0f, 0.0f, 5.0f, 0.01f, this, tr( "Gain" ) ),
 	m_interpolation( SRC_LINEAR ),
+	// 4096 frames of two channels of 24 bit
+	m_rawBuffer( 4096 * 6 ),
 	m_RandomSeed( 0 ),
 	m_currentKeyDimension( 0 )
 {
@@ -186,14 +189,16 @@ void GigInstrument::freeInstance()
 
 	if( m_instance != NULL )
 	{
-		delete m_instance;
-		m_instance = NULL;
-
 		// If we're changing instruments, we got to make sure that we
 		// remove all pointers to the old samples and don't try accessing
-		// that instrument again
+		// that instrument again. Clearing the notes releases their streams,
+		// but the disk thread might still be reading from the file.
 		m_instrument = NULL;
 		m_notes.clear();
+
+		QMutexLocker diskLock( m_streamer.diskMutex() );
+		delete m_instance;
+		m_instance = NULL;
 	}
 }
 
@@ -327,6 +332,7 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 	// Initialize to zeros
 	std::memset( &_working_buffer[0][0], 0, DEFAULT_CHANNELS * frames * sizeof( float ) );
 
+	// Only held briefly, new instruments are preloaded without it
 	m_synthMutex.lock();
 	m_notesMutex.lock();
 
@@ -422,6 +428,14 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 				continue;
 			}
 
+			// A voice that found all streams in use tries again until it
+			// has played its preloaded head
+			if( sample->stream == NULL && sample->pos < sample->headFrames &&
+					sample->headFrames < sample->endFrame() )
+			{
+				openStream( *sample );
+			}
+
 			// Will change if resampling
 			bool resample = false;
 			f_cnt_t samples = frames; // How many to grab
@@ -489,6 +503,10 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 			}
 
 			// Update note position with how many samples we actually used
+			if( sample->stream != NULL )
+			{
+				sample->stream->consume( sample->streamedFrames( sample->pos, used ) );
+			}
 			sample->pos += used;
 			sample->adsr.inc( used );
 		}
@@ -517,128 +535,90 @@ void GigInstrument::loadSample( GigSample& sample, sampleFrame* sampleData, f_cn
 		return;
 	}
 
-	// Determine if we need to loop part of this sample
-	bool loop = false;
-	gig::loop_type_t loopType = gig::loop_type_normal;
-	f_cnt_t loopStart = 0;
-	f_cnt_t loopLength = 0;
+	const f_cnt_t frameSize = sample.sample->FrameSize;
 
-	if( sample.region->pSampleLoops != NULL )
+	// Calculate the new position based on the type of loop
+	if( sample.loop == true )
 	{
-		for( uint32_t i = 0; i < sample.region->SampleLoops; ++i )
+		if( sample.loopType == gig::loop_type_bidirectional )
 		{
-			loop = true;
-			loopType = static_cast<gig::loop_type_t>( sample.region->pSampleLoops[i].LoopType );
-			loopStart = sample.region->pSampleLoops[i].LoopStart;
-			loopLength = sample.region->pSampleLoops[i].LoopLength;
-
-			// Currently only support at max one loop
-			break;
-		}
-	}
-
-	unsigned long allocationsize = samples * sample.sample->FrameSize;
-	int8_t buffer[allocationsize];
-
-	// Load the sample in different ways depending on if we're looping or not
-	if( loop == true && ( sample.pos >= loopStart || sample.pos + samples > loopStart ) )
-	{
-		// Calculate the new position based on the type of loop
-		if( loopType == gig::loop_type_bidirectional )
-		{
-			sample.pos = getPingPongIndex( sample.pos, loopStart, loopStart + loopLength );
+			sample.pos = getPingPongIndex( sample.pos, sample.loopStart, sample.loopEnd );
 		}
 		else
 		{
-			sample.pos = getLoopedIndex( sample.pos, loopStart, loopStart + loopLength );
+			sample.pos = getLoopedIndex( sample.pos, sample.loopStart, sample.loopEnd );
 			// TODO: also implement loop_type_backward support
 		}
+	}
 
-		sample.sample->SetPos( sample.pos );
-
-		// Load the samples (based on gig::Sample::ReadAndLoop) even around the end
-		// of a loop boundary wrapping to the beginning of the loop region
-		long samplestoread = samples;
-		long samplestoloopend = 0;
-		long readsamples = 0;
-		long totalreadsamples = 0;
-		long loopEnd = loopStart + loopLength;
-
-		do
-		{
-			samplestoloopend = loopEnd - sample.sample->GetPos();
-			readsamples = sample.sample->Read( &buffer[totalreadsamples * sample.sample->FrameSize],
-					min( samplestoread, samplestoloopend ) );
-			samplestoread -= readsamples;
-			totalreadsamples += readsamples;
+	// See how much of what we need the disk thread has streamed already.
+	// When exporting we can afford to wait for it.
+	const f_cnt_t streamed = sample.streamedFrames( sample.pos, samples );
+	f_cnt_t available = sample.stream != NULL ? sample.stream->available() : 0;
 
-			if( readsamples >= samplestoloopend )
-			{
-				sample.sample->SetPos( loopStart );
-			}
-		}
-		while( samplestoread > 0 && readsamples > 0 );
-	}
-	else
+	if( sample.stream != NULL && available < streamed &&
+			Engine::getSong()->isExporting() )
 	{
-		sample.sample->SetPos( sample.pos );
-
-		unsigned long size = sample.sample->Read( &buffer, samples ) * sample.sample->FrameSize;
-		std::memset( (int8_t*) &buffer + size, 0, allocationsize - size );
+		available = m_streamer.waitFor( *sample.stream, streamed );
 	}
 
-	// Convert from 16 or 24 bit into 32-bit float
-	if( sample.sample->BitDepth == 24 ) // 24 bit
+	if( available < streamed )
 	{
-		uint8_t * pInt = reinterpret_cast<uint8_t*>( &buffer );
+		m_streamer.addUnderrun();
+	}
 
-		for( f_cnt_t i = 0; i < samples; ++i )
+	// Gather the frames from the preloaded head and the stream (based on
+	// gig::Sample::ReadAndLoop) even around the end of a loop boundary
+	// wrapping to the beginning of the loop region. The head is converted
+	// in place, streamed frames are copied out of the ring in chunks that
+	// fit into the raw buffer.
+	const int8_t * head = static_cast<const int8_t *>( sample.sample->GetCache().pStart );
+	int8_t * buffer = m_rawBuffer.data();
+	const f_cnt_t bufferFrames = m_rawBuffer.size() / frameSize;
+	const f_cnt_t end = sample.endFrame();
+	f_cnt_t pos = sample.pos;
+	f_cnt_t streamPos = 0;
+
+	for( f_cnt_t i = 0; i < samples; )
+	{
+		if( sample.loop == true && pos >= sample.loopEnd )
 		{
-			// libgig gives 24-bit data as little endian, so we must
-			// convert if on a big endian system
-			int32_t valueLeft = swap32IfBE(
-						( pInt[ 3 * sample.sample->Channels * i ] << 8 ) |
-						( pInt[ 3 * sample.sample->Channels * i + 1 ] << 16 ) |
-						( pInt[ 3 * sample.sample->Channels * i + 2 ] << 24 ) );
+			pos = sample.loopStart;
+		}
+		else if( pos >= end )
+		{
+			// Past the end of a sample that isn't looped
+			std::memset( &sampleData[i], 0, ( samples - i ) * sizeof( sampleFrame ) );
+			break;
+		}
 
-			// Store the notes to this buffer before saving to output
-			// so we can fade them out as needed
-			sampleData[i][0] = 1.0 / 0x100000000 * sample.attenuation * valueLeft;
+		f_cnt_t count = qMin( samples - i, end - pos );
 
-			if( sample.sample->Channels == 1 )
-			{
-				sampleData[i][1] = sampleData[i][0];
-			}
-			else
-			{
-				int32_t valueRight = swap32IfBE(
-							( pInt[ 3 * sample.sample->Channels * i + 3 ] << 8 ) |
-							( pInt[ 3 * sample.sample->Channels * i + 4 ] << 16 ) |
-							( pInt[ 3 * sample.sample->Channels * i + 5 ] << 24 ) );
-
-				sampleData[i][1] = 1.0 / 0x100000000 * sample.attenuation * valueRight;
-			}
+		if( pos < sample.headFrames )
+		{
+			count = qMin( count, sample.headFrames - pos );
+			sample.convert( &head[pos * frameSize], &sampleData[i], count );
 		}
-	}
-	else // 16 bit
-	{
-		int16_t * pInt = reinterpret_cast<int16_t*>( &buffer );
-
-		for( f_cnt_t i = 0; i < samples; ++i )
+		else
 		{
-			sampleData[i][0] = 1.0 / 0x10000 *
-				pInt[ sample.sample->Channels * i ] * sample.attenuation;
+			count = qMin( count, bufferFrames );
 
-			if( sample.sample->Channels == 1 )
-			{
-				sampleData[i][1] = sampleData[i][0];
-			}
-			else
+			// Use silence for what the disk thread didn't manage to read
+			const f_cnt_t ready = streamPos < available ?
+						qMin( count, available - streamPos ) : 0;
+
+			if( ready > 0 )
 			{
-				sampleData[i][1] = 1.0 / 0x10000 *
-					pInt[ sample.sample->Channels * i + 1 ] * sample.attenuation;
+				sample.stream->peek( buffer, streamPos, ready );
+				sample.convert( buffer, &sampleData[i], ready );
 			}
+			std::memset( &sampleData[i + ready], 0, ( count - ready ) * sizeof( sampleFrame ) );
+
+			streamPos += count;
 		}
+
+		i += count;
+		pos += count;
 	}
 }
 
@@ -774,6 +754,13 @@ void GigInstrument::addSamples( GigNote & gignote, bool wantReleaseSample )
 
 				gignote.samples.push_back( GigSample( pSample, pDimRegion,
 							attenuation, m_interpolation, gignote.frequency ) );
+
+				// Stream whatever isn't preloaded
+				GigSample & added = gignote.samples.last();
+				if( added.headFrames < added.endFrame() )
+				{
+					openStream( added );
+				}
 			}
 		}
 
@@ -784,6 +771,39 @@ void GigInstrument::addSamples( GigNote & gignote, bool wantReleaseSample )
 
 
 
+void GigInstrument::openStream( GigSample & sample )
+{
+	sample.stream = m_streamer.open( sample );
+
+	// Steal one stream at a time, the voice tries again next period
+	if( sample.stream != NULL || m_streamer.freeing() )
+	{
+		return;
+	}
+
+	// Notes are appended, so the first one with a stream is the oldest
+	for( QList<GigNote>::iterator it = m_notes.begin(); it != m_notes.end(); ++it )
+	{
+		for( QList<GigSample>::iterator victim = it->samples.begin();
+				victim != it->samples.end(); ++victim )
+		{
+			if( victim->stream != NULL )
+			{
+				// Stopped rather than played with silence after its
+				// head, it's deleted in the next period
+				victim->stream->state = GigStream::Releasing;
+				victim->stream = NULL;
+				victim->sample = NULL;
+				m_streamer.wake();
+				return;
+			}
+		}
+	}
+}
+
+
+
+
 // Based on our input parameters, generate a "dimension" that specifies which
 // note we wish to select from the GIG file with libgig. libgig will use this
 // information to select the sample.
@@ -871,11 +891,17 @@ void GigInstrument::getInstrument()
 	int iBankSelected = m_bankNum.value();
 	int iProgSelected = m_patchNum.value();
 
-	QMutexLocker locker( &m_synthMutex );
+	gig::Instrument * pInstrument = NULL;
 
-	if( m_instance != NULL )
 	{
-		gig::Instrument * pInstrument = m_instance->gig.GetFirstInstrument();
+		QMutexLocker locker( &m_synthMutex );
+
+		if( m_instance == NULL )
+		{
+			return;
+		}
+
+		pInstrument = m_instance->gig.GetFirstInstrument();
 
 		while( pInstrument != NULL )
 		{
@@ -889,9 +915,19 @@ void GigInstrument::getInstrument()
 
 			pInstrument = m_instance->gig.GetNextInstrument();
 		}
+	}
 
-		m_instrument = pInstrument;
+	// Preload without holding the lock, so play() keeps playing the
+	// previous instrument in the meantime. The GIG file can't be freed
+	// meanwhile, as openFile() runs on this thread as well. The current
+	// instrument is preloaded already, and play() iterates its regions.
+	if( pInstrument != NULL && pInstrument != m_instrument )
+	{
+		m_streamer.preload( pInstrument, &m_synthMutex );
 	}
+
+	QMutexLocker locker( &m_synthMutex );
+	m_instrument = pInstrument;
 }
 
 
@@ -1101,11 +1137,26 @@ void GigInstrumentView::showPatchDialog()
 GigSample::GigSample( gig::Sample * pSample, gig::DimensionRegion * pDimRegion,
 		float attenuation, int interpolation, float desiredFreq )
 	: sample( pSample ), region( pDimRegion ), attenuation( attenuation ),
-	  pos( 0 ), interpolation( interpolation ), srcState( NULL ),
+	  pos( 0 ), loop( false ), loopType( gig::loop_type_normal ),
+	  loopStart( 0 ), loopEnd( 0 ), headFrames( 0 ), stream( NULL ),
+	  interpolation( interpolation ), srcState( NULL ),
 	  sampleFreq( 0 ), freqFactor( 1 )
 {
 	if( sample != NULL && region != NULL )
 	{
+		// Determine if we need to loop part of this sample. Currently only
+		// support at max one loop.
+		if( region->pSampleLoops != NULL && region->SampleLoops > 0 &&
+				region->pSampleLoops[0].LoopLength > 0 )
+		{
+			loop = true;
+			loopType = static_cast<gig::loop_type_t>( region->pSampleLoops[0].LoopType );
+			loopStart = region->pSampleLoops[0].LoopStart;
+			loopEnd = loopStart + region->pSampleLoops[0].LoopLength;
+		}
+
+		headFrames = sample->GetCache().Size / sample->FrameSize;
+
 		// Note: we don't create the libsamplerate object here since we always
 		// also call the copy constructor when appending to the end of the
 		// QList. We'll create it only in the copy constructor so we only have
@@ -1138,6 +1189,11 @@ GigSample::~GigSample()
 	{
 		src_delete( srcState );
 	}
+
+	if( stream != NULL )
+	{
+		stream->state = GigStream::Releasing;
+	}
 }
 
 
@@ -1145,7 +1201,9 @@ GigSample::~GigSample()
 
 GigSample::GigSample( const GigSample& g )
 	: sample( g.sample ), region( g.region ), attenuation( g.attenuation ),
-	  adsr( g.adsr ), pos( g.pos ), interpolation( g.interpolation ),
+	  adsr( g.adsr ), pos( g.pos ), loop( g.loop ), loopType( g.loopType ),
+	  loopStart( g.loopStart ), loopEnd( g.loopEnd ), headFrames( g.headFrames ),
+	  stream( NULL ), interpolation( g.interpolation ),
 	  srcState( NULL ), sampleFreq( g.sampleFreq ), freqFactor( g.freqFactor )
 {
 	// On the copy, we want to create the object
@@ -1162,7 +1220,18 @@ GigSample& GigSample::operator=( const GigSample& g )
 	attenuation = g.attenuation;
 	adsr = g.adsr;
 	pos = g.pos;
+	loop = g.loop;
+	loopType = g.loopType;
+	loopStart = g.loopStart;
+	loopEnd = g.loopEnd;
+	headFrames = g.headFrames;
 	interpolation = g.interpolation;
+
+	if( stream != NULL )
+	{
+		stream->state = GigStream::Releasing;
+		stream = NULL;
+	}
 	srcState = NULL;
 	sampleFreq = g.sampleFreq;
 	freqFactor = g.freqFactor;
@@ -1244,6 +1313,447 @@ bool GigSample::convertSampleRate( sampleFrame & oldBuf, sampleFrame & newBuf,
 
 
 
+f_cnt_t GigSample::streamedFrames( f_cnt_t pos, f_cnt_t count ) const
+{
+	const f_cnt_t end = endFrame();
+	f_cnt_t streamed = 0;
+
+	while( count > 0 )
+	{
+		if( loop == true && pos >= loopEnd )
+		{
+			pos = loopStart;
+		}
+		else if( pos >= end )
+		{
+			break;
+		}
+
+		const f_cnt_t n = qMin( count, end - pos );
+
+		if( pos + n > headFrames )
+		{
+			streamed += pos + n - qMax( pos, headFrames );
+		}
+
+		count -= n;
+		pos += n;
+	}
+
+	return streamed;
+}
+
+
+
+
+void GigSample::convert( const int8_t * raw, sampleFrame * dst, f_cnt_t frames ) const
+{
+	// Convert from 16 or 24 bit into 32-bit float
+	if( sample->BitDepth == 24 ) // 24 bit
+	{
+		const uint8_t * pInt = reinterpret_cast<const uint8_t*>( raw );
+
+		for( f_cnt_t i = 0; i < frames; ++i )
+		{
+			// libgig gives 24-bit data as little endian, so we must
+			// convert if on a big endian system
+			int32_t valueLeft = swap32IfBE(
+						( pInt[ 3 * sample->Channels * i ] << 8 ) |
+						( pInt[ 3 * sample->Channels * i + 1 ] << 16 ) |
+						( pInt[ 3 * sample->Channels * i + 2 ] << 24 ) );
+
+			// Store the notes to this buffer before saving to output
+			// so we can fade them out as needed
+			dst[i][0] = 1.0 / 0x100000000 * attenuation * valueLeft;
+
+			if( sample->Channels == 1 )
+			{
+				dst[i][1] = dst[i][0];
+			}
+			else
+			{
+				int32_t valueRight = swap32IfBE(
+							( pInt[ 3 * sample->Channels * i + 3 ] << 8 ) |
+							( pInt[ 3 * sample->Channels * i + 4 ] << 16 ) |
+							( pInt[ 3 * sample->Channels * i + 5 ] << 24 ) );
+
+				dst[i][1] = 1.0 / 0x100000000 * attenuation * valueRight;
+			}
+		}
+	}
+	else // 16 bit
+	{
+		const int16_t * pInt = reinterpret_cast<const int16_t*>( raw );
+
+		for( f_cnt_t i = 0; i < frames; ++i )
+		{
+			dst[i][0] = 1.0 / 0x10000 *
+				pInt[ sample->Channels * i ] * attenuation;
+
+			if( sample->Channels == 1 )
+			{
+				dst[i][1] = dst[i][0];
+			}
+			else
+			{
+				dst[i][1] = 1.0 / 0x10000 *
+					pInt[ sample->Channels * i + 1 ] * attenuation;
+			}
+		}
+	}
+}
+
+
+
+
+GigStream::GigStream() :
+	state( Free ),
+	sample( NULL ),
+	headFrames( 0 ),
+	loop( false ),
+	loopStart( 0 ),
+	loopEnd( 0 ),
+	endFrame( 0 ),
+	buffer( NULL ),
+	capacity( 0 ),
+	written( 0 ),
+	read( 0 ),
+	filePos( 0 )
+{
+}
+
+
+
+
+GigStream::~GigStream()
+{
+	delete[] buffer;
+}
+
+
+
+
+f_cnt_t GigStream::available() const
+{
+	const qint64 w = written.load( std::memory_order_acquire );
+	const qint64 r = read.load( std::memory_order_relaxed );
+
+	return w > r ? w - r : 0;
+}
+
+
+
+
+void GigStream::peek( int8_t * dst, f_cnt_t offset, f_cnt_t frames ) const
+{
+	const int frameSize = sample->FrameSize;
+	const f_cnt_t start = ( read.load( std::memory_order_relaxed ) + offset ) % capacity;
+	const f_cnt_t first = qMin( frames, capacity - start );
+
+	std::memcpy( dst, &buffer[start * frameSize], first * frameSize );
+	std::memcpy( &dst[first * frameSize], buffer, ( frames - first ) * frameSize );
+}
+
+
+
+
+void GigStream::consume( f_cnt_t frames )
+{
+	read.fetch_add( frames, std::memory_order_release );
+}
+
+
+
+
+f_cnt_t GigStream::advance( f_cnt_t pos, qint64 frames ) const
+{
+	if( pos + frames < endFrame )
+	{
+		return pos + frames;
+	}
+
+	if( loop == false )
+	{
+		return endFrame;
+	}
+
+	// The part of the loop that's preloaded isn't streamed
+	const f_cnt_t restart = qMax( loopStart, headFrames );
+	frames -= endFrame - pos;
+
+	return restart + frames % ( endFrame - restart );
+}
+
+
+
+
+GigStreamer::GigStreamer() :
+	m_preloadFrames( ConfigManager::inst()->value( "gigplayer", "preloadframes", "32768" ).toInt() ),
+	m_quit( false ),
+	m_underruns( 0 )
+{
+	// The ring buffers need to hold at least a few periods
+	m_preloadFrames = qMax<f_cnt_t>( m_preloadFrames, 4096 );
+}
+
+
+
+
+GigStreamer::~GigStreamer()
+{
+	m_quit = true;
+	wake();
+	wait();
+}
+
+
+
+
+void GigStreamer::preload( gig::Instrument * instrument, QMutex * synthMutex )
+{
+	if( !isRunning() )
+	{
+		start( QThread::HighPriority );
+	}
+
+	try
+	{
+		for( gig::Region * region = instrument->GetFirstRegion(); region != NULL;
+				region = instrument->GetNextRegion() )
+		{
+			for( uint32_t i = 0; i < region->DimensionRegions; ++i )
+			{
+				gig::DimensionRegion * dimRegion = region->pDimensionRegions[i];
+				gig::Sample * sample = dimRegion->pSample;
+
+				if( sample == NULL || sample->SamplesTotal == 0 )
+				{
+					continue;
+				}
+
+				const bool pingPong = dimRegion->pSampleLoops != NULL &&
+					dimRegion->SampleLoops > 0 &&
+					dimRegion->pSampleLoops[0].LoopType == gig::loop_type_bidirectional;
+				const unsigned long frames = pingPong ? sample->SamplesTotal :
+					qMin<unsigned long>( sample->SamplesTotal, m_preloadFrames );
+
+				// Samples are shared between regions and instruments, and
+				// might be loaded already. Locked for each sample only, so
+				// the streams of playing voices are refilled in between.
+				const unsigned long cached = sample->GetCache().Size;
+				if( cached >= frames * sample->FrameSize )
+				{
+					continue;
+				}
+
+				// Reloading reallocates the cache that voices read their
+				// head from. Only samples with a head are read by them,
+				// and this is rare: a sample used both with and without
+				// a bidirectional loop.
+				QMutexLocker synthLock( cached > 0 ? synthMutex : NULL );
+				QMutexLocker diskLock( &m_diskMutex );
+				sample->LoadSampleData( frames );
+			}
+		}
+	}
+	catch( ... )
+	{
+		qWarning( "GigInstrument: could not preload samples" );
+	}
+}
+
+
+
+
+GigStream * GigStreamer::open( const GigSample & sample )
+{
+	for( int i = 0; i < MaxStreams; ++i )
+	{
+		GigStream & stream = m_streams[i];
+		int expected = GigStream::Free;
+
+		if( stream.state.compare_exchange_strong( expected, GigStream::Starting ) )
+		{
+			stream.sample = sample.sample;
+			stream.headFrames = sample.headFrames;
+			stream.loop = sample.loop;
+			stream.loopStart = sample.loopStart;
+			stream.loopEnd = sample.loopEnd;
+			stream.endFrame = sample.endFrame();
+			stream.capacity = m_preloadFrames;
+			stream.written = 0;
+			stream.read = 0;
+			stream.filePos = sample.headFrames;
+
+			stream.state.store( GigStream::Active, std::memory_order_release );
+			wake();
+
+			return &stream;
+		}
+	}
+
+	return NULL;
+}
+
+
+
+
+bool GigStreamer::freeing() const
+{
+	for( int i = 0; i < MaxStreams; ++i )
+	{
+		if( m_streams[i].state == GigStream::Releasing )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+
+
+f_cnt_t GigStreamer::waitFor( const GigStream & stream, f_cnt_t frames )
+{
+	// The disk thread stops refilling once the ring is almost full
+	frames = qMin( frames, stream.capacity - stream.capacity / 8 );
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QMutexLocker filledLock( &m_filledMutex );
+	wake();
+
+	f_cnt_t available = stream.available();
+	while( available < frames && !timer.hasExpired( 1000 ) )
+	{
+		m_filled.wait( &m_filledMutex, 100 );
+		available = stream.available();
+	}
+
+	return available;
+}
+
+
+
+
+void GigStreamer::run()
+{
+	int reportedUnderruns = 0;
+
+	while( !m_quit )
+	{
+		bool busy = false;
+
+		for( int i = 0; i < MaxStreams; ++i )
+		{
+			GigStream & stream = m_streams[i];
+
+			if( stream.state == GigStream::Releasing )
+			{
+				stream.state = GigStream::Free;
+			}
+			else if( stream.state == GigStream::Active )
+			{
+				// Only as many ring buffers are allocated as voices
+				// were streamed at the same time, largest frame: two
+				// channels of 24 bit
+				if( stream.buffer == NULL )
+				{
+					stream.buffer = new int8_t[m_preloadFrames * 6];
+				}
+				busy = refill( stream ) || busy;
+			}
+		}
+
+		const int underruns = m_underruns;
+		if( underruns != reportedUnderruns )
+		{
+			qWarning( "GigInstrument: %d disk stream underruns", underruns );
+			reportedUnderruns = underruns;
+		}
+
+		// Sleep until a voice starts, but check for ended voices regularly
+		if( !busy )
+		{
+			QMutexLocker wakeLock( &m_wakeMutex );
+			if( !m_quit )
+			{
+				m_wake.wait( &m_wakeMutex, 10 );
+			}
+		}
+	}
+}
+
+
+
+
+bool GigStreamer::refill( GigStream & stream )
+{
+	QMutexLocker diskLock( &m_diskMutex );
+
+	// The voice may have ended and the file been freed in the meantime
+	if( stream.state.load( std::memory_order_acquire ) != GigStream::Active )
+	{
+		return false;
+	}
+
+	qint64 written = stream.written.load( std::memory_order_relaxed );
+	const qint64 read = stream.read.load( std::memory_order_acquire );
+
+	// Skip what the voice played as silence after an underrun
+	if( read > written )
+	{
+		stream.filePos = stream.advance( stream.filePos, read - written );
+		written = read;
+		stream.written.store( written, std::memory_order_release );
+	}
+
+	// Read in chunks so all the voices get their turn, and don't bother
+	// with small ones
+	const f_cnt_t space = stream.capacity - ( written - read );
+	if( space < stream.capacity / 8 || stream.filePos >= stream.endFrame )
+	{
+		return false;
+	}
+
+	const int frameSize = stream.sample->FrameSize;
+	f_cnt_t toRead = qMin( space, stream.capacity / 4 );
+
+	while( toRead > 0 && stream.filePos < stream.endFrame )
+	{
+		const f_cnt_t index = written % stream.capacity;
+		const f_cnt_t count = qMin( qMin( toRead, stream.endFrame - stream.filePos ),
+						stream.capacity - index );
+
+		stream.sample->SetPos( stream.filePos );
+		const f_cnt_t got = stream.sample->Read( &stream.buffer[index * frameSize], count );
+
+		if( got <= 0 )
+		{
+			// Truncated file, nothing more to stream
+			stream.filePos = stream.endFrame;
+			break;
+		}
+
+		toRead -= got;
+		written += got;
+		stream.filePos = stream.advance( stream.filePos, got );
+	}
+
+	stream.written.store( written, std::memory_order_release );
+
+	// Let an exporting audio thread waiting in waitFor() continue
+	QMutexLocker filledLock( &m_filledMutex );
+	m_filled.wakeAll();
+
+	return true;
+}
+
+
+
+
 ADSR::ADSR()
 	: preattack( 0 ), attack( 0 ), decay1( 0 ), decay2( 0 ), infiniteSustain( false ),
 	  sustain( 0 ), release( 0 ),
@@ -30,8 +30,13 @@
 #include <QList>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
 #include <samplerate.h>
 
+#include <atomic>
+#include <vector>
+
 #include "Instrument.h"
 #include "PixmapButton.h"
 #include "InstrumentView.h"
@@ -42,6 +47,7 @@
 #include "gig.h"
 
 class GigInstrumentView;
+class GigStream;
 class NotePlayHandle;
 
 class PatchesDialog;
@@ -151,6 +157,20 @@ public:
 	bool convertSampleRate( sampleFrame & oldBuf, sampleFrame & newBuf,
 		f_cnt_t oldSize, f_cnt_t newSize, float freq_factor, f_cnt_t& used );
 
+	// Where reading the sample ends or wraps around to the loop start
+	f_cnt_t endFrame() const
+	{
+		return loop ? loopEnd : sample->SamplesTotal;
+	}
+
+	// How many of the count frames read starting at pos are not in the
+	// preloaded head and have to come from the disk stream
+	f_cnt_t streamedFrames( f_cnt_t pos, f_cnt_t count ) const;
+
+	// Convert frames of raw 16 or 24 bit data from the GIG file to floats,
+	// applying the attenuation
+	void convert( const int8_t * raw, sampleFrame * dst, f_cnt_t frames ) const;
+
 	gig::Sample * sample;
 	gig::DimensionRegion * region;
 	float attenuation;
@@ -159,6 +179,21 @@ public:
 	// The position in sample
 	f_cnt_t pos;
 
+	// The loop of the region, we currently support at most one
+	bool loop;
+	gig::loop_type_t loopType;
+	f_cnt_t loopStart;
+	f_cnt_t loopEnd;
+
+	// Frames at the beginning of the sample that are preloaded in RAM
+	f_cnt_t headFrames;
+
+	// Ring buffer the rest of the sample is streamed into, NULL if the
+	// sample is entirely in RAM or no stream is free yet. Streams aren't
+	// copied along with the sample, they are attached once the sample is
+	// in the note's list.
+	GigStream * stream;
+
 	// Whether to change the pitch of the samples, e.g. if there's only one
 	// sample per octave and you want that sample pitch shifted for the rest of
 	// the notes in the octave, this will be true
@@ -223,6 +258,143 @@ public:
 
 
 
+// Ring buffer for one voice, which the disk thread keeps filled with the part
+// of the sample following the preloaded head. Frames are stored in the
+// order they're played, i.e. wrapping around at the end of the loop, and as
+// raw data from the GIG file.
+class GigStream
+{
+public:
+	enum States
+	{
+		Free,
+		Starting, // being set up by the audio thread
+		Active,
+		Releasing // voice ended, the disk thread will free the stream
+	} ;
+
+	GigStream();
+	~GigStream();
+
+	// Audio thread: number of frames ready to be read
+	f_cnt_t available() const;
+
+	// Audio thread: copy frames starting offset frames after the read
+	// position without consuming them
+	void peek( int8_t * dst, f_cnt_t offset, f_cnt_t frames ) const;
+
+	// Audio thread: drop frames, even if they haven't been streamed yet, in
+	// which case the disk thread skips them
+	void consume( f_cnt_t frames );
+
+	// Disk thread: position in the sample that is frames streamed frames
+	// after pos
+	f_cnt_t advance( f_cnt_t pos, qint64 frames ) const;
+
+	std::atomic_int state;
+
+	gig::Sample * sample;
+	f_cnt_t headFrames;
+	bool loop;
+	f_cnt_t loopStart;
+	f_cnt_t loopEnd;
+	f_cnt_t endFrame;
+
+	// Allocated by the disk thread when the stream is used the first time
+	int8_t * buffer;
+	f_cnt_t capacity;
+
+	// Total number of frames written and read, the difference being the
+	// frames in the buffer
+	std::atomic<qint64> written;
+	std::atomic<qint64> read;
+
+	// Only used by the disk thread: next position to read from the sample
+	f_cnt_t filePos;
+} ;
+
+
+
+
+// The disk thread of a GigInstrument. It preloads the beginning of every
+// sample of the selected instrument and then streams the rest of the samples
+// of the playing voices, so that the audio threads never have to wait for
+// disk I/O.
+class GigStreamer : public QThread
+{
+public:
+	GigStreamer();
+	virtual ~GigStreamer();
+
+	// Load the heads of all samples of the instrument into RAM and start
+	// the disk thread if needed. Samples with bidirectional loops are loaded
+	// entirely since they can jump back anywhere in the loop. The streams
+	// keep being refilled in between. Samples that are cached partly already
+	// may be played by voices of the previous instrument, so these are only
+	// reloaded while holding synthMutex, which play() holds as well.
+	void preload( gig::Instrument * instrument, QMutex * synthMutex );
+
+	// Get a stream for the rest of the sample, NULL if all are in use
+	GigStream * open( const GigSample & sample );
+
+	// Whether a released stream hasn't been freed by the disk thread yet
+	bool freeing() const;
+
+	// Audio thread, when exporting: wait until frames can be read from the
+	// stream, but at most a second. Returns the frames available.
+	f_cnt_t waitFor( const GigStream & stream, f_cnt_t frames );
+
+	// Ask the disk thread to refill the streams right away
+	void wake()
+	{
+		m_wake.wakeAll();
+	}
+
+	// Voices that didn't get their data in time (or no stream at all)
+	int underruns() const
+	{
+		return m_underruns;
+	}
+
+	void addUnderrun()
+	{
+		++m_underruns;
+	}
+
+	// Held while reading from the GIG file, so lock this before freeing it
+	QMutex * diskMutex()
+	{
+		return &m_diskMutex;
+	}
+
+	static const int MaxStreams = 64;
+
+private:
+	virtual void run();
+
+	// Read the next chunk of the stream's sample, returns false if there
+	// was nothing to do
+	bool refill( GigStream & stream );
+
+	// Number of frames kept in RAM for each sample, also the size of the
+	// ring buffers, from the "gigplayer/preloadframes" setting
+	f_cnt_t m_preloadFrames;
+
+	GigStream m_streams[MaxStreams];
+
+	QMutex m_diskMutex;
+	QMutex m_wakeMutex;
+	QWaitCondition m_wake;
+	// Signalled whenever a stream was refilled, see waitFor()
+	QMutex m_filledMutex;
+	QWaitCondition m_filled;
+	std::atomic_bool m_quit;
+	std::atomic_int m_underruns;
+} ;
+
+
+
+
 class GigInstrument : public Instrument
 {
 	Q_OBJECT
@@ -298,6 +470,13 @@ private:
 	// List of all the currently playing notes
 	QList<GigNote> m_notes;
 
+	// Streams the samples from disk
+	GigStreamer m_streamer;
+
+	// Raw data copied out of a stream by loadSample(), before converting
+	// to floats. Allocated once, longer reads are converted in chunks.
+	std::vector<int8_t> m_rawBuffer;
+
 	// Used when determining which samples to use
 	uint32_t m_RandomSeed;
 	float m_currentKeyDimension;
@@ -315,6 +494,11 @@ private:
 
 	// Load sample data from the Gig file, looping the sample where needed
 	void loadSample( GigSample& sample, sampleFrame* sampleData, f_cnt_t samples );
+
+	// Attach a disk stream to the sample. If all are in use, the oldest
+	// voice with a stream is stopped, and its stream can be used once the
+	// disk thread has freed it.
+	void openStream( GigSample & sample );
 	f_cnt_t getLoopedIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const;
 	f_cnt_t getPingPongIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const;
 
@@ -124,6 +124,14 @@ bool VstEffect::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames )
 
 
 
+f_cnt_t VstEffect::latency() const
+{
+	return m_plugin ? m_plugin->latency() : 0;
+}
+
+
+
+
 void VstEffect::openPlugin( const QString & _plugin )
 {
 	TextFloat * tf = NULL;
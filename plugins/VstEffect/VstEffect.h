@@ -44,6 +44,8 @@ public:
 	virtual bool processAudioBuffer( sampleFrame * _buf,
 							const fpp_t _frames );
 
+	virtual f_cnt_t latency() const;
+
 	virtual EffectControls * controls()
 	{
 		return &m_vstControls;
@@ -758,6 +758,9 @@ AudioFileProcessorWaveView::AudioFileProcessorWaveView( QWidget * _parent, int _
 	m_graph.fill( Qt::transparent );
 	update();
 	updateCursor();
+
+	connect( &m_sampleBuffer, SIGNAL( peaksUpdated() ),
+					this, SLOT( peaksUpdated() ) );
 }
 
 
@@ -772,6 +775,16 @@ void AudioFileProcessorWaveView::isPlaying( f_cnt_t _current_frame )
 
 
 
+void AudioFileProcessorWaveView::peaksUpdated()
+{
+	// redraw the graph although the range didn't change
+	m_last_to = -1;
+	update();
+}
+
+
+
+
 void AudioFileProcessorWaveView::enterEvent( QEvent * _e )
 {
 	updateCursor();
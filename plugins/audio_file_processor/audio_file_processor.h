@@ -223,6 +223,9 @@ public slots:
 
 	void isPlaying( f_cnt_t _current_frame );
 
+private slots:
+	void peaksUpdated();
+
 
 private:
 	static const int s_padding = 2;
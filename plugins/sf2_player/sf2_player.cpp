@@ -25,15 +25,19 @@
 
 #include "sf2_player.h"
 
+#include <memory>
+
 #include <QDebug>
 #include <QLayout>
 #include <QLabel>
 #include <QDomDocument>
 
+#include "AssetLoader.h"
 #include "ConfigManager.h"
 #include "FileDialog.h"
 #include "ConfigManager.h"
 #include "Engine.h"
+#include "GuiApplication.h"
 #include "InstrumentTrack.h"
 #include "InstrumentPlayHandle.h"
 #include "Knob.h"
@@ -82,6 +86,61 @@ struct SF2PluginData
 
 
 
+// A soundfont parsed by a loader thread into a synth of its own, as the
+// synth of the instrument is rendering meanwhile. Like in
+// sf2Instrument::updateSampleRate(), the font is moved to the synth of the
+// instrument afterwards.
+class sf2LoadedFont
+{
+public:
+	sf2LoadedFont() :
+		m_settings( NULL ),
+		m_synth( NULL ),
+		m_font( NULL )
+	{
+	}
+
+	~sf2LoadedFont()
+	{
+		if( m_synth != NULL )
+		{
+			// also deletes the font, unless it was taken
+			delete_fluid_synth( m_synth );
+			delete_fluid_settings( m_settings );
+		}
+	}
+
+	void load( const QString & file )
+	{
+		m_settings = new_fluid_settings();
+		m_synth = new_fluid_synth( m_settings );
+		if( fluid_synth_sfload( m_synth, qPrintable( file ), true ) >= 0 &&
+					fluid_synth_sfcount( m_synth ) > 0 )
+		{
+			m_font = fluid_synth_get_sfont( m_synth, 0 );
+		}
+	}
+
+	fluid_sfont_t * take()
+	{
+		fluid_sfont_t * font = m_font;
+		if( font != NULL )
+		{
+			fluid_synth_remove_sfont( m_synth, font );
+			m_font = NULL;
+		}
+		return font;
+	}
+
+private:
+	fluid_settings_t * m_settings;
+	fluid_synth_t * m_synth;
+	fluid_sfont_t * m_font;
+
+} ;
+
+
+
 // Static map of current sfonts
 QMap<QString, sf2Font*> sf2Instrument::s_fonts;
 QMutex sf2Instrument::s_fontsMutex;
@@ -94,6 +153,7 @@ sf2Instrument::sf2Instrument( InstrumentTrack * _instrument_track ) :
 	m_font( NULL ),
 	m_fontId( 0 ),
 	m_filename( "" ),
+	m_loadGeneration( 0 ),
 	m_lastMidiPitch( -1 ),
 	m_lastMidiPitchRange( -1 ),
 	m_channel( 1 ),
@@ -262,14 +322,19 @@ void sf2Instrument::loadFile( const QString & _file )
 {
 	if( !_file.isEmpty() && QFileInfo( _file ).exists() )
 	{
-		openFile( _file, false );
-		updatePatch();
-
-		// for some reason we've to call that, otherwise preview of a
-		// soundfont for the first time fails
-		updateSampleRate();
+		loadFont( _file, false, true );
 	}
+	else
+	{
+		selectFirstPreset();
+	}
+}
+
 
+
+
+void sf2Instrument::selectFirstPreset()
+{
 	// setting the first bank and patch number that is found
 	auto sSoundCount = ::fluid_synth_sfcount( m_synth );
 	for ( int i = 0; i < sSoundCount; ++i ) {
@@ -377,11 +442,74 @@ void sf2Instrument::freeFont()
 
 
 void sf2Instrument::openFile( const QString & _sf2File, bool updateTrackName )
+{
+	loadFont( _sf2File, updateTrackName, false );
+}
+
+
+
+
+void sf2Instrument::loadFont( const QString & _sf2File, bool updateTrackName,
+							bool selectPreset )
 {
 	emit fileLoading();
 
-	// Used for loading file
-	char * sf2Ascii = qstrdup( qPrintable( PathUtil::toAbsolute( _sf2File ) ) );
+	const int generation = ++m_loadGeneration;
+	const QString file = PathUtil::toAbsolute( _sf2File );
+	const QString relativePath = PathUtil::toShortestRelative( _sf2File );
+
+	// only reads the header, so broken files are still reported while
+	// the project loads
+	if( !fluid_is_soundfont( qPrintable( file ) ) )
+	{
+		fontLoaded( _sf2File, updateTrackName, selectPreset, NULL );
+		return;
+	}
+
+	s_fontsMutex.lock();
+	const bool shared = s_fonts.contains( relativePath );
+	s_fontsMutex.unlock();
+
+	auto loaded = std::make_shared<sf2LoadedFont>();
+	if( shared || !gui )
+	{
+		// when rendering from the command line, the font is needed
+		// right away
+		if( !shared )
+		{
+			loaded->load( file );
+		}
+		fontLoaded( _sf2File, updateTrackName, selectPreset,
+								loaded.get() );
+		return;
+	}
+
+	// parsing the soundfont can take seconds, so the current one keeps
+	// playing until it is done
+	AssetLoader::load( relativePath,
+		[file, loaded]()
+		{
+			loaded->load( file );
+		},
+		this,
+		[this, _sf2File, updateTrackName, selectPreset, generation,
+								loaded]()
+		{
+			// skip if another file has been opened meanwhile
+			if( generation == m_loadGeneration )
+			{
+				fontLoaded( _sf2File, updateTrackName,
+						selectPreset, loaded.get() );
+			}
+		} );
+}
+
+
+
+
+void sf2Instrument::fontLoaded( const QString & _sf2File, bool updateTrackName,
+				bool selectPreset, sf2LoadedFont * loaded )
+{
 	QString relativePath = PathUtil::toShortestRelative( _sf2File );
 
 	// free reference to soundfont if one is selected
@@ -405,21 +533,14 @@ void sf2Instrument::openFile( const QString & _sf2File, bool updateTrackName )
 	// Add to map, if doesn't exist.
 	else
 	{
-		bool loaded = false;
-		if( fluid_is_soundfont( sf2Ascii ) )
+		fluid_sfont_t * font = loaded != NULL ? loaded->take() : NULL;
+		if( font != NULL )
 		{
-			m_fontId = fluid_synth_sfload( m_synth, sf2Ascii, true );
-
-			if( fluid_synth_sfcount( m_synth ) > 0 )
-			{
-				// Grab this sf from the top of the stack and add to list
-				m_font = new sf2Font( fluid_synth_get_sfont( m_synth, 0 ) );
-				s_fonts.insert( relativePath, m_font );
-				loaded = true;
-			}
+			m_font = new sf2Font( font );
+			s_fonts.insert( relativePath, m_font );
+			m_fontId = fluid_synth_add_sfont( m_synth, font );
 		}
-
-		if(!loaded)
+		else
 		{
 			collectErrorForUI( sf2Instrument::tr( "A soundfont %1 could not be loaded." ).
 				arg( QFileInfo( _sf2File ).baseName() ) );
@@ -440,12 +561,21 @@ void sf2Instrument::openFile( const QString & _sf2File, bool updateTrackName )
 		emit fileChanged();
 	}
 
-	delete[] sf2Ascii;
-
 	if( updateTrackName || instrumentTrack()->displayName() == displayName() )
 	{
 		instrumentTrack()->setName( PathUtil::cleanName( _sf2File ) );
 	}
+
+	// the patch might have been loaded before the font
+	updatePatch();
+
+	if( selectPreset )
+	{
+		// for some reason we've to call that, otherwise preview of a
+		// soundfont for the first time fails
+		updateSampleRate();
+		selectFirstPreset();
+	}
 }
 
 
@@ -41,6 +41,7 @@
 
 class sf2InstrumentView;
 class sf2Font;
+class sf2LoadedFont;
 class NotePlayHandle;
 
 class patchesDialog;
@@ -120,6 +121,8 @@ private:
 
 	int m_fontId;
 	QString m_filename;
+	// increased for each file opened, to skip outdated background loads
+	int m_loadGeneration;
 
 	// Protect the array of active notes
 	QMutex m_notesRunningMutex;
@@ -158,6 +161,11 @@ private:
 
 private:
 	void freeFont();
+	void loadFont( const QString & _sf2File, bool updateTrackName,
+						bool selectPreset );
+	void fontLoaded( const QString & _sf2File, bool updateTrackName,
+			bool selectPreset, sf2LoadedFont * loaded );
+	void selectFirstPreset();
 	void noteOn( SF2PluginData * n );
 	void noteOff( SF2PluginData * n );
 	void renderFrames( f_cnt_t frames, sampleFrame * buf );
@@ -411,6 +411,14 @@ void vestigeInstrument::play( sampleFrame * _buf )
 
 
 
+f_cnt_t vestigeInstrument::latency() const
+{
+	return m_plugin != NULL ? m_plugin->latency() : 0;
+}
+
+
+
+
 bool vestigeInstrument::handleMidiEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
 	m_pluginMutex.lock();
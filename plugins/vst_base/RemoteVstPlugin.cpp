@@ -666,6 +666,17 @@ bool RemoteVstPlugin::processMessage( const message & _m )
 			//sendMessage( IdVstSetParameter );
 			break;
 
+		case IdVstSetParameters:
+		{
+			const int count = _m.getInt( 0 );
+			for( int i = 0; i < count; ++i )
+			{
+				m_plugin->setParameter( m_plugin, _m.getInt( 1 + 2 * i ),
+							_m.getFloat( 2 + 2 * i ) );
+			}
+			break;
+		}
+
 		case IdVstParameterDisplays:
 			getParameterDisplays();
 			break;
@@ -2045,6 +2056,7 @@ DWORD WINAPI RemoteVstPlugin::processingThread( LPVOID _param )
 		if( m.id == IdStartProcessing
 			|| m.id == IdMidiEvent
 			|| m.id == IdVstSetParameter
+			|| m.id == IdVstSetParameters
 			|| m.id == IdVstSetTempo )
 		{
 			_this->processMessage( m );
@@ -210,6 +210,9 @@ void VstPlugin::tryLoad( const QString &remoteVstPluginExecutable )
 
 void VstPlugin::loadSettings( const QDomElement & _this )
 {
+	// don't let older changes overwrite the loaded settings
+	sendPendingChanges();
+
 	if( _this.hasAttribute( "program" ) )
 	{
 		setProgram( _this.attribute( "program" ).toInt() );
@@ -343,6 +346,8 @@ const QMap<QString, QString> & VstPlugin::parameterDump()
 
 void VstPlugin::setParameterDump( const QMap<QString, QString> & _pdump )
 {
+	sendPendingChanges();
+
 	message m( IdVstSetParameterDump );
 	m.addInt( _pdump.size() );
 	for( QMap<QString, QString>::ConstIterator it = _pdump.begin();
@@ -593,9 +598,46 @@ void VstPlugin::savePreset( )
 
 void VstPlugin::setParam( int i, float f )
 {
+	// Automation may change lots of parameters each period, so changes
+	// coming from the audio threads are sent together before the plugin
+	// processes the next period
+	{
+		QMutexLocker locker( &m_pendingParamsMutex );
+		m_pendingParams[i] = f;
+	}
+
+	if( QThread::currentThread() == thread() )
+	{
+		sendPendingChanges();
+	}
+}
+
+
+
+
+void VstPlugin::sendPendingChanges()
+{
+	QMap<int, float> params;
+	{
+		QMutexLocker locker( &m_pendingParamsMutex );
+		params.swap( m_pendingParams );
+	}
+
+	if( params.isEmpty() )
+	{
+		return;
+	}
+
+	message m( IdVstSetParameters );
+	m.addInt( params.size() );
+	for( QMap<int, float>::ConstIterator it = params.begin();
+						it != params.end(); ++it )
+	{
+		m.addInt( it.key() ).addFloat( it.value() );
+	}
+
 	lock();
-	sendMessage( message( IdVstSetParameter ).addInt( i ).addFloat( f ) );
-	//waitForMessage( IdVstSetParameter, true );
+	sendMessage( m );
 	unlock();
 }
 
@@ -603,6 +645,8 @@ void VstPlugin::setParam( int i, float f )
 
 void VstPlugin::idleUpdate()
 {
+	sendPendingChanges();
+
 	lock();
 	sendMessage( message( IdVstIdleUpdate ) );
 	unlock();
@@ -142,6 +142,9 @@ public slots:
 
 	void handleClientEmbed();
 
+protected:
+	void sendPendingChanges() override;
+
 private:
 	void loadChunk( const QByteArray & _chunk );
 	QByteArray saveChunk();
@@ -167,6 +170,10 @@ private:
 
 	QMap<QString, QString> m_parameterDump;
 
+	// parameter changes not sent to the plugin yet
+	QMutex m_pendingParamsMutex;
+	QMap<int, float> m_pendingParams;
+
 	int m_currentProgram;
 
 	QTimer m_idleTimer;
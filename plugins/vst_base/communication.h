@@ -82,7 +82,9 @@ enum VstRemoteMessageIDs
 	IdVstPluginUniqueID,
 	IdVstSetParameter,
 	IdVstParameterCount,
-	IdVstParameterDump
+	IdVstParameterDump,
+	// count, then index and value of each parameter
+	IdVstSetParameters
 
 } ;
 
@@ -351,6 +351,15 @@ void ZynAddSubFxInstrument::play( sampleFrame * _buf )
 
 
 
+f_cnt_t ZynAddSubFxInstrument::latency() const
+{
+	// the local engine renders in place
+	return m_remotePlugin ? m_remotePlugin->latency() : 0;
+}
+
+
+
+
 bool ZynAddSubFxInstrument::handleMidiEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
 	// do not forward external MIDI Control Change events if the according
@@ -85,6 +85,8 @@ public:
 		return IsSingleStreamed | IsMidiBased;
 	}
 
+	virtual f_cnt_t latency() const;
+
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
@@ -0,0 +1,89 @@
+/*
+ * AssetLoader.cpp - loads samples and other assets in the background
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AssetLoader.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEvent>
+#include <QtCore/QThreadPool>
+
+#include "PerfLog.h"
+
+
+static QThreadPool * loaderPool()
+{
+	static QThreadPool pool;
+	return &pool;
+}
+
+
+
+
+void AssetLoader::load( const QString & name, const Job & job,
+					QObject * context, const Job & done )
+{
+	AssetLoadJob * loadJob = new AssetLoadJob( name, job );
+	// queued, as the job finishes on a pool thread
+	QObject::connect( loadJob, &AssetLoadJob::finished, context, done,
+						Qt::QueuedConnection );
+	QObject::connect( loadJob, &AssetLoadJob::finished,
+				loadJob, &QObject::deleteLater, Qt::QueuedConnection );
+	loaderPool()->start( loadJob );
+}
+
+
+
+
+void AssetLoader::waitForDone()
+{
+	loaderPool()->waitForDone();
+	QCoreApplication::sendPostedEvents( NULL, QEvent::MetaCall );
+}
+
+
+
+
+AssetLoadJob::AssetLoadJob( const QString & name,
+					const AssetLoader::Job & job ) :
+	m_name( name ),
+	m_job( job )
+{
+	setAutoDelete( false );
+}
+
+
+
+
+void AssetLoadJob::run()
+{
+	// wall-clock time, as PerfLogTimer measures the CPU time of the
+	// whole process, not of this pool thread
+	QElapsedTimer timer;
+	timer.start();
+
+	m_job();
+
+	perfLog( "Asset load", QString( "%1 in %2 ms" ).
+				arg( m_name ).arg( timer.elapsed() ) );
+	emit finished();
+}
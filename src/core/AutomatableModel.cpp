@@ -34,6 +34,7 @@
 #include "Song.h"
 
 long AutomatableModel::s_periodCounter = 0;
+std::atomic<unsigned int> AutomatableModel::s_destroyedCount( 0 );
 
 
 
@@ -53,6 +54,8 @@ AutomatableModel::AutomatableModel(
 	m_controllerConnection( NULL ),
 	m_valueBuffer( static_cast<int>( Engine::mixer()->framesPerPeriod() ) ),
 	m_lastUpdatedPeriod( -1 ),
+	m_firstAutomationRamp( 0 ),
+	m_automationRampCount( 0 ),
 	m_hasSampleExactData( false )
 
 {
@@ -78,6 +81,8 @@ AutomatableModel::~AutomatableModel()
 
 	m_valueBuffer.clear();
 
+	++s_destroyedCount;
+
 	emit destroyed( id() );
 }
 
@@ -593,6 +598,105 @@ float AutomatableModel::controllerValue( int frameOffset ) const
 }
 
 
+void AutomatableModel::setAutomatedValue( const float value,
+				const float nextValue, const f_cnt_t frameOffset,
+				const f_cnt_t rampFrames )
+{
+	const float previousValue = m_value;
+	setAutomatedValue( value );
+
+	const qint64 periodStart = static_cast<qint64>( s_periodCounter ) *
+					Engine::mixer()->framesPerPeriod();
+
+	QMutexLocker m( &m_valueBufferMutex );
+
+	// forget ramps which ended before the current period, but keep the
+	// last one starting before it
+	while( m_automationRampCount > 1 &&
+			automationRamp( 1 ).start <= periodStart )
+	{
+		m_firstAutomationRamp = ( m_firstAutomationRamp + 1 ) %
+							MaxAutomationRamps;
+		--m_automationRampCount;
+	}
+
+	const float target = fittedValue( scaledValue( nextValue ) );
+	if( target == m_value && ( m_automationRampCount == 0 ||
+		automationRamp( m_automationRampCount - 1 ).to == m_value ) )
+	{
+		// the value doesn't move, no need for sample-exact data
+		return;
+	}
+
+	if( m_automationRampCount == 0 && frameOffset > 0 )
+	{
+		// hold the old value until the automation starts
+		pushAutomationRamp( { periodStart, 1,
+					previousValue, previousValue } );
+	}
+
+	pushAutomationRamp( { periodStart + frameOffset,
+					qMax<f_cnt_t>( rampFrames, 1 ),
+					m_value, target } );
+}
+
+
+
+
+void AutomatableModel::pushAutomationRamp( const AutomationRamp & ramp )
+{
+	if( m_automationRampCount == MaxAutomationRamps )
+	{
+		m_firstAutomationRamp = ( m_firstAutomationRamp + 1 ) %
+							MaxAutomationRamps;
+		--m_automationRampCount;
+	}
+	automationRamp( m_automationRampCount++ ) = ramp;
+}
+
+
+
+
+bool AutomatableModel::renderAutomationRamps()
+{
+	if( m_automationRampCount == 0 )
+	{
+		return false;
+	}
+
+	const fpp_t fpp = m_valueBuffer.length();
+	const qint64 periodStart = static_cast<qint64>( s_periodCounter ) * fpp;
+
+	const AutomationRamp & last = automationRamp( m_automationRampCount - 1 );
+	if( last.start + last.length <= periodStart )
+	{
+		// automation is not moving anymore
+		m_automationRampCount = 0;
+		return false;
+	}
+
+	float * values = m_valueBuffer.values();
+	int r = 0;
+	for( fpp_t f = 0; f < fpp; ++f )
+	{
+		const qint64 frame = periodStart + f;
+		while( r + 1 < m_automationRampCount &&
+				automationRamp( r + 1 ).start <= frame )
+		{
+			++r;
+		}
+
+		const AutomationRamp & ramp = automationRamp( r );
+		const qint64 pos = qMax<qint64>( frame - ramp.start, 0 );
+		values[f] = pos >= ramp.length ? ramp.to :
+			ramp.from + ( ramp.to - ramp.from ) * pos / ramp.length;
+	}
+	return true;
+}
+
+
+
+
 ValueBuffer * AutomatableModel::valueBuffer()
 {
 	QMutexLocker m( &m_valueBufferMutex );
@@ -657,6 +761,15 @@ ValueBuffer * AutomatableModel::valueBuffer()
 		return &m_valueBuffer;
 	}
 
+	// automation of the current period
+	if( renderAutomationRamps() )
+	{
+		m_oldValue = val;
+		m_lastUpdatedPeriod = s_periodCounter;
+		m_hasSampleExactData = true;
+		return &m_valueBuffer;
+	}
+
 	if( m_oldValue != val )
 	{
 		m_valueBuffer.interpolate( m_oldValue, val );
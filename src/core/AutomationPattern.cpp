@@ -34,6 +34,7 @@
 #include "BBTrackContainer.h"
 #include "Song.h"
 
+#include <algorithm>
 #include <cmath>
 
 int AutomationPattern::s_quantization = 1;
@@ -47,6 +48,7 @@ AutomationPattern::AutomationPattern( AutomationTrack * _auto_track ) :
 	m_objects(),
 	m_tension( 1.0 ),
 	m_progressionType( DiscreteProgression ),
+	m_segmentsDirty( true ),
 	m_dragging( false ),
 	m_isRecording( false ),
 	m_lastRecordedValue( 0 )
@@ -77,7 +79,8 @@ AutomationPattern::AutomationPattern( const AutomationPattern & _pat_to_copy ) :
 	m_autoTrack( _pat_to_copy.m_autoTrack ),
 	m_objects( _pat_to_copy.m_objects ),
 	m_tension( _pat_to_copy.m_tension ),
-	m_progressionType( _pat_to_copy.m_progressionType )
+	m_progressionType( _pat_to_copy.m_progressionType ),
+	m_segmentsDirty( true )
 {
 	for( timeMap::const_iterator it = _pat_to_copy.m_timeMap.begin();
 				it != _pat_to_copy.m_timeMap.end(); ++it )
@@ -135,6 +138,7 @@ void AutomationPattern::setProgressionType(
 		_new_progression_type == CubicHermiteProgression )
 	{
 		m_progressionType = _new_progression_type;
+		markDirty();
 		emit dataChanged();
 	}
 }
@@ -150,6 +154,7 @@ void AutomationPattern::setTension( QString _new_tension )
 	if( ok && nt > -0.01 && nt < 1.01 )
 	{
 		m_tension = nt;
+		markDirty();
 	}
 }
 
@@ -329,66 +334,82 @@ void AutomationPattern::applyDragValue()
 
 float AutomationPattern::valueAt( const MidiTime & _time ) const
 {
-	if( m_timeMap.isEmpty() )
+	QMutexLocker lock( &m_segmentsMutex );
+	if( m_segmentsDirty )
 	{
-		return 0;
-	}
-
-	if( m_timeMap.contains( _time ) )
-	{
-		return m_timeMap[_time];
+		compileSegments();
 	}
 
-	// lowerBound returns next value with greater key, therefore we take
-	// the previous element to get the current value
-	timeMap::ConstIterator v = m_timeMap.lowerBound( _time );
+	// find the segment containing _time, i.e. the last one starting at
+	// or before it
+	QVector<Segment>::ConstIterator s = std::upper_bound(
+		m_segments.constBegin(), m_segments.constEnd(), (int) _time,
+		[]( int time, const Segment & segment )
+		{
+			return time < segment.start;
+		} );
 
-	if( v == m_timeMap.begin() )
+	if( s == m_segments.constBegin() )
 	{
 		return 0;
 	}
-	if( v == m_timeMap.end() )
-	{
-		return (v-1).value();
-	}
+	--s;
 
-	return valueAt( v-1, _time - (v-1).key() );
+	const float t = qMin( ( _time - s->start ) / s->length, 1.0f );
+	return ( ( s->a * t + s->b ) * t + s->c ) * t + s->d;
 }
 
 
 
 
-float AutomationPattern::valueAt( timeMap::const_iterator v, int offset ) const
+void AutomationPattern::compileSegments() const
 {
-	if( m_progressionType == DiscreteProgression || v == m_timeMap.end() )
-	{
-		return v.value();
-	}
-	else if( m_progressionType == LinearProgression )
-	{
-		float slope = ((v+1).value() - v.value()) /
-							((v+1).key() - v.key());
-		return v.value() + offset * slope;
-	}
-	else /* CubicHermiteProgression */
+	m_segmentsDirty = false;
+	m_segments.clear();
+	m_segments.reserve( m_timeMap.size() );
+
+	for( timeMap::const_iterator v = m_timeMap.begin();
+					v != m_timeMap.end(); ++v )
 	{
-		// Implements a Cubic Hermite spline as explained at:
-		// http://en.wikipedia.org/wiki/Cubic_Hermite_spline#Unit_interval_.280.2C_1.29
-		//
-		// Note that we are not interpolating a 2 dimensional point over
-		// time as the article describes.  We are interpolating a single
-		// value: y.  To make this work we map the values of x that this
-		// segment spans to values of t for t = 0.0 -> 1.0 and scale the
-		// tangents _m1 and _m2
-		int numValues = ((v+1).key() - v.key());
-		float t = (float) offset / (float) numValues;
-		float m1 = (m_tangents[v.key()]) * numValues * m_tension;
-		float m2 = (m_tangents[(v+1).key()]) * numValues * m_tension;
+		Segment s;
+		s.start = v.key();
+		s.d = v.value();
+
+		if( v+1 == m_timeMap.end() || m_progressionType == DiscreteProgression )
+		{
+			// hold the value, also after the last point
+			s.length = 1;
+			s.a = s.b = s.c = 0;
+		}
+		else if( m_progressionType == LinearProgression )
+		{
+			s.length = (v+1).key() - v.key();
+			s.a = s.b = 0;
+			s.c = (v+1).value() - v.value();
+		}
+		else /* CubicHermiteProgression */
+		{
+			// Implements a Cubic Hermite spline as explained at:
+			// http://en.wikipedia.org/wiki/Cubic_Hermite_spline#Unit_interval_.280.2C_1.29
+			//
+			// Note that we are not interpolating a 2 dimensional point over
+			// time as the article describes.  We are interpolating a single
+			// value: y.  To make this work we map the values of x that this
+			// segment spans to values of t for t = 0.0 -> 1.0 and scale the
+			// tangents m1 and m2
+			s.length = (v+1).key() - v.key();
+			const float m1 = m_tangents.value( v.key() ) * s.length * m_tension;
+			const float m2 = m_tangents.value( (v+1).key() ) * s.length * m_tension;
+			const float p0 = v.value();
+			const float p1 = (v+1).value();
+
+			// expand the basis functions into a cubic polynomial
+			s.a = 2 * p0 + m1 - 2 * p1 + m2;
+			s.b = -3 * p0 - 2 * m1 + 3 * p1 - m2;
+			s.c = m1;
+		}
 
-		return ( 2*pow(t,3) - 3*pow(t,2) + 1 ) * v.value()
-				+ ( pow(t,3) - 2*pow(t,2) + t) * m1
-				+ ( -2*pow(t,3) + 3*pow(t,2) ) * (v+1).value()
-				+ ( pow(t,3) - pow(t,2) ) * m2;
+		m_segments.push_back( s );
 	}
 }
 
@@ -408,7 +429,7 @@ float *AutomationPattern::valuesAfter( const MidiTime & _time ) const
 
 	for( int i = 0; i < numValues; i++ )
 	{
-		ret[i] = valueAt( v, i );
+		ret[i] = valueAt( v.key() + i );
 	}
 
 	return ret;
@@ -819,6 +840,7 @@ void AutomationPattern::clear()
 {
 	m_timeMap.clear();
 	m_tangents.clear();
+	markDirty();
 
 	emit dataChanged();
 }
@@ -884,6 +906,7 @@ void AutomationPattern::generateTangents( timeMap::const_iterator it,
 	if( m_timeMap.size() < 2 && numToGenerate > 0 )
 	{
 		m_tangents[it.key()] = 0;
+		markDirty();
 		return;
 	}
 
@@ -898,7 +921,7 @@ void AutomationPattern::generateTangents( timeMap::const_iterator it,
 		else if( it+1 == m_timeMap.end() )
 		{
 			m_tangents[it.key()] = 0;
-			return;
+			break;
 		}
 		else
 		{
@@ -908,6 +931,7 @@ void AutomationPattern::generateTangents( timeMap::const_iterator it,
 		}
 		it++;
 	}
+	markDirty();
 }
 
 
@@ -0,0 +1,477 @@
+/*
+ * BinaryProjectFile.cpp - binary container for LMMS projects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "BinaryProjectFile.h"
+
+#include <QtCore/QHash>
+
+
+static const char Magic[] = "LMMB";
+static const quint32 FormatVersion = 1;
+static const int HeaderSize = 12;
+static const int SectionEntrySize = 32;
+
+// section flags
+static const quint32 CompressedSection = 1;
+
+// tokens of the document section
+enum Tokens
+{
+	ElementStart = 1,
+	ElementEnd,
+	TextNode,
+	CDataNode,
+	ProcessingInstruction
+} ;
+
+// attribute kinds
+static const quint8 StringValue = 0;
+static const quint8 BlobValue = 1;
+
+// shorter base64 values are cheaper to keep inline
+static const int BlobThreshold = 4096;
+
+
+
+
+namespace
+{
+
+class Writer
+{
+public:
+	Writer( QByteArray & out ) :
+		m_out( out )
+	{
+	}
+
+	void writeUInt( quint64 value, int bytes )
+	{
+		for( int i = 0; i < bytes; ++i )
+		{
+			m_out.append( static_cast<char>( ( value >> ( 8 * i ) ) & 0xff ) );
+		}
+	}
+
+	void writeString( const QString & string )
+	{
+		const QByteArray utf8 = string.toUtf8();
+		writeUInt( utf8.size(), 4 );
+		m_out.append( utf8 );
+	}
+
+	void writeName( const QString & name )
+	{
+		auto it = m_names.constFind( name );
+		if( it != m_names.constEnd() )
+		{
+			writeUInt( it.value(), 4 );
+			return;
+		}
+		// new names are defined where they are used first
+		const int index = m_names.size();
+		m_names.insert( name, index );
+		writeUInt( index, 4 );
+		writeString( name );
+	}
+
+private:
+	QByteArray & m_out;
+	QHash<QString, int> m_names;
+
+} ;
+
+
+
+
+class Reader
+{
+public:
+	Reader( const QByteArray & in ) :
+		m_in( in ),
+		m_pos( 0 ),
+		m_ok( true )
+	{
+	}
+
+	bool ok() const
+	{
+		return m_ok;
+	}
+
+	bool atEnd() const
+	{
+		return m_pos >= m_in.size();
+	}
+
+	quint64 readUInt( int bytes )
+	{
+		if( !m_ok || m_in.size() - m_pos < bytes )
+		{
+			m_ok = false;
+			return 0;
+		}
+		quint64 value = 0;
+		for( int i = 0; i < bytes; ++i )
+		{
+			value |= static_cast<quint64>( static_cast<uchar>(
+					m_in[m_pos++] ) ) << ( 8 * i );
+		}
+		return value;
+	}
+
+	QString readString()
+	{
+		const quint32 size = readUInt( 4 );
+		if( !m_ok || static_cast<quint32>( m_in.size() - m_pos ) < size )
+		{
+			m_ok = false;
+			return QString();
+		}
+		const QString string = QString::fromUtf8( m_in.constData() + m_pos, size );
+		m_pos += size;
+		return string;
+	}
+
+	QString readName()
+	{
+		const quint32 index = readUInt( 4 );
+		if( index == static_cast<quint32>( m_names.size() ) )
+		{
+			m_names.push_back( readString() );
+		}
+		else if( index > static_cast<quint32>( m_names.size() ) )
+		{
+			m_ok = false;
+		}
+		return m_ok ? m_names[index] : QString();
+	}
+
+private:
+	const QByteArray & m_in;
+	int m_pos;
+	bool m_ok;
+	QVector<QString> m_names;
+
+} ;
+
+}
+
+
+
+
+static bool isBlob( const QString & value, QByteArray & blob )
+{
+	if( value.size() < BlobThreshold )
+	{
+		return false;
+	}
+	// only take canonical base64, so that encoding the blob gives the
+	// same string again
+	const QByteArray latin1 = value.toLatin1();
+	blob = QByteArray::fromBase64( latin1 );
+	return blob.toBase64() == latin1;
+}
+
+
+
+
+static void writeNode( const QDomNode & node, Writer & doc,
+						QVector<QByteArray> & blobs )
+{
+	if( node.isElement() )
+	{
+		doc.writeUInt( ElementStart, 1 );
+		doc.writeName( node.nodeName() );
+
+		const QDomNamedNodeMap attributes = node.attributes();
+		doc.writeUInt( attributes.count(), 4 );
+		for( int i = 0; i < attributes.count(); ++i )
+		{
+			const QDomAttr attribute = attributes.item( i ).toAttr();
+			doc.writeName( attribute.name() );
+
+			QByteArray blob;
+			const QString value = attribute.value();
+			if( isBlob( value, blob ) )
+			{
+				doc.writeUInt( BlobValue, 1 );
+				// the document section comes first
+				doc.writeUInt( blobs.size() + 1, 4 );
+				blobs.push_back( blob );
+			}
+			else
+			{
+				doc.writeUInt( StringValue, 1 );
+				doc.writeString( value );
+			}
+		}
+
+		for( QDomNode child = node.firstChild(); !child.isNull();
+						child = child.nextSibling() )
+		{
+			writeNode( child, doc, blobs );
+		}
+
+		doc.writeUInt( ElementEnd, 1 );
+	}
+	else if( node.isCDATASection() )
+	{
+		doc.writeUInt( CDataNode, 1 );
+		doc.writeString( node.nodeValue() );
+	}
+	else if( node.isText() )
+	{
+		doc.writeUInt( TextNode, 1 );
+		doc.writeString( node.nodeValue() );
+	}
+	else if( node.isProcessingInstruction() )
+	{
+		const QDomProcessingInstruction pi = node.toProcessingInstruction();
+		doc.writeUInt( ProcessingInstruction, 1 );
+		doc.writeString( pi.target() );
+		doc.writeString( pi.data() );
+	}
+}
+
+
+
+
+BinaryProjectFile::BinaryProjectFile( const QByteArray & data ) :
+	m_data( data ),
+	m_valid( false )
+{
+	if( !isBinary( data ) )
+	{
+		return;
+	}
+
+	Reader header( m_data );
+	header.readUInt( 4 );
+	const quint32 version = header.readUInt( 4 );
+	const quint32 count = header.readUInt( 4 );
+	if( version > FormatVersion ||
+		static_cast<quint64>( count ) * SectionEntrySize >
+				static_cast<quint64>( m_data.size() ) )
+	{
+		return;
+	}
+
+	for( quint32 i = 0; i < count; ++i )
+	{
+		Section s;
+		s.type = static_cast<SectionTypes>( header.readUInt( 4 ) );
+		s.flags = header.readUInt( 4 );
+		s.offset = header.readUInt( 8 );
+		s.size = header.readUInt( 8 );
+		s.rawSize = header.readUInt( 8 );
+		if( s.offset > static_cast<quint64>( m_data.size() ) ||
+			s.size > m_data.size() - s.offset )
+		{
+			return;
+		}
+		m_sections.push_back( s );
+	}
+
+	m_valid = header.ok() && count > 0 &&
+				m_sections[0].type == DocumentSection;
+}
+
+
+
+
+bool BinaryProjectFile::isBinary( const QByteArray & data )
+{
+	return data.startsWith( Magic );
+}
+
+
+
+
+QByteArray BinaryProjectFile::write( const QDomDocument & doc, bool compress )
+{
+	QByteArray document;
+	QVector<QByteArray> blobs;
+	Writer docWriter( document );
+	for( QDomNode node = doc.firstChild(); !node.isNull();
+					node = node.nextSibling() )
+	{
+		writeNode( node, docWriter, blobs );
+	}
+
+	QVector<QByteArray> sections;
+	QVector<quint64> rawSizes;
+	QVector<bool> compressed;
+	sections.push_back( compress ? qCompress( document, 1 ) : document );
+	rawSizes.push_back( document.size() );
+	compressed.push_back( compress );
+	for( const QByteArray & blob : blobs )
+	{
+		// plugin states tend to shrink, embedded audio mostly doesn't
+		const QByteArray packed = compress ? qCompress( blob, 1 ) :
+								QByteArray();
+		const bool smaller = compress && packed.size() < blob.size();
+		sections.push_back( smaller ? packed : blob );
+		rawSizes.push_back( blob.size() );
+		compressed.push_back( smaller );
+	}
+
+	QByteArray out;
+	Writer writer( out );
+	out.append( Magic, 4 );
+	writer.writeUInt( FormatVersion, 4 );
+	writer.writeUInt( sections.size(), 4 );
+
+	quint64 offset = HeaderSize + sections.size() * SectionEntrySize;
+	for( int i = 0; i < sections.size(); ++i )
+	{
+		writer.writeUInt( i == 0 ? DocumentSection : BlobSection, 4 );
+		writer.writeUInt( compressed[i] ? CompressedSection : 0, 4 );
+		writer.writeUInt( offset, 8 );
+		writer.writeUInt( sections[i].size(), 8 );
+		writer.writeUInt( rawSizes[i], 8 );
+		offset += sections[i].size();
+	}
+
+	for( const QByteArray & section : sections )
+	{
+		out.append( section );
+	}
+
+	return out;
+}
+
+
+
+
+QByteArray BinaryProjectFile::section( int index ) const
+{
+	const QByteArray data = contents( index );
+	if( data.isEmpty() || m_sections[index].flags & CompressedSection )
+	{
+		return data;
+	}
+	// detach, as the caller may keep it longer than the data is mapped
+	return QByteArray( data.constData(), data.size() );
+}
+
+
+
+
+QByteArray BinaryProjectFile::contents( int index ) const
+{
+	if( index < 0 || index >= m_sections.size() )
+	{
+		return QByteArray();
+	}
+
+	const Section & s = m_sections[index];
+	// no deep copy, this only references the (possibly mapped) data
+	const QByteArray raw = QByteArray::fromRawData(
+			m_data.constData() + s.offset, s.size );
+	if( s.flags & CompressedSection )
+	{
+		const QByteArray data = qUncompress( raw );
+		return static_cast<quint64>( data.size() ) == s.rawSize ?
+							data : QByteArray();
+	}
+	return raw;
+}
+
+
+
+
+bool BinaryProjectFile::read( QDomDocument & doc ) const
+{
+	if( !m_valid )
+	{
+		return false;
+	}
+
+	const QByteArray document = contents( 0 );
+	Reader reader( document );
+
+	// the innermost element opened at each depth
+	QVector<QDomNode> parents;
+	parents.push_back( doc );
+
+	while( !reader.atEnd() && reader.ok() )
+	{
+		const quint8 token = reader.readUInt( 1 );
+		switch( token )
+		{
+			case ElementStart:
+			{
+				QDomElement element = doc.createElement( reader.readName() );
+				const quint32 attributes = reader.readUInt( 4 );
+				for( quint32 i = 0; i < attributes && reader.ok(); ++i )
+				{
+					const QString name = reader.readName();
+					if( reader.readUInt( 1 ) == BlobValue )
+					{
+						const int index = reader.readUInt( 4 );
+						if( index <= 0 || index >= m_sections.size() ||
+							m_sections[index].type != BlobSection )
+						{
+							return false;
+						}
+						element.setAttribute( name, QString::fromLatin1(
+								contents( index ).toBase64() ) );
+					}
+					else
+					{
+						element.setAttribute( name, reader.readString() );
+					}
+				}
+				parents.last().appendChild( element );
+				parents.push_back( element );
+				break;
+			}
+			case ElementEnd:
+				if( parents.size() < 2 )
+				{
+					return false;
+				}
+				parents.pop_back();
+				break;
+			case TextNode:
+				parents.last().appendChild(
+					doc.createTextNode( reader.readString() ) );
+				break;
+			case CDataNode:
+				parents.last().appendChild(
+					doc.createCDATASection( reader.readString() ) );
+				break;
+			case ProcessingInstruction:
+			{
+				const QString target = reader.readString();
+				parents.last().appendChild( doc.createProcessingInstruction(
+						target, reader.readString() ) );
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+
+	return reader.ok() && parents.size() == 1;
+}
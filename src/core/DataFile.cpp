@@ -34,6 +34,7 @@
 #include <QMessageBox>
 
 #include "base64.h"
+#include "BinaryProjectFile.h"
 #include "ConfigManager.h"
 #include "Effect.h"
 #include "embed.h"
@@ -137,6 +138,20 @@ DataFile::DataFile( const QString & _fileName ) :
 		return;
 	}
 
+	// binary projects are mapped, so embedded samples are only read from
+	// disk while being decoded
+	if( BinaryProjectFile::isBinary( inFile.peek( 4 ) ) )
+	{
+		uchar * map = inFile.map( 0, inFile.size() );
+		if( map )
+		{
+			loadData( QByteArray::fromRawData( reinterpret_cast<const char *>( map ),
+						inFile.size() ), _fileName );
+			inFile.unmap( map );
+			return;
+		}
+	}
+
 	loadData( inFile.readAll(), _fileName );
 }
 
@@ -167,7 +182,7 @@ bool DataFile::validate( QString extension )
 	switch( m_type )
 	{
 	case Type::SongProject:
-		if( extension == "mmp" || extension == "mmpz" )
+		if( extension == "mmp" || extension == "mmpz" || extension == "mmpb" )
 		{
 			return true;
 		}
@@ -186,6 +201,7 @@ bool DataFile::validate( QString extension )
 		break;
 	case Type::UnknownType:
 		if (! ( extension == "mmp" || extension == "mpt" || extension == "mmpz" ||
+				extension == "mmpb" ||
 				extension == "xpf" || extension == "xml" ||
 				( extension == "xiz" && ! pluginFactory->pluginSupportingExtension(extension).isNull()) ||
 				extension == "sf2" || extension == "sf3" || extension == "pat" || extension == "mid" ||
@@ -219,7 +235,8 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 		case SongProject:
 			if( _fn.section( '.', -1 ) != "mmp" &&
 					_fn.section( '.', -1 ) != "mpt" &&
-					_fn.section( '.', -1 ) != "mmpz" )
+					_fn.section( '.', -1 ) != "mmpz" &&
+					_fn.section( '.', -1 ) != "mmpb" )
 			{
 				if( ConfigManager::inst()->value( "app",
 						"nommpz" ).toInt() == 0 )
@@ -250,14 +267,22 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 
 
 void DataFile::write( QTextStream & _strm )
+{
+	cleanForWriting();
+
+	save(_strm, 2);
+}
+
+
+
+
+void DataFile::cleanForWriting()
 {
 	if( type() == SongProject || type() == SongProjectTemplate
 					|| type() == InstrumentTrackSettings )
 	{
 		cleanMetaNodes( documentElement() );
 	}
-
-	save(_strm, 2);
 }
 
 
@@ -292,6 +317,11 @@ bool DataFile::writeFile( const QString& filename )
 		write( ts );
 		outfile.write( qCompress( xml.toUtf8() ) );
 	}
+	else if( fullName.section( '.', -1 ) == "mmpb" )
+	{
+		cleanForWriting();
+		outfile.write( BinaryProjectFile::write( *this ) );
+	}
 	else
 	{
 		QTextStream ts( &outfile );
@@ -1428,7 +1458,15 @@ void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
 {
 	QString errorMsg;
 	int line = -1, col = -1;
-	if( !setContent( _data, &errorMsg, &line, &col ) )
+	if( BinaryProjectFile::isBinary( _data ) )
+	{
+		if( !BinaryProjectFile( _data ).read( *this ) )
+		{
+			errorMsg = "damaged binary project";
+			line = col = 0;
+		}
+	}
+	else if( !setContent( _data, &errorMsg, &line, &col ) )
 	{
 		// parsing failed? then try to uncompress data
 		QByteArray uncompressed = qUncompress( _data );
@@ -1439,21 +1477,21 @@ void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
 				line = col = -1;
 			}
 		}
-		if( line >= 0 && col >= 0 )
+	}
+	if( line >= 0 && col >= 0 )
+	{
+		qWarning() << "at line" << line << "column" << errorMsg;
+		if( gui )
 		{
-			qWarning() << "at line" << line << "column" << errorMsg;
-			if( gui )
-			{
-				QMessageBox::critical( NULL,
-					SongEditor::tr( "Error in file" ),
-					SongEditor::tr( "The file %1 seems to contain "
-							"errors and therefore can't be "
-							"loaded." ).
-								arg( _sourceFile ) );
-			}
-
-			return;
+			QMessageBox::critical( NULL,
+				SongEditor::tr( "Error in file" ),
+				SongEditor::tr( "The file %1 seems to contain "
+						"errors and therefore can't be "
+						"loaded." ).
+							arg( _sourceFile ) );
 		}
+
+		return;
 	}
 
 	QDomElement root = documentElement();
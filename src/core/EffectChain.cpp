@@ -30,12 +30,31 @@
 #include "Effect.h"
 #include "DummyEffect.h"
 #include "MixHelpers.h"
+#include "Mixer.h"
 #include "Song.h"
 
 
+// the mixer is gone already when the last tracks get deleted on shutdown
+template<typename T>
+static void retire( T * object )
+{
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->retire( object );
+	}
+	else
+	{
+		delete object;
+	}
+}
+
+
+
+
 EffectChain::EffectChain( Model * _parent ) :
 	Model( _parent ),
 	SerializingObject(),
+	m_processedEffects( new EffectList ),
 	m_enabledModel( false, NULL, tr( "Effects enabled" ) )
 {
 }
@@ -46,6 +65,7 @@ EffectChain::EffectChain( Model * _parent ) :
 EffectChain::~EffectChain()
 {
 	clear();
+	retire( m_processedEffects.load() );
 }
 
 
@@ -78,8 +98,6 @@ void EffectChain::loadSettings( const QDomElement & _this )
 {
 	clear();
 
-	// TODO This method should probably also lock the mixer
-
 	m_enabledModel.loadSettings( _this, "enabled" );
 
 	const int plugin_cnt = _this.attribute( "numofeffects" ).toInt();
@@ -113,6 +131,8 @@ void EffectChain::loadSettings( const QDomElement & _this )
 		node = node.nextSibling();
 	}
 
+	publishEffects();
+
 	emit dataChanged();
 }
 
@@ -121,9 +141,8 @@ void EffectChain::loadSettings( const QDomElement & _this )
 
 void EffectChain::appendEffect( Effect * _effect )
 {
-	Engine::mixer()->requestChangeInModel();
 	m_effects.append( _effect );
-	Engine::mixer()->doneChangeInModel();
+	publishEffects();
 
 	m_enabledModel.setValue( true );
 
@@ -133,19 +152,16 @@ void EffectChain::appendEffect( Effect * _effect )
 
 
 
+// the caller has to retire the effect, the audio threads might still use it
 void EffectChain::removeEffect( Effect * _effect )
 {
-	Engine::mixer()->requestChangeInModel();
-
 	Effect ** found = std::find( m_effects.begin(), m_effects.end(), _effect );
 	if( found == m_effects.end() )
 	{
-		Engine::mixer()->doneChangeInModel();
 		return;
 	}
 	m_effects.erase( found );
-
-	Engine::mixer()->doneChangeInModel();
+	publishEffects();
 
 	if( m_effects.isEmpty() )
 	{
@@ -164,6 +180,7 @@ void EffectChain::moveDown( Effect * _effect )
 	{
 		int i = m_effects.indexOf(_effect);
 		std::swap(m_effects[i + 1], m_effects[i]);
+		publishEffects();
 	}
 }
 
@@ -176,6 +193,7 @@ void EffectChain::moveUp( Effect * _effect )
 	{
 		int i = m_effects.indexOf(_effect);
 		std::swap(m_effects[i - 1], m_effects[i]);
+		publishEffects();
 	}
 }
 
@@ -191,8 +209,10 @@ bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, b
 
 	MixHelpers::sanitize( _buf, _frames );
 
+	const EffectList & effects = *m_processedEffects.load();
+
 	bool moreEffects = false;
-	for( EffectList::Iterator it = m_effects.begin(); it != m_effects.end(); ++it )
+	for( EffectList::ConstIterator it = effects.begin(); it != effects.end(); ++it )
 	{
 		if( hasInputNoise || ( *it )->isRunning() )
 		{
@@ -207,6 +227,31 @@ bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, b
 
 
 
+f_cnt_t EffectChain::latency() const
+{
+	if( m_enabledModel.value() == false )
+	{
+		return 0;
+	}
+
+	const EffectList & effects = *m_processedEffects.load();
+
+	// the effects process one after another
+	f_cnt_t frames = 0;
+	for( EffectList::ConstIterator it = effects.begin();
+						it != effects.end(); ++it )
+	{
+		if( ( *it )->isEnabled() )
+		{
+			frames += ( *it )->latency();
+		}
+	}
+	return frames;
+}
+
+
+
+
 void EffectChain::startRunning()
 {
 	if( m_enabledModel.value() == false )
@@ -214,8 +259,10 @@ void EffectChain::startRunning()
 		return;
 	}
 
-	for( EffectList::Iterator it = m_effects.begin();
-						it != m_effects.end(); it++ )
+	const EffectList & effects = *m_processedEffects.load();
+
+	for( EffectList::ConstIterator it = effects.begin();
+						it != effects.end(); it++ )
 	{
 		( *it )->startRunning();
 	}
@@ -228,16 +275,24 @@ void EffectChain::clear()
 {
 	emit aboutToClear();
 
-	Engine::mixer()->requestChangeInModel();
+	const EffectList effects = m_effects;
+	m_effects.clear();
+	publishEffects();
 
-	while( m_effects.count() )
+	for( int i = effects.count() - 1; i >= 0; --i )
 	{
-		Effect * e = m_effects[m_effects.count() - 1];
-		m_effects.pop_back();
-		delete e;
+		// we might be gone before the effect gets deleted
+		effects[i]->setParent( NULL );
+		retire( effects[i] );
 	}
 
-	Engine::mixer()->doneChangeInModel();
-
 	m_enabledModel.setValue( false );
 }
+
+
+
+
+void EffectChain::publishEffects()
+{
+	retire( m_processedEffects.exchange( new EffectList( m_effects ) ) );
+}
@@ -30,6 +30,7 @@
 #include "Ladspa2LMMS.h"
 #include "Lv2Manager.h"
 #include "Mixer.h"
+#include "PerfLog.h"
 #include "Plugin.h"
 #include "PresetPreviewPlayHandle.h"
 #include "ProjectJournal.h"
@@ -68,10 +69,14 @@ void LmmsCore::init( bool renderOnly )
 	s_bbTrackContainer = new BBTrackContainer;
 
 #ifdef LMMS_HAVE_LV2
+	PerfLogTimer lv2Timer( "LV2 discovery" );
 	s_lv2Manager = new Lv2Manager;
 	s_lv2Manager->initPlugins();
+	lv2Timer.end();
 #endif
+	PerfLogTimer ladspaTimer( "LADSPA discovery" );
 	s_ladspaManager = new Ladspa2LMMS;
+	ladspaTimer.end();
 
 	s_projectJournal->setJournalling( true );
 
@@ -100,6 +105,10 @@ void LmmsCore::destroy()
 	deleteHelper( &s_bbTrackContainer );
 	deleteHelper( &s_dummyTC );
 
+	// retired channels and effects might still need the FX mixer and the
+	// mixer, anything retired from now on is deleted right away as
+	// processing stopped
+	s_mixer->reclaimRetired();
 	deleteHelper( &s_fxMixer );
 	deleteHelper( &s_mixer );
 
@@ -24,6 +24,7 @@
 
 #include <QDomElement>
 
+#include "AudioPort.h"
 #include "BufferManager.h"
 #include "FxMixer.h"
 #include "Mixer.h"
@@ -59,21 +60,23 @@ void FxRoute::updateName()
 }
 
 
-FxChannel::FxChannel( int idx, Model * _parent ) :
+// the models are members, so they must not be deleted by a parent
+FxChannel::FxChannel( int idx ) :
 	m_fxChain( NULL ),
 	m_hasInput( false ),
 	m_stillRunning( false ),
 	m_peakLeft( 0.0f ),
 	m_peakRight( 0.0f ),
 	m_buffer( new sampleFrame[Engine::mixer()->framesPerPeriod()] ),
-	m_muteModel( false, _parent ),
-	m_soloModel( false, _parent ),
-	m_volumeModel( 1.0, 0.0, 2.0, 0.001, _parent ),
+	m_muteModel( false, NULL ),
+	m_soloModel( false, NULL ),
+	m_volumeModel( 1.0, 0.0, 2.0, 0.001, NULL ),
 	m_name(),
 	m_lock(),
 	m_channelIndex( idx ),
 	m_queued( false ),
 	m_hasColor( false ),
+	m_dependencies( 0 ),
 	m_dependenciesMet(0)
 {
 	BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
@@ -102,7 +105,7 @@ inline void FxChannel::processed()
 void FxChannel::incrementDeps()
 {
 	int i = m_dependenciesMet++ + 1;
-	if( i >= m_receives.size() && ! m_queued )
+	if( i >= m_dependencies && ! m_queued )
 	{
 		m_queued = true;
 		MixerWorkerThread::addJob( this );
@@ -117,6 +120,29 @@ void FxChannel::unmuteForSolo()
 
 
 
+f_cnt_t FxChannel::latency()
+{
+	// inputs are mixed as they are, so the channel is as late as the
+	// latest of them
+	f_cnt_t frames = 0;
+	for( AudioPort * port : Engine::mixer()->audioPorts() )
+	{
+		if( port->nextFxChannel() == m_channelIndex )
+		{
+			frames = qMax( frames, port->latency() );
+		}
+	}
+	for( FxRoute * receive : m_receives )
+	{
+		frames = qMax( frames, receive->sender()->latency() );
+	}
+
+	return frames + m_fxChain.latency();
+}
+
+
+
+
 void FxChannel::doProcessing()
 {
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
@@ -220,7 +246,8 @@ int FxMixer::createChannel()
 {
 	const int index = m_fxChannels.size();
 	// create new channel
-	m_fxChannels.push_back( new FxChannel( index, this ) );
+	m_fxChannels.push_back( new FxChannel( index ) );
+	Engine::mixer()->invalidateRenderGraph();
 
 	// reset channel state
 	clearChannel( index );
@@ -343,9 +370,7 @@ void FxMixer::deleteChannel( int index )
 	// if m_lastSoloed is > delete index, it will move left
 	else if (m_lastSoloed > index) { --m_lastSoloed; }
 
-	// actually delete the channel
 	m_fxChannels.remove(index);
-	delete ch;
 
 	for( int i = index; i < m_fxChannels.size(); ++i )
 	{
@@ -365,7 +390,12 @@ void FxMixer::deleteChannel( int index )
 		}
 	}
 
+	Engine::mixer()->invalidateRenderGraph();
 	Engine::mixer()->doneChangeInModel();
+
+	// delete the channel once the audio threads are done with it, not
+	// while holding them up, as deleting its effects takes a while
+	Engine::mixer()->retire( ch );
 }
 
 
@@ -429,6 +459,7 @@ void FxMixer::moveChannelLeft( int index )
 	// Update m_channelIndex of both channels
 	m_fxChannels[index]->m_channelIndex = index;
 	m_fxChannels[index - 1]->m_channelIndex = index -1;
+	Engine::mixer()->invalidateRenderGraph();
 }
 
 
@@ -469,9 +500,10 @@ FxRoute * FxMixer::createRoute( FxChannel * from, FxChannel * to, float amount )
 	{
 		return NULL;
 	}
-	Engine::mixer()->requestChangeInModel();
 	FxRoute * route = new FxRoute( from, to, amount );
 
+	Engine::mixer()->requestChangeInModel();
+
 	// add us to from's sends
 	from->m_sends.append( route );
 
@@ -480,6 +512,7 @@ FxRoute * FxMixer::createRoute( FxChannel * from, FxChannel * to, float amount )
 
 	// add us to fxmixer's list
 	Engine::fxMixer()->m_fxRoutes.append( route );
+	Engine::mixer()->invalidateRenderGraph();
 	Engine::mixer()->doneChangeInModel();
 
 	return route;
@@ -513,9 +546,11 @@ void FxMixer::deleteChannelSend( FxRoute * route )
 	// remove us from to's receives
 	route->receiver()->m_receives.remove( route->receiver()->m_receives.indexOf( route ) );
 	// remove us from fxmixer's list
-	Engine::fxMixer()->m_fxRoutes.remove( Engine::fxMixer()->m_fxRoutes.indexOf( route ) );
-	delete route;
+	m_fxRoutes.remove( m_fxRoutes.indexOf( route ) );
+	Engine::mixer()->invalidateRenderGraph();
 	Engine::mixer()->doneChangeInModel();
+
+	Engine::mixer()->retire( route );
 }
 
 
@@ -602,32 +637,49 @@ void FxMixer::prepareMasterMix()
 
 
 
-void FxMixer::masterMix( sampleFrame * _buf )
+void FxMixer::startMasterMix()
 {
-	const int fpp = Engine::mixer()->framesPerPeriod();
+	// the job queue has been reset by the mixer already as the render
+	// graph also contains play handles and audio ports
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_muted = ch->m_muteModel.value();
+		// muted channels must never get queued by their inputs
+		ch->m_queued = ch->m_muted;
+	}
 
-	// add the channels that have no dependencies (no incoming senders, ie.
-	// no receives) to the jobqueue. The channels that have receives get
-	// added when their senders get processed, which is detected by
+	// add the channels that have no dependencies (no incoming senders or
+	// audio ports) to the jobqueue. The channels that have inputs get
+	// added when their inputs get processed, which is detected by
 	// dependency counting.
 	// also instantly add all muted channels as they don't need to care
 	// about their senders, and can just increment the deps of their
 	// recipients right away.
-	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
 	for( FxChannel * ch : m_fxChannels )
 	{
-		ch->m_muted = ch->m_muteModel.value();
 		if( ch->m_muted ) // instantly "process" muted channels
 		{
 			ch->processed();
 			ch->done();
 		}
-		else if( ch->m_receives.size() == 0 )
+		else if( ch->m_dependencies == 0 )
 		{
 			ch->m_queued = true;
 			MixerWorkerThread::addJob( ch );
 		}
 	}
+}
+
+
+
+
+void FxMixer::masterMix( sampleFrame * _buf )
+{
+	const int fpp = Engine::mixer()->framesPerPeriod();
+
+	// process the whole render graph at least once - even with a muted
+	// master channel play handles have to proceed
+	MixerWorkerThread::startAndWaitForJobs();
 	while (m_fxChannels[0]->state() != ThreadableJob::ProcessingState::Done)
 	{
 		bool found = false;
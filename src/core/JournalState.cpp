@@ -0,0 +1,398 @@
+/*
+ * JournalState.cpp - compact form of journalled states and their deltas
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "JournalState.h"
+
+#include <QDomDocument>
+
+#include <algorithm>
+#include <vector>
+
+
+// record types
+static const char ElementRecord = 'E';
+static const char TextRecord = 'T';
+static const char CDataRecord = 'C';
+
+// bigger differences are stored as a single replacement, as the steps
+// needed to find the shortest edit use quadratic memory
+static const int MaxDiffSteps = 1000;
+
+// per record bookkeeping of QVector and QByteArray
+static const size_t RecordOverhead = sizeof( QByteArray ) + 24;
+
+
+
+
+static void writeUInt( QByteArray & record, quint32 value, int bytes )
+{
+	for( int i = 0; i < bytes; ++i )
+	{
+		record.append( static_cast<char>( ( value >> ( 8 * i ) ) & 0xff ) );
+	}
+}
+
+
+
+
+static void writeString( QByteArray & record, const QString & string )
+{
+	const QByteArray utf8 = string.toUtf8();
+	writeUInt( record, utf8.size(), 4 );
+	record.append( utf8 );
+}
+
+
+
+
+class RecordReader
+{
+public:
+	RecordReader( const QByteArray & record ) :
+		m_record( record ),
+		m_pos( 0 )
+	{
+	}
+
+	quint32 readUInt( int bytes )
+	{
+		quint32 value = 0;
+		for( int i = 0; i < bytes; ++i )
+		{
+			value |= static_cast<quint32>( static_cast<uchar>(
+					m_record[m_pos++] ) ) << ( 8 * i );
+		}
+		return value;
+	}
+
+	QString readString()
+	{
+		const int size = readUInt( 4 );
+		const QString string = QString::fromUtf8(
+					m_record.constData() + m_pos, size );
+		m_pos += size;
+		return string;
+	}
+
+private:
+	const QByteArray & m_record;
+	int m_pos;
+
+} ;
+
+
+
+
+static size_t recordsMemoryUsage( const QVector<QByteArray> & records )
+{
+	size_t usage = 0;
+	for( const QByteArray & record : records )
+	{
+		usage += record.size() + RecordOverhead;
+	}
+	return usage;
+}
+
+
+
+
+size_t JournalState::Delta::memoryUsage() const
+{
+	size_t usage = 0;
+	for( const Edit & edit : m_edits )
+	{
+		usage += sizeof( Edit ) + recordsMemoryUsage( edit.inserted );
+	}
+	return usage;
+}
+
+
+
+
+JournalState::JournalState( const QDomElement & element )
+{
+	if( !element.isNull() )
+	{
+		addNode( element, 0 );
+	}
+}
+
+
+
+
+void JournalState::addNode( const QDomNode & node, int depth )
+{
+	QByteArray record;
+
+	if( node.isElement() )
+	{
+		record.append( ElementRecord );
+		writeUInt( record, depth, 2 );
+		writeString( record, node.nodeName() );
+
+		// sorted, so that equal elements always give equal records
+		const QDomNamedNodeMap attributes = node.attributes();
+		QVector<QDomAttr> sorted;
+		for( int i = 0; i < attributes.count(); ++i )
+		{
+			sorted.push_back( attributes.item( i ).toAttr() );
+		}
+		std::sort( sorted.begin(), sorted.end(),
+			[]( const QDomAttr & a, const QDomAttr & b )
+			{
+				return a.name() < b.name();
+			} );
+
+		writeUInt( record, sorted.size(), 4 );
+		for( const QDomAttr & attribute : sorted )
+		{
+			writeString( record, attribute.name() );
+			writeString( record, attribute.value() );
+		}
+		m_records.push_back( record );
+
+		for( QDomNode child = node.firstChild(); !child.isNull();
+						child = child.nextSibling() )
+		{
+			addNode( child, depth + 1 );
+		}
+	}
+	else if( node.isCDATASection() || node.isText() )
+	{
+		record.append( node.isCDATASection() ? CDataRecord : TextRecord );
+		writeUInt( record, depth, 2 );
+		writeString( record, node.nodeValue() );
+		m_records.push_back( record );
+	}
+}
+
+
+
+
+QDomElement JournalState::toElement( QDomDocument & doc, QDomNode & parent ) const
+{
+	QDomElement root;
+
+	// the innermost element opened at each depth
+	QVector<QDomNode> parents;
+	parents.push_back( parent );
+
+	for( const QByteArray & record : m_records )
+	{
+		RecordReader reader( record );
+		const char type = static_cast<char>( reader.readUInt( 1 ) );
+		const int depth = reader.readUInt( 2 );
+
+		QDomNode node;
+		if( type == ElementRecord )
+		{
+			QDomElement element = doc.createElement( reader.readString() );
+			const int attributes = reader.readUInt( 4 );
+			for( int i = 0; i < attributes; ++i )
+			{
+				const QString name = reader.readString();
+				element.setAttribute( name, reader.readString() );
+			}
+			node = element;
+		}
+		else if( type == CDataRecord )
+		{
+			node = doc.createCDATASection( reader.readString() );
+		}
+		else
+		{
+			node = doc.createTextNode( reader.readString() );
+		}
+
+		parents[depth].appendChild( node );
+		if( type == ElementRecord )
+		{
+			parents.resize( depth + 2 );
+			parents[depth + 1] = node;
+			if( depth == 0 )
+			{
+				root = node.toElement();
+			}
+		}
+	}
+
+	return root;
+}
+
+
+
+
+size_t JournalState::memoryUsage() const
+{
+	return recordsMemoryUsage( m_records );
+}
+
+
+
+
+JournalState::Delta JournalState::diff( const JournalState & from,
+						const JournalState & to )
+{
+	const QVector<QByteArray> & a = from.m_records;
+	const QVector<QByteArray> & b = to.m_records;
+
+	// skip unchanged records at the start and at the end
+	int start = 0;
+	while( start < a.size() && start < b.size() && a[start] == b[start] )
+	{
+		++start;
+	}
+	int endA = a.size();
+	int endB = b.size();
+	while( endA > start && endB > start && a[endA - 1] == b[endB - 1] )
+	{
+		--endA;
+		--endB;
+	}
+
+	const int n = endA - start;
+	const int m = endB - start;
+
+	Delta delta;
+	if( n == 0 && m == 0 )
+	{
+		return delta;
+	}
+
+	// Myers' O(ND) difference algorithm on the remaining records: v holds
+	// the furthest x reached on each diagonal k = x - y, its state before
+	// each step is kept in trace for finding the edits afterwards
+	const int maxSteps = std::min( n + m, MaxDiffSteps );
+	const int offset = maxSteps + 1;
+	std::vector<int> v( 2 * maxSteps + 3, 0 );
+	std::vector<std::vector<int> > trace;
+
+	int steps = -1;
+	for( int d = 0; d <= maxSteps && steps < 0; ++d )
+	{
+		trace.emplace_back( v.begin() + offset - d - 1,
+					v.begin() + offset + d + 2 );
+		for( int k = -d; k <= d; k += 2 )
+		{
+			int x = k == -d || ( k != d &&
+					v[offset + k - 1] < v[offset + k + 1] ) ?
+						v[offset + k + 1] :
+						v[offset + k - 1] + 1;
+			int y = x - k;
+			while( x < n && y < m && a[start + x] == b[start + y] )
+			{
+				++x;
+				++y;
+			}
+			v[offset + k] = x;
+			if( x >= n && y >= m )
+			{
+				steps = d;
+				break;
+			}
+		}
+	}
+
+	if( steps < 0 )
+	{
+		Delta::Edit edit = { start, n, b.mid( start, m ) };
+		delta.m_edits.push_back( edit );
+		return delta;
+	}
+
+	// walk back from the end, each step is one removed or inserted record
+	struct Step
+	{
+		int x;
+		int y;
+		bool insert;
+	} ;
+	std::vector<Step> path;
+
+	int x = n;
+	int y = m;
+	for( int d = steps; d > 0; --d )
+	{
+		const std::vector<int> & prev = trace[d];
+		const int k = x - y;
+		const bool insert = k == -d || ( k != d &&
+				prev[k - 1 + d + 1] < prev[k + 1 + d + 1] );
+		const int prevK = insert ? k + 1 : k - 1;
+		const int prevX = prev[prevK + d + 1];
+		const int prevY = prevX - prevK;
+
+		const Step step = { prevX, prevY, insert };
+		path.push_back( step );
+
+		x = prevX;
+		y = prevY;
+	}
+
+	for( auto it = path.rbegin(); it != path.rend(); ++it )
+	{
+		const int pos = start + it->x;
+		if( delta.m_edits.isEmpty() || delta.m_edits.last().pos +
+					delta.m_edits.last().removed != pos )
+		{
+			Delta::Edit edit = { pos, 0, QVector<QByteArray>() };
+			delta.m_edits.push_back( edit );
+		}
+
+		Delta::Edit & edit = delta.m_edits.last();
+		if( it->insert )
+		{
+			edit.inserted.push_back( b[start + it->y] );
+		}
+		else
+		{
+			++edit.removed;
+		}
+	}
+
+	return delta;
+}
+
+
+
+
+void JournalState::apply( const Delta & delta )
+{
+	QVector<QByteArray> records;
+	records.reserve( m_records.size() );
+
+	int pos = 0;
+	for( const Delta::Edit & edit : delta.m_edits )
+	{
+		for( ; pos < edit.pos; ++pos )
+		{
+			records.push_back( m_records[pos] );
+		}
+		records += edit.inserted;
+		pos += edit.removed;
+	}
+	for( ; pos < m_records.size(); ++pos )
+	{
+		records.push_back( m_records[pos] );
+	}
+
+	m_records.swap( records );
+}
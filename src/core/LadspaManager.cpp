@@ -27,12 +27,14 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QLibrary>
 
 #include <math.h>
 
 #include "ConfigManager.h"
 #include "LadspaManager.h"
+#include "PerfLog.h"
 #include "PluginFactory.h"
 
 
@@ -56,6 +58,11 @@ LadspaManager::LadspaManager()
 	ladspaDirectories.push_back( "/Library/Audio/Plug-Ins/LADSPA" );
 #endif
 
+	LadspaPluginCache cache( LadspaPluginCache::defaultPath() );
+	int libraries = 0;
+	int indexed = 0;
+	qint64 indexTime = 0;
+
 	for( QStringList::iterator it = ladspaDirectories.begin(); 
 			 		   it != ladspaDirectories.end(); ++it )
 	{
@@ -79,25 +86,43 @@ LadspaManager::LadspaManager()
 				continue;
 			}
 
-			QLibrary plugin_lib( f.absoluteFilePath() );
-
-			if( plugin_lib.load() == true )
+			++libraries;
+			QVector<LadspaPluginCache::Plugin> plugins;
+			LADSPA_Descriptor_Function descriptorFunction = NULL;
+			if( !cache.lookup( f, plugins ) )
 			{
-				LADSPA_Descriptor_Function descriptorFunction =
-			( LADSPA_Descriptor_Function ) plugin_lib.resolve(
-							"ladspa_descriptor" );
-				if( descriptorFunction != NULL )
+				QElapsedTimer indexTimer;
+				indexTimer.start();
+
+				QLibrary plugin_lib( f.absoluteFilePath() );
+				if( plugin_lib.load() == false )
 				{
-					addPlugins( descriptorFunction,
-							f.fileName() );
+					// not indexed, so it's tried again next time
+					qWarning() << plugin_lib.errorString();
+					continue;
 				}
+				descriptorFunction =
+			( LADSPA_Descriptor_Function ) plugin_lib.resolve(
+							"ladspa_descriptor" );
+				plugins = describePlugins( descriptorFunction );
+				cache.insert( f, plugins );
+
+				++indexed;
+				indexTime += indexTimer.elapsed();
 			}
-			else
-			{
-				qWarning() << plugin_lib.errorString();
-			}
+			addPlugins( plugins, f, descriptorFunction );
 		}
 	}
+
+	if( !cache.save() )
+	{
+		qWarning( "LadspaManager: could not save the plugin index" );
+	}
+	// the total time is reported by the discovery timer in Engine
+	perfLog( "LADSPA discovery", QString( "%1 plugins in %2 libraries, "
+					"%3 libraries indexed in %4 ms" ).
+			arg( m_ladspaManagerMap.size() ).arg( libraries ).
+			arg( indexed ).arg( indexTime ) );
 	
 	l_ladspa_key_t keys = m_ladspaManagerMap.keys();
 	for( l_ladspa_key_t::iterator it = keys.begin();
@@ -139,17 +164,45 @@ ladspaManagerDescription * LadspaManager::getDescription(
 
 
 
-void LadspaManager::addPlugins(
-		LADSPA_Descriptor_Function _descriptor_func,
-						const QString & _file )
+QVector<LadspaPluginCache::Plugin> LadspaManager::describePlugins(
+		LADSPA_Descriptor_Function _descriptor_func )
 {
-	const LADSPA_Descriptor * descriptor;
+	QVector<LadspaPluginCache::Plugin> plugins;
+	if( _descriptor_func == NULL )
+	{
+		return plugins;
+	}
 
+	const LADSPA_Descriptor * descriptor;
 	for( long pluginIndex = 0;
 		( descriptor = _descriptor_func( pluginIndex ) ) != NULL;
 								++pluginIndex )
 	{
-		ladspa_key_t key( _file, QString( descriptor->Label ) );
+		LadspaPluginCache::Plugin plugin;
+		plugin.label = descriptor->Label;
+		plugin.index = pluginIndex;
+		plugin.name = descriptor->Name;
+		plugin.maker = descriptor->Maker;
+		plugin.copyright = descriptor->Copyright;
+		plugin.properties = descriptor->Properties;
+		plugin.inputChannels = getPluginInputs( descriptor );
+		plugin.outputChannels = getPluginOutputs( descriptor );
+		plugins.push_back( plugin );
+	}
+	return plugins;
+}
+
+
+
+
+void LadspaManager::addPlugins(
+		const QVector<LadspaPluginCache::Plugin> & _plugins,
+		const QFileInfo & _file,
+		LADSPA_Descriptor_Function _descriptor_func )
+{
+	for( const LadspaPluginCache::Plugin & plugin : _plugins )
+	{
+		ladspa_key_t key( _file.fileName(), plugin.label );
 		if( m_ladspaManagerMap.contains( key ) )
 		{
 			continue;
@@ -158,9 +211,16 @@ void LadspaManager::addPlugins(
 		ladspaManagerDescription * plugIn = 
 				new ladspaManagerDescription;
 		plugIn->descriptorFunction = _descriptor_func;
-		plugIn->index = pluginIndex;
-		plugIn->inputChannels = getPluginInputs( descriptor );
-		plugIn->outputChannels = getPluginOutputs( descriptor );
+		plugIn->index = plugin.index;
+		plugIn->inputChannels = plugin.inputChannels;
+		plugIn->outputChannels = plugin.outputChannels;
+		plugIn->file = _file.absoluteFilePath();
+		plugIn->loadFailed = false;
+		plugIn->label = plugin.label;
+		plugIn->name = plugin.name;
+		plugIn->maker = plugin.maker;
+		plugIn->copyright = plugin.copyright;
+		plugIn->properties = plugin.properties;
 
 		if( plugIn->inputChannels == 0 && plugIn->outputChannels > 0 )
 		{
@@ -188,6 +248,59 @@ void LadspaManager::addPlugins(
 
 
 
+bool LadspaManager::loadPlugin( ladspaManagerDescription * _plugin )
+{
+	if( _plugin->descriptorFunction != NULL || _plugin->loadFailed )
+	{
+		return !_plugin->loadFailed;
+	}
+
+	QLibrary plugin_lib( _plugin->file );
+	LADSPA_Descriptor_Function descriptorFunction = NULL;
+	if( plugin_lib.load() )
+	{
+		descriptorFunction = ( LADSPA_Descriptor_Function )
+				plugin_lib.resolve( "ladspa_descriptor" );
+	}
+	else
+	{
+		qWarning() << plugin_lib.errorString();
+	}
+
+	// the library may have been replaced since it was indexed, so look
+	// the plug-in up by its label if it moved
+	const LADSPA_Descriptor * descriptor = descriptorFunction ?
+			descriptorFunction( _plugin->index ) : NULL;
+	if( descriptor == NULL || _plugin->label != descriptor->Label )
+	{
+		descriptor = NULL;
+		for( long pluginIndex = 0; descriptorFunction != NULL &&
+			( descriptor = descriptorFunction( pluginIndex ) ) != NULL;
+								++pluginIndex )
+		{
+			if( _plugin->label == descriptor->Label )
+			{
+				_plugin->index = pluginIndex;
+				break;
+			}
+		}
+	}
+
+	if( descriptor == NULL )
+	{
+		qWarning() << "LadspaManager: plugin" << _plugin->label
+				<< "not found in" << _plugin->file;
+		_plugin->loadFailed = true;
+		return false;
+	}
+
+	_plugin->descriptorFunction = descriptorFunction;
+	return true;
+}
+
+
+
+
 uint16_t LadspaManager::getPluginInputs(
 		const LADSPA_Descriptor * _descriptor )
 {
@@ -270,8 +383,8 @@ l_sortable_plugin_t LadspaManager::getSortedPlugins()
 
 QString LadspaManager::getLabel( const ladspa_key_t & _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? descriptor->Label : "" );
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? description->label : "" );
 }
 
 
@@ -280,8 +393,8 @@ QString LadspaManager::getLabel( const ladspa_key_t & _plugin )
 bool LadspaManager::hasRealTimeDependency(
 					const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_REALTIME( descriptor->Properties )
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? LADSPA_IS_REALTIME( description->properties )
 					   : false );
 }
 
@@ -290,8 +403,8 @@ bool LadspaManager::hasRealTimeDependency(
 
 bool LadspaManager::isInplaceBroken( const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_INPLACE_BROKEN( descriptor->Properties )
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? LADSPA_IS_INPLACE_BROKEN( description->properties )
 					   : false );
 }
 
@@ -301,8 +414,8 @@ bool LadspaManager::isInplaceBroken( const ladspa_key_t &  _plugin )
 bool LadspaManager::isRealTimeCapable(
 					const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_HARD_RT_CAPABLE( descriptor->Properties )
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? LADSPA_IS_HARD_RT_CAPABLE( description->properties )
 					   : false );
 }
 
@@ -311,8 +424,8 @@ bool LadspaManager::isRealTimeCapable(
 
 QString LadspaManager::getName( const ladspa_key_t & _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? descriptor->Name : "" );
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? description->name : "" );
 }
 
 
@@ -320,8 +433,8 @@ QString LadspaManager::getName( const ladspa_key_t & _plugin )
 
 QString LadspaManager::getMaker( const ladspa_key_t & _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? descriptor->Maker : "" );
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? description->maker : "" );
 }
 
 
@@ -329,8 +442,8 @@ QString LadspaManager::getMaker( const ladspa_key_t & _plugin )
 
 QString LadspaManager::getCopyright( const ladspa_key_t & _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? descriptor->Copyright : "" );
+	const ladspaManagerDescription * description = getDescription( _plugin );
+	return( description ? description->copyright : "" );
 }
 
 
@@ -528,24 +641,11 @@ bool LadspaManager::isInteger( const ladspa_key_t & _plugin,
 
 bool LadspaManager::isEnum( const ladspa_key_t & _plugin, uint32_t _port )
 {
-	if( m_ladspaManagerMap.contains( _plugin )
-		   && _port < getPortCount( _plugin ) )
-	{
-		LADSPA_Descriptor_Function descriptorFunction =
-			m_ladspaManagerMap[_plugin]->descriptorFunction;
-		const LADSPA_Descriptor * descriptor =
-				descriptorFunction(
-					m_ladspaManagerMap[_plugin]->index );
-		LADSPA_PortRangeHintDescriptor hintDescriptor =
-			descriptor->PortRangeHints[_port].HintDescriptor;
-		// This is an LMMS extension to ladspa
-		return( LADSPA_IS_HINT_INTEGER( hintDescriptor ) &&
-			LADSPA_IS_HINT_TOGGLED( hintDescriptor ) );
-	}
-	else
-	{
-		return( false );
-	}
+	const auto* portRangeHint = getPortRangeHint( _plugin, _port );
+	// This is an LMMS extension to ladspa
+	return( portRangeHint &&
+		LADSPA_IS_HINT_INTEGER( portRangeHint->HintDescriptor ) &&
+		LADSPA_IS_HINT_TOGGLED( portRangeHint->HintDescriptor ) );
 }
 
 
@@ -574,14 +674,10 @@ const void * LadspaManager::getImplementationData(
 const LADSPA_Descriptor * LadspaManager::getDescriptor(
 						const ladspa_key_t & _plugin )
 {
-	if( m_ladspaManagerMap.contains( _plugin ) )
+	ladspaManagerDescription * description = getDescription( _plugin );
+	if( description && loadPlugin( description ) )
 	{
-		LADSPA_Descriptor_Function descriptorFunction =
-			m_ladspaManagerMap[_plugin]->descriptorFunction;
-		const LADSPA_Descriptor * descriptor =
-				descriptorFunction(
-					m_ladspaManagerMap[_plugin]->index );
-		return( descriptor );
+		return( description->descriptorFunction( description->index ) );
 	}
 	else
 	{
@@ -0,0 +1,194 @@
+/*
+ * LadspaPluginCache.cpp - persistent index of the plugins in LADSPA libraries
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "LadspaPluginCache.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+
+static const quint32 Magic = 0x4c4d4c43; // "LMLC"
+static const quint32 FormatVersion = 1;
+
+
+static QDataStream & operator<<( QDataStream & stream,
+					const LadspaPluginCache::Plugin & plugin )
+{
+	return stream << plugin.label << plugin.index << plugin.name <<
+		plugin.maker << plugin.copyright << plugin.properties <<
+		plugin.inputChannels << plugin.outputChannels;
+}
+
+
+
+
+static QDataStream & operator>>( QDataStream & stream,
+					LadspaPluginCache::Plugin & plugin )
+{
+	return stream >> plugin.label >> plugin.index >> plugin.name >>
+		plugin.maker >> plugin.copyright >> plugin.properties >>
+		plugin.inputChannels >> plugin.outputChannels;
+}
+
+
+
+
+LadspaPluginCache::LadspaPluginCache( const QString & path ) :
+	m_path( path ),
+	m_modified( false )
+{
+	QFile file( path );
+	if( !file.open( QIODevice::ReadOnly ) )
+	{
+		return;
+	}
+
+	QDataStream in( &file );
+	in.setVersion( QDataStream::Qt_5_0 );
+
+	quint32 magic, version, count;
+	in >> magic >> version >> count;
+	if( in.status() != QDataStream::Ok || magic != Magic ||
+						version != FormatVersion )
+	{
+		return;
+	}
+
+	for( quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i )
+	{
+		QString library;
+		Entry entry;
+		in >> library >> entry.size >> entry.modified >> entry.plugins;
+		m_entries.insert( library, entry );
+	}
+
+	if( in.status() != QDataStream::Ok )
+	{
+		// damaged, so index everything again
+		m_entries.clear();
+	}
+}
+
+
+
+
+QString LadspaPluginCache::defaultPath()
+{
+	return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) +
+							"/ladspa-plugins.index";
+}
+
+
+
+
+bool LadspaPluginCache::lookup( const QFileInfo & file,
+						QVector<Plugin> & plugins )
+{
+	const QString library = file.absoluteFilePath();
+	QHash<QString, Entry>::const_iterator it = m_entries.constFind( library );
+	if( it == m_entries.constEnd() || !matches( *it, file ) )
+	{
+		return false;
+	}
+
+	m_used.insert( library );
+	plugins = it->plugins;
+	return true;
+}
+
+
+
+
+void LadspaPluginCache::insert( const QFileInfo & file,
+					const QVector<Plugin> & plugins )
+{
+	Entry entry;
+	entry.size = file.size();
+	entry.modified = file.lastModified().toMSecsSinceEpoch();
+	entry.plugins = plugins;
+
+	const QString library = file.absoluteFilePath();
+	m_entries.insert( library, entry );
+	m_used.insert( library );
+	m_modified = true;
+}
+
+
+
+
+bool LadspaPluginCache::save()
+{
+	for( QHash<QString, Entry>::iterator it = m_entries.begin();
+							it != m_entries.end(); )
+	{
+		if( m_used.contains( it.key() ) )
+		{
+			++it;
+		}
+		else
+		{
+			it = m_entries.erase( it );
+			m_modified = true;
+		}
+	}
+
+	if( !m_modified )
+	{
+		return true;
+	}
+
+	QDir().mkpath( QFileInfo( m_path ).absolutePath() );
+	QSaveFile file( m_path );
+	if( !file.open( QIODevice::WriteOnly ) )
+	{
+		return false;
+	}
+
+	QDataStream out( &file );
+	out.setVersion( QDataStream::Qt_5_0 );
+	out << Magic << FormatVersion << quint32( m_entries.size() );
+	for( QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+						it != m_entries.constEnd(); ++it )
+	{
+		out << it.key() << it->size << it->modified << it->plugins;
+	}
+
+	if( out.status() != QDataStream::Ok || !file.commit() )
+	{
+		return false;
+	}
+	m_modified = false;
+	return true;
+}
+
+
+
+
+bool LadspaPluginCache::matches( const Entry & entry, const QFileInfo & file )
+{
+	return entry.size == file.size() &&
+		entry.modified == file.lastModified().toMSecsSinceEpoch();
+}
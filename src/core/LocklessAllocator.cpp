@@ -112,7 +112,8 @@ void * LocklessAllocator::alloc()
 	{
 		if( !available )
 		{
-			fprintf( stderr, "LocklessAllocator: No free space\n" );
+			// not reported here, this runs on realtime threads and the
+			// callers handle it
 			return NULL;
 		}
 	}
@@ -29,7 +29,9 @@
 #include "lmms_math.h"
 #include "ValueBuffer.h"
 
-#include <cstdio>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 
 static bool s_NaNHandler;
@@ -38,11 +40,42 @@ static bool s_NaNHandler;
 namespace MixHelpers
 {
 
+// The vector paths below handle two interleaved stereo frames per __m128 and
+// leave remaining frames to the scalar operators. Both are written to
+// compute exactly the same results.
+
+#ifdef __SSE__
+/*! \brief Spread per-frame coefficients c0..c3 to [c0 c0 c1 c1] and [c2 c2 c3 c3] */
+static inline void loadPerFrame( const sample_t* coeffs, __m128& lo, __m128& hi )
+{
+	const __m128 c = _mm_loadu_ps( coeffs );
+	lo = _mm_unpacklo_ps( c, c );
+	hi = _mm_unpackhi_ps( c, c );
+}
+
+/*! \brief Mask with all bits set in lanes containing a finite value */
+static inline __m128 finiteMask( __m128 x )
+{
+	const __m128 zero = _mm_setzero_ps();
+	// inf * 0 and nan * 0 give nan, which never compares equal
+	return _mm_cmpeq_ps( _mm_mul_ps( x, zero ), zero );
+}
+#endif
+
 /*! \brief Function for applying MIXOP on all sample frames */
 template<typename MIXOP>
 static inline void run( sampleFrame* dst, const sampleFrame* src, int frames, const MIXOP& OP )
 {
-	for( int i = 0; i < frames; ++i )
+	int i = 0;
+#ifdef __SSE__
+	for( ; i + 2 <= frames; i += 2 )
+	{
+		__m128 d = _mm_loadu_ps( dst[i].data() );
+		OP( d, _mm_loadu_ps( src[i].data() ) );
+		_mm_storeu_ps( dst[i].data(), d );
+	}
+#endif
+	for( ; i < frames; ++i )
 	{
 		OP( dst[i], src[i] );
 	}
@@ -52,20 +85,98 @@ static inline void run( sampleFrame* dst, const sampleFrame* src, int frames, co
 template<typename MIXOP>
 static inline void run( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, int frames, const MIXOP& OP )
 {
-	for( int i = 0; i < frames; ++i )
+	int i = 0;
+#ifdef __SSE__
+	for( ; i + 4 <= frames; i += 4 )
+	{
+		const __m128 l = _mm_loadu_ps( srcLeft + i );
+		const __m128 r = _mm_loadu_ps( srcRight + i );
+		__m128 d0 = _mm_loadu_ps( dst[i].data() );
+		__m128 d1 = _mm_loadu_ps( dst[i + 2].data() );
+		OP( d0, _mm_unpacklo_ps( l, r ) );
+		OP( d1, _mm_unpackhi_ps( l, r ) );
+		_mm_storeu_ps( dst[i].data(), d0 );
+		_mm_storeu_ps( dst[i + 2].data(), d1 );
+	}
+#endif
+	for( ; i < frames; ++i )
 	{
 		const sampleFrame src = { srcLeft[i], srcRight[i] };
 		OP( dst[i], src );
 	}
 }
 
+/*! \brief Function for applying MIXOP on all sample frames - with per-frame coefficients */
+template<typename MIXOP>
+static inline void run( sampleFrame* dst, const sampleFrame* src, const sample_t* coeffs, int frames, const MIXOP& OP )
+{
+	int i = 0;
+#ifdef __SSE__
+	for( ; i + 4 <= frames; i += 4 )
+	{
+		__m128 c0, c1;
+		loadPerFrame( coeffs + i, c0, c1 );
+		__m128 d0 = _mm_loadu_ps( dst[i].data() );
+		__m128 d1 = _mm_loadu_ps( dst[i + 2].data() );
+		OP( d0, _mm_loadu_ps( src[i].data() ), c0 );
+		OP( d1, _mm_loadu_ps( src[i + 2].data() ), c1 );
+		_mm_storeu_ps( dst[i].data(), d0 );
+		_mm_storeu_ps( dst[i + 2].data(), d1 );
+	}
+#endif
+	for( ; i < frames; ++i )
+	{
+		OP( dst[i], src[i], coeffs[i] );
+	}
+}
+
+/*! \brief Function for applying MIXOP on all sample frames - with two sets of per-frame coefficients */
+template<typename MIXOP>
+static inline void run( sampleFrame* dst, const sampleFrame* src, const sample_t* coeffs1, const sample_t* coeffs2, int frames, const MIXOP& OP )
+{
+	int i = 0;
+#ifdef __SSE__
+	for( ; i + 4 <= frames; i += 4 )
+	{
+		__m128 c10, c11, c20, c21;
+		loadPerFrame( coeffs1 + i, c10, c11 );
+		loadPerFrame( coeffs2 + i, c20, c21 );
+		__m128 d0 = _mm_loadu_ps( dst[i].data() );
+		__m128 d1 = _mm_loadu_ps( dst[i + 2].data() );
+		OP( d0, _mm_loadu_ps( src[i].data() ), c10, c20 );
+		OP( d1, _mm_loadu_ps( src[i + 2].data() ), c11, c21 );
+		_mm_storeu_ps( dst[i].data(), d0 );
+		_mm_storeu_ps( dst[i + 2].data(), d1 );
+	}
+#endif
+	for( ; i < frames; ++i )
+	{
+		OP( dst[i], src[i], coeffs1[i], coeffs2[i] );
+	}
+}
+
 
 
 bool isSilent( const sampleFrame* src, int frames )
 {
 	const float silenceThreshold = 0.0000001f;
 
-	for( int i = 0; i < frames; ++i )
+	int i = 0;
+#ifdef __SSE__
+	const __m128 threshold = _mm_set1_ps( silenceThreshold );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	for( ; i + 4 <= frames; i += 4 )
+	{
+		const __m128 a0 = _mm_andnot_ps( signMask, _mm_loadu_ps( src[i].data() ) );
+		const __m128 a1 = _mm_andnot_ps( signMask, _mm_loadu_ps( src[i + 2].data() ) );
+		if( _mm_movemask_ps( _mm_or_ps( _mm_cmpge_ps( a0, threshold ),
+						_mm_cmpge_ps( a1, threshold ) ) ) )
+		{
+			return false;
+		}
+	}
+#endif
+	for( ; i < frames; ++i )
 	{
 		if( fabsf( src[i][0] ) >= silenceThreshold || fabsf( src[i][1] ) >= silenceThreshold )
 		{
@@ -94,8 +205,24 @@ bool sanitize( sampleFrame * src, int frames )
 		return false;
 	}
 
+	int f = 0;
+#ifdef __SSE__
+	const __m128 lower = _mm_set1_ps( -1000.0f );
+	const __m128 upper = _mm_set1_ps( 1000.0f );
+	for( ; f + 2 <= frames; f += 2 )
+	{
+		const __m128 x = _mm_loadu_ps( src[f].data() );
+		if( _mm_movemask_ps( finiteMask( x ) ) != 0xf )
+		{
+			// let the scalar loop below report and clear the buffer
+			break;
+		}
+		_mm_storeu_ps( src[f].data(), _mm_max_ps( lower, _mm_min_ps( x, upper ) ) );
+	}
+#endif
+
 	bool found = false;
-	for( int f = 0; f < frames; ++f )
+	for( ; f < frames; ++f )
 	{
 		for( int c = 0; c < 2; ++c )
 		{
@@ -125,6 +252,42 @@ bool sanitize( sampleFrame * src, int frames )
 }
 
 
+void getPeakValues( const sampleFrame* src, int frames, sample_t& peakLeft, sample_t& peakRight )
+{
+	peakLeft = 0.0f;
+	peakRight = 0.0f;
+
+	int f = 0;
+#ifdef __SSE__
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	__m128 peak = _mm_setzero_ps();
+	for( ; f + 2 <= frames; f += 2 )
+	{
+		// keeps the old peak when reading a nan, like the scalar loop
+		peak = _mm_max_ps( _mm_andnot_ps( signMask, _mm_loadu_ps( src[f].data() ) ), peak );
+	}
+	float peaks[4];
+	_mm_storeu_ps( peaks, peak );
+	peakLeft = qMax( peaks[0], peaks[2] );
+	peakRight = qMax( peaks[1], peaks[3] );
+#endif
+	for( ; f < frames; ++f )
+	{
+		float const absLeft = fabsf( src[f][0] );
+		float const absRight = fabsf( src[f][1] );
+		if( absLeft > peakLeft )
+		{
+			peakLeft = absLeft;
+		}
+
+		if( absRight > peakRight )
+		{
+			peakRight = absRight;
+		}
+	}
+}
+
+
 struct AddOp
 {
 	void operator()( sampleFrame& dst, const sampleFrame& src ) const
@@ -132,6 +295,13 @@ struct AddOp
 		dst[0] += src[0];
 		dst[1] += src[1];
 	}
+
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		dst = _mm_add_ps( dst, src );
+	}
+#endif
 } ;
 
 void add( sampleFrame* dst, const sampleFrame* src, int frames )
@@ -151,6 +321,13 @@ struct AddMultipliedOp
 		dst[1] += src[1] * m_coeff;
 	}
 
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		dst = _mm_add_ps( dst, _mm_mul_ps( src, _mm_set1_ps( m_coeff ) ) );
+	}
+#endif
+
 	const float m_coeff;
 } ;
 
@@ -171,6 +348,14 @@ struct AddSwappedMultipliedOp
 		dst[1] += src[0] * m_coeff;
 	}
 
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		const __m128 swapped = _mm_shuffle_ps( src, src, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		dst = _mm_add_ps( dst, _mm_mul_ps( swapped, _mm_set1_ps( m_coeff ) ) );
+	}
+#endif
+
 	const float m_coeff;
 };
 
@@ -180,25 +365,75 @@ void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeff
 }
 
 
-void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+struct AddMultipliedByBufferOp
 {
-	for( int f = 0; f < frames; ++f )
+	AddMultipliedByBufferOp( float coeff ) : m_coeff( coeff ) { }
+
+	void operator()( sampleFrame& dst, const sampleFrame& src, float coeffBuf ) const
 	{
-		dst[f][0] += src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		dst[0] += src[0] * m_coeff * coeffBuf;
+		dst[1] += src[1] * m_coeff * coeffBuf;
 	}
+
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src, __m128 coeffBuf ) const
+	{
+		dst = _mm_add_ps( dst, _mm_mul_ps( _mm_mul_ps( src, _mm_set1_ps( m_coeff ) ), coeffBuf ) );
+	}
+#endif
+
+	const float m_coeff;
+} ;
+
+void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+{
+	run<>( dst, src, coeffSrcBuf->values(), frames, AddMultipliedByBufferOp(coeffSrc) );
 }
 
-void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+
+struct AddMultipliedByBuffersOp
 {
-	for( int f = 0; f < frames; ++f )
+	void operator()( sampleFrame& dst, const sampleFrame& src, float coeffBuf1, float coeffBuf2 ) const
+	{
+		dst[0] += src[0] * coeffBuf1 * coeffBuf2;
+		dst[1] += src[1] * coeffBuf1 * coeffBuf2;
+	}
+
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src, __m128 coeffBuf1, __m128 coeffBuf2 ) const
 	{
-		dst[f][0] += src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
-		dst[f][1] += src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+		dst = _mm_add_ps( dst, _mm_mul_ps( _mm_mul_ps( src, coeffBuf1 ), coeffBuf2 ) );
 	}
+#endif
+} ;
 
+void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+{
+	run<>( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames, AddMultipliedByBuffersOp() );
 }
 
+
+struct AddSanitizedMultipliedByBufferOp
+{
+	AddSanitizedMultipliedByBufferOp( float coeff ) : m_coeff( coeff ) { }
+
+	void operator()( sampleFrame& dst, const sampleFrame& src, float coeffBuf ) const
+	{
+		dst[0] += ( isinf( src[0] ) || isnan( src[0] ) ) ? 0.0f : src[0] * m_coeff * coeffBuf;
+		dst[1] += ( isinf( src[1] ) || isnan( src[1] ) ) ? 0.0f : src[1] * m_coeff * coeffBuf;
+	}
+
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src, __m128 coeffBuf ) const
+	{
+		const __m128 mixed = _mm_mul_ps( _mm_mul_ps( src, _mm_set1_ps( m_coeff ) ), coeffBuf );
+		dst = _mm_add_ps( dst, _mm_and_ps( finiteMask( src ), mixed ) );
+	}
+#endif
+
+	const float m_coeff;
+} ;
+
 void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
 {
 	if ( !useNaNHandler() )
@@ -208,12 +443,30 @@ void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, f
 		return;
 	}
 
-	for( int f = 0; f < frames; ++f )
+	run<>( dst, src, coeffSrcBuf->values(), frames, AddSanitizedMultipliedByBufferOp(coeffSrc) );
+}
+
+
+struct AddSanitizedMultipliedByBuffersOp
+{
+	void operator()( sampleFrame& dst, const sampleFrame& src, float coeffBuf1, float coeffBuf2 ) const
+	{
+		dst[0] += ( isinf( src[0] ) || isnan( src[0] ) )
+			? 0.0f
+			: src[0] * coeffBuf1 * coeffBuf2;
+		dst[1] += ( isinf( src[1] ) || isnan( src[1] ) )
+			? 0.0f
+			: src[1] * coeffBuf1 * coeffBuf2;
+	}
+
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src, __m128 coeffBuf1, __m128 coeffBuf2 ) const
 	{
-		dst[f][0] += ( isinf( src[f][0] ) || isnan( src[f][0] ) ) ? 0.0f : src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += ( isinf( src[f][1] ) || isnan( src[f][1] ) ) ? 0.0f : src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		const __m128 mixed = _mm_mul_ps( _mm_mul_ps( src, coeffBuf1 ), coeffBuf2 );
+		dst = _mm_add_ps( dst, _mm_and_ps( finiteMask( src ), mixed ) );
 	}
-}
+#endif
+} ;
 
 void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
 {
@@ -224,16 +477,7 @@ void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src,
 		return;
 	}
 
-	for( int f = 0; f < frames; ++f )
-	{
-		dst[f][0] += ( isinf( src[f][0] ) || isnan( src[f][0] ) )
-			? 0.0f
-			: src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
-		dst[f][1] += ( isinf( src[f][1] ) || isnan( src[f][1] ) )
-			? 0.0f
-			: src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
-	}
-
+	run<>( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames, AddSanitizedMultipliedByBuffersOp() );
 }
 
 
@@ -247,6 +491,14 @@ struct AddSanitizedMultipliedOp
 		dst[1] += ( isinf( src[1] ) || isnan( src[1] ) ) ? 0.0f : src[1] * m_coeff;
 	}
 
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		const __m128 mixed = _mm_mul_ps( src, _mm_set1_ps( m_coeff ) );
+		dst = _mm_add_ps( dst, _mm_and_ps( finiteMask( src ), mixed ) );
+	}
+#endif
+
 	const float m_coeff;
 };
 
@@ -277,6 +529,14 @@ struct AddMultipliedStereoOp
 		dst[1] += src[1] * m_coeffs[1];
 	}
 
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		const __m128 coeffs = _mm_setr_ps( m_coeffs[0], m_coeffs[1], m_coeffs[0], m_coeffs[1] );
+		dst = _mm_add_ps( dst, _mm_mul_ps( src, coeffs ) );
+	}
+#endif
+
 	float m_coeffs[2];
 } ;
 
@@ -305,6 +565,14 @@ struct MultiplyAndAddMultipliedOp
 		dst[1] = dst[1]*m_coeffs[0] + src[1]*m_coeffs[1];
 	}
 
+#ifdef __SSE__
+	void operator()( __m128& dst, __m128 src ) const
+	{
+		dst = _mm_add_ps( _mm_mul_ps( dst, _mm_set1_ps( m_coeffs[0] ) ),
+					_mm_mul_ps( src, _mm_set1_ps( m_coeffs[1] ) ) );
+	}
+#endif
+
 	float m_coeffs[2];
 } ;
 
@@ -324,5 +592,43 @@ void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 	run<>( dst, srcLeft, srcRight, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
+
+
+void multiplyByVolumePanning( sampleFrame* dst,
+								const sample_t* volumeBuf, float volume,
+								const sample_t* panningBuf, float panning,
+								int frames )
+{
+	int f = 0;
+#ifdef __SSE__
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 percent = _mm_set1_ps( 0.01f );
+	const __m128 constVolume = _mm_set1_ps( volume * 0.01f );
+	const __m128 constPanning = _mm_set1_ps( panning * 0.01f );
+	for( ; f + 4 <= frames; f += 4 )
+	{
+		const __m128 v = volumeBuf ?
+			_mm_mul_ps( _mm_loadu_ps( volumeBuf + f ), percent ) : constVolume;
+		const __m128 p = panningBuf ?
+			_mm_mul_ps( _mm_loadu_ps( panningBuf + f ), percent ) : constPanning;
+		// left is attenuated when panning right and vice versa
+		const __m128 left = _mm_mul_ps( _mm_min_ps( one, _mm_sub_ps( one, p ) ), v );
+		const __m128 right = _mm_mul_ps( _mm_min_ps( one, _mm_add_ps( one, p ) ), v );
+
+		_mm_storeu_ps( dst[f].data(), _mm_mul_ps( _mm_loadu_ps( dst[f].data() ),
+						_mm_unpacklo_ps( left, right ) ) );
+		_mm_storeu_ps( dst[f + 2].data(), _mm_mul_ps( _mm_loadu_ps( dst[f + 2].data() ),
+						_mm_unpackhi_ps( left, right ) ) );
+	}
+#endif
+	for( ; f < frames; ++f )
+	{
+		const float v = ( volumeBuf ? volumeBuf[f] : volume ) * 0.01f;
+		const float p = ( panningBuf ? panningBuf[f] : panning ) * 0.01f;
+		dst[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
+		dst[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
+	}
+}
+
 }
 
@@ -24,6 +24,8 @@
 
 #include "Mixer.h"
 
+#include <QtCore/QTimer>
+
 #include "denormals.h"
 
 #include "lmmsconfig.h"
@@ -37,6 +39,9 @@
 #include "ConfigManager.h"
 #include "SamplePlayHandle.h"
 #include "MemoryHelper.h"
+#include "MixHelpers.h"
+#include "MidiEventQueue.h"
+#include "MidiPort.h"
 
 // platform-specific audio-interface-classes
 #include "AudioAlsa.h"
@@ -66,11 +71,17 @@ typedef LocklessList<PlayHandle *>::Element LocklessListElement;
 
 static thread_local bool s_renderingThread;
 
+Mixer::RunOptions Mixer::s_runOptions = { 0, -1, false };
+
 
 
 
 Mixer::Mixer( bool renderOnly ) :
 	m_renderOnly( renderOnly ),
+	m_audioPorts( new AudioPortList() ),
+	m_renderedAudioPorts( NULL ),
+	m_renderGraphVersion( 0 ),
+	m_periodStartTime( 0 ),
 	m_framesPerPeriod( DEFAULT_BUFFER_SIZE ),
 	m_inputBufferRead( 0 ),
 	m_inputBufferWrite( 1 ),
@@ -87,11 +98,16 @@ Mixer::Mixer( bool renderOnly ) :
 	m_audioDevStartFailed( false ),
 	m_profiler(),
 	m_metronomeActive(false),
+	m_metronomeBar( NULL ),
+	m_metronomeBeat( NULL ),
 	m_clearSignal( false ),
 	m_changesSignal( false ),
 	m_changes( 0 ),
+	m_renderGraphDirty( true ),
 	m_doChangesMutex( QMutex::Recursive ),
-	m_waitingForWrite( false )
+	m_waitingForWrite( false ),
+	m_periodsStarted( 0 ),
+	m_periodsFinished( 0 )
 {
 	for( int i = 0; i < 2; ++i )
 	{
@@ -103,6 +119,8 @@ Mixer::Mixer( bool renderOnly ) :
 
 	// determine FIFO size and number of frames per period
 	int fifoSize = 1;
+	const int fifoDepth = ConfigManager::inst()->
+					value( "mixer", "fifodepth" ).toInt();
 
 	// if not only rendering (that is, using the GUI), load the buffer
 	// size from user configuration
@@ -129,9 +147,19 @@ Mixer::Mixer( bool renderOnly ) :
 			m_framesPerPeriod = DEFAULT_BUFFER_SIZE;
 		}
 	}
+	// nobody is listening when rendering offline, so render much larger
+	// periods to cut the per-period overhead. Notes still start at the
+	// right frame, but parameters read with value() only change once per
+	// period, so main() doesn't enable it for projects with automation.
+	else if( s_runOptions.offline )
+	{
+		m_framesPerPeriod = OFFLINE_BUFFER_SIZE;
+	}
 
-	// allocte the FIFO from the determined size
-	m_fifo = new fifo( fifoSize );
+	// allocate the FIFO from the determined size, unless the depth is
+	// configured explicitly
+	m_fifo = new fifo( fifoDepth > 0 ? fifoDepth : fifoSize,
+							m_framesPerPeriod );
 
 	// now that framesPerPeriod is fixed initialize global BufferManager
 	BufferManager::init( m_framesPerPeriod );
@@ -146,6 +174,22 @@ Mixer::Mixer( bool renderOnly ) :
 		m_bufferPool.push_back( m_readBuf );
 	}
 
+	// number of threads and scheduler can be overridden e.g. for
+	// benchmarking the job scheduling
+	const int numThreads = s_runOptions.threads > 0 ?
+		s_runOptions.threads :
+		ConfigManager::inst()->value( "mixer", "threads" ).toInt();
+	if( numThreads > 0 )
+	{
+		m_numWorkers = numThreads - 1;
+	}
+	const bool workStealing = s_runOptions.workStealing >= 0 ?
+		s_runOptions.workStealing :
+		ConfigManager::inst()->value( "mixer", "workstealing" ).toInt();
+	MixerWorkerThread::setSchedulerMode( workStealing ?
+			MixerWorkerThread::WorkStealing :
+			MixerWorkerThread::GlobalQueue );
+
 	for( int i = 0; i < m_numWorkers+1; ++i )
 	{
 		MixerWorkerThread * wt = new MixerWorkerThread( this );
@@ -180,10 +224,6 @@ Mixer::~Mixer()
 		m_workers[w]->wait( 500 );
 	}
 
-	while( m_fifo->available() )
-	{
-		delete[] m_fifo->read();
-	}
 	delete m_fifo;
 
 	delete m_midiClient;
@@ -198,6 +238,18 @@ Mixer::~Mixer()
 	{
 		delete[] m_inputBuffer[i];
 	}
+
+	if( m_metronomeBar )
+	{
+		sharedObject::unref( m_metronomeBar );
+		sharedObject::unref( m_metronomeBeat );
+	}
+
+	// processing stopped, so everything can go, and whatever the deleters
+	// retire is deleted right away
+	reclaimRetired();
+
+	delete m_audioPorts.load();
 }
 
 
@@ -224,6 +276,7 @@ void Mixer::startProcessing( bool _needs_fifo )
 {
 	if( _needs_fifo )
 	{
+		m_fifo->reset();
 		m_fifoWriter = new fifoWriter( this, m_fifo );
 		m_fifoWriter->start( QThread::HighPriority );
 	}
@@ -344,6 +397,7 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	m_profiler.startPeriod();
 
 	s_renderingThread = true;
+	++m_periodsStarted;
 
 	static Song::PlayPos last_metro_pos = -1;
 
@@ -364,12 +418,12 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 		tick_t ticksPerBar = MidiTime::ticksPerBar();
 		if ( p.getTicks() % ( ticksPerBar / 1 ) == 0 )
 		{
-			addPlayHandle( new SamplePlayHandle( "misc/metronome02.ogg" ) );
+			addPlayHandle( new SamplePlayHandle( m_metronomeBar ) );
 		}
 		else if ( p.getTicks() % ( ticksPerBar /
 			song->getTimeSigModel().getNumerator() ) == 0 )
 		{
-			addPlayHandle( new SamplePlayHandle( "misc/metronome01.ogg" ) );
+			addPlayHandle( new SamplePlayHandle( m_metronomeBeat ) );
 		}
 		last_metro_pos = p;
 	}
@@ -423,6 +477,9 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	FxMixer * fxMixer = Engine::fxMixer();
 	fxMixer->prepareMasterMix();
 
+	// notes played live
+	processMidiInput();
+
 	// create play-handles for new notes, samples etc.
 	song->processNextBuffer();
 
@@ -435,9 +492,60 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 		e = next;
 	}
 
-	// STAGE 1: run and render all play handles
-	MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
-	MixerWorkerThread::startAndWaitForJobs();
+	// the ports rendered in this period, published before loading them
+	// again, so removeAudioPort() either sees them or they are current
+	AudioPortList * audioPorts;
+	do
+	{
+		audioPorts = m_audioPorts.load();
+		m_renderedAudioPorts = audioPorts;
+	}
+	while( audioPorts != m_audioPorts.load() );
+
+	if( m_renderGraphDirty.exchange( false ) ||
+			audioPorts->version != m_renderGraphVersion )
+	{
+		m_renderGraphVersion = audioPorts->version;
+		buildRenderGraph( audioPorts->ports );
+	}
+
+	// Render all play handles, the effects of all instrument- and
+	// sampletracks and the FX mixer as one dependency graph: an audio port
+	// starts as soon as all its play handles are done and an FX channel as
+	// soon as all its senders and audio ports are done.
+	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+	fxMixer->startMasterMix();
+
+	for( AudioPort * port : audioPorts->ports )
+	{
+		port->m_dependencies = 0;
+		port->m_dependenciesMet = 0;
+	}
+	for( PlayHandle * ph : m_playHandles )
+	{
+		++ph->audioPort()->m_dependencies;
+	}
+	for( AudioPort * port : audioPorts->ports )
+	{
+		if( port->m_dependencies == 0 )
+		{
+			MixerWorkerThread::addJob( port );
+		}
+	}
+	for( PlayHandle * ph : m_playHandles )
+	{
+		if( !MixerWorkerThread::addJob( ph ) )
+		{
+			// finished play handles do not get processed anymore
+			ph->audioPort()->incrementDeps();
+		}
+	}
+
+	fxMixer->masterMix( m_writeBuf );
+
+	// all ports are done, before running changes in the model, as the
+	// thread doing them might wait in removeAudioPort()
+	m_renderedAudioPorts = NULL;
 
 	// removed all play handles which are done
 	for( PlayHandleList::Iterator it = m_playHandles.begin();
@@ -465,15 +573,6 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 		}
 	}
 
-	// STAGE 2: process effects of all instrument- and sampletracks
-	MixerWorkerThread::fillJobQueue<QVector<AudioPort *> >( m_audioPorts );
-	MixerWorkerThread::startAndWaitForJobs();
-
-
-	// STAGE 3: do master mix in FX mixer
-	fxMixer->masterMix( m_writeBuf );
-
-
 	emit nextAudioBuffer( m_readBuf );
 
 	runChangesInModel();
@@ -484,6 +583,7 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	AutomatableModel::incrementPeriodCounter();
 
 	s_renderingThread = false;
+	++m_periodsFinished;
 
 	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod );
 
@@ -536,23 +636,9 @@ void Mixer::clearInternal()
 
 Mixer::StereoSample Mixer::getPeakValues(sampleFrame * _ab, const f_cnt_t _frames) const
 {
-	sample_t peakLeft = 0.0f;
-	sample_t peakRight = 0.0f;
-
-	for( f_cnt_t f = 0; f < _frames; ++f )
-	{
-		float const absLeft = qAbs( _ab[f][0] );
-		float const absRight = qAbs( _ab[f][1] );
-		if (absLeft > peakLeft)
-		{
-			peakLeft = absLeft;
-		}
-
-		if (absRight > peakRight)
-		{
-			peakRight = absRight;
-		}
-	}
+	sample_t peakLeft;
+	sample_t peakRight;
+	MixHelpers::getPeakValues( _ab, _frames, peakLeft, peakRight );
 
 	return StereoSample(peakLeft, peakRight);
 }
@@ -664,20 +750,120 @@ void Mixer::restoreAudioDevice()
 
 
 
+void Mixer::addAudioPort( AudioPort * _port )
+{
+	// a period in progress doesn't see the new port, so the mixer
+	// doesn't have to stop for it
+	m_audioPortsMutex.lock();
+	AudioPortList * ports = new AudioPortList( *m_audioPorts.load() );
+	ports->ports.push_back( _port );
+	AudioPortList * old = publishAudioPorts( ports );
+	m_audioPortsMutex.unlock();
+
+	retire( old );
+}
+
+
+
+
 void Mixer::removeAudioPort( AudioPort * _port )
 {
-	requestChangeInModel();
-	QVector<AudioPort *>::Iterator it = std::find( m_audioPorts.begin(),
-							m_audioPorts.end(),
-							_port );
-	if( it != m_audioPorts.end() )
+	m_audioPortsMutex.lock();
+	const int index = m_audioPorts.load()->ports.indexOf( _port );
+	if( index < 0 )
 	{
-		m_audioPorts.erase( it );
+		m_audioPortsMutex.unlock();
+		return;
 	}
+	AudioPortList * ports = new AudioPortList( *m_audioPorts.load() );
+	ports->ports.remove( index );
+	AudioPortList * old = publishAudioPorts( ports );
+	m_audioPortsMutex.unlock();
+
+	// the port is deleted afterwards, so wait for a period still rendering
+	// it. That's over before the period runs changes in the model, so
+	// callers may hold requestChangeInModel().
+	while( m_renderedAudioPorts.load() == old )
+	{
+		QThread::yieldCurrentThread();
+	}
+
+	retire( old );
+}
+
+
+
+
+QVector<AudioPort *> Mixer::audioPorts() const
+{
+	QMutexLocker lock( &m_audioPortsMutex );
+	return m_audioPorts.load()->ports;
+}
+
+
+
+
+Mixer::AudioPortList * Mixer::publishAudioPorts( AudioPortList * ports )
+{
+	ports->version = m_audioPorts.load()->version + 1;
+	return m_audioPorts.exchange( ports );
+}
+
+
+void Mixer::addMidiInputPort( MidiPort * port )
+{
+	requestChangeInModel();
+	m_midiInputPorts.push_back( port );
 	doneChangeInModel();
 }
 
 
+
+
+void Mixer::removeMidiInputPort( MidiPort * port )
+{
+	requestChangeInModel();
+	m_midiInputPorts.removeOne( port );
+	doneChangeInModel();
+}
+
+
+
+
+f_cnt_t Mixer::midiInputOffset( qint64 arrival )
+{
+	// an event is played one period after it arrived, instead of at the
+	// start of the next period, so that all events get the same latency
+	const qint64 periodLength = m_framesPerPeriod * 1000000000LL /
+						processingSampleRate();
+	const qint64 sincePeriod = arrival - ( m_periodStartTime - periodLength );
+	// events which are late, e.g. because the FIFO writer ran ahead, are
+	// played right away
+	const f_cnt_t offset = static_cast<f_cnt_t>( qBound<qint64>( 0,
+			sincePeriod * m_framesPerPeriod / periodLength,
+			m_framesPerPeriod - 1 ) );
+
+	m_profiler.addMidiLatency( m_periodStartTime +
+			offset * periodLength / m_framesPerPeriod - arrival );
+
+	return offset;
+}
+
+
+
+
+void Mixer::processMidiInput()
+{
+	m_periodStartTime = MidiEventQueue::now();
+	for( MidiPort * port : m_midiInputPorts )
+	{
+		m_profiler.addDroppedMidiEvents( port->processQueuedInEvents() );
+	}
+}
+
+
+
+
 bool Mixer::addPlayHandle( PlayHandle* handle )
 {
 	if( criticalXRuns() == false )
@@ -839,6 +1025,127 @@ void Mixer::runChangesInModel()
 	}
 }
 
+
+
+
+void Mixer::retire( void * object, void ( * deleter )( void * ) )
+{
+	// the period number has to be read after the object got unpublished
+	const quint64 started = m_periodsStarted;
+	if( m_periodsFinished == started )
+	{
+		// no period can have seen it
+		deleter( object );
+		return;
+	}
+	const RetiredObject retired = { object, deleter, started };
+
+	m_retiredMutex.lock();
+	const bool scheduled = !m_retired.isEmpty();
+	m_retired.push_back( retired );
+	m_retiredMutex.unlock();
+
+	if( !scheduled )
+	{
+		QMetaObject::invokeMethod( this, "reclaimRetired",
+							Qt::QueuedConnection );
+	}
+}
+
+
+
+
+void Mixer::reclaimRetired()
+{
+	const quint64 finished = m_periodsFinished;
+
+	QVector<RetiredObject> reclaimable;
+	m_retiredMutex.lock();
+	for( auto it = m_retired.begin(); it != m_retired.end(); )
+	{
+		if( it->period <= finished )
+		{
+			reclaimable.push_back( *it );
+			it = m_retired.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+	const bool pending = !m_retired.isEmpty();
+	m_retiredMutex.unlock();
+
+	// deleters may retire further objects, so don't hold the lock
+	for( const RetiredObject & retired : reclaimable )
+	{
+		retired.deleter( retired.object );
+	}
+
+	if( pending )
+	{
+		// try again after the current period
+		QTimer::singleShot( 10, this, SLOT( reclaimRetired() ) );
+	}
+}
+
+
+
+
+void Mixer::buildRenderGraph( const QVector<AudioPort *> & ports )
+{
+	FxMixer * fxMixer = Engine::fxMixer();
+
+	for( fx_ch_t i = 0; i < fxMixer->numChannels(); ++i )
+	{
+		FxChannel * ch = fxMixer->effectChannel( i );
+		ch->m_dependencies = ch->m_receives.size();
+	}
+
+	// every node of the graph has to fit into the job queue at once, the
+	// queue processes overflowing jobs in place, which serializes them
+	Q_ASSERT( ports.size() + fxMixer->numChannels() +
+				m_playHandles.size() <= JOB_QUEUE_SIZE );
+
+	for( AudioPort * port : ports )
+	{
+		const fx_ch_t ch = port->nextFxChannel();
+		if( ch >= 0 && ch < fxMixer->numChannels() )
+		{
+			port->m_graphFxChannel = fxMixer->effectChannel( ch );
+			++port->m_graphFxChannel->m_dependencies;
+		}
+		else
+		{
+			port->m_graphFxChannel = NULL;
+		}
+	}
+}
+
+
+
+
+void Mixer::setMetronomeActive( bool value )
+{
+	if( value && m_metronomeBar == NULL )
+	{
+		m_metronomeBar = new SampleBuffer( "misc/metronome02.ogg" );
+		m_metronomeBeat = new SampleBuffer( "misc/metronome01.ogg" );
+	}
+	m_metronomeActive = value;
+}
+
+
+
+
+void Mixer::setRunOptions( const RunOptions & options )
+{
+	s_runOptions = options;
+}
+
+
+
+
 bool Mixer::isAudioDevNameValid(QString name)
 {
 #ifdef LMMS_HAVE_SDL
@@ -1267,13 +1574,9 @@ void Mixer::fifoWriter::run()
 #endif
 #endif
 
-	const fpp_t frames = m_mixer->framesPerPeriod();
 	while( m_writing )
 	{
-		surroundSampleFrame * buffer = new surroundSampleFrame[frames];
-		const surroundSampleFrame * b = m_mixer->renderNextBuffer();
-		memcpy( buffer, b, frames * sizeof( surroundSampleFrame ) );
-		write( buffer );
+		write( m_mixer->renderNextBuffer() );
 	}
 
 	// Let audio backend stop processing
@@ -1284,7 +1587,7 @@ void Mixer::fifoWriter::run()
 
 
 
-void Mixer::fifoWriter::write( surroundSampleFrame * buffer )
+void Mixer::fifoWriter::write( const surroundSampleFrame * buffer )
 {
 	m_mixer->m_waitChangesMutex.lock();
 	m_mixer->m_waitingForWrite = true;
@@ -24,11 +24,19 @@
 
 #include "MixerProfiler.h"
 
+#include <cstdio>
+
 
 MixerProfiler::MixerProfiler() :
 	m_periodTimer(),
 	m_cpuLoad( 0 ),
-	m_outputFile()
+	m_outputFile(),
+	m_midiLatencyFile(),
+	m_midiEvents( 0 ),
+	m_minMidiLatency( 0 ),
+	m_maxMidiLatency( 0 ),
+	m_totalMidiLatency( 0 ),
+	m_droppedMidiEvents( 0 )
 {
 }
 
@@ -36,6 +44,7 @@ MixerProfiler::MixerProfiler() :
 
 MixerProfiler::~MixerProfiler()
 {
+	printMidiLatency();
 }
 
 
@@ -61,3 +70,53 @@ void MixerProfiler::setOutputFile( const QString& outputFile )
 	m_outputFile.open( QFile::WriteOnly | QFile::Truncate );
 }
 
+
+
+void MixerProfiler::addMidiLatency( qint64 latency )
+{
+	if( !m_midiLatencyFile.isOpen() )
+	{
+		return;
+	}
+
+	m_minMidiLatency = m_midiEvents ? qMin( m_minMidiLatency, latency ) : latency;
+	m_maxMidiLatency = m_midiEvents ? qMax( m_maxMidiLatency, latency ) : latency;
+	m_totalMidiLatency += latency;
+	++m_midiEvents;
+
+	m_midiLatencyFile.write( QString( "%1\n" ).arg( latency / 1000 ).toLatin1() );
+}
+
+
+
+void MixerProfiler::setMidiLatencyFile( const QString& outputFile )
+{
+	printMidiLatency();
+	m_midiLatencyFile.close();
+	m_midiLatencyFile.setFileName( outputFile );
+	m_midiLatencyFile.open( QFile::WriteOnly | QFile::Truncate );
+}
+
+
+
+void MixerProfiler::printMidiLatency()
+{
+	if( m_midiEvents > 0 )
+	{
+		// the jitter is what a constant latency can't hide
+		fprintf( stderr, "MIDI input: %d events, latency %.2f ms to %.2f ms "
+				"(mean %.2f ms), jitter %.2f ms\n", m_midiEvents,
+				m_minMidiLatency / 1e6, m_maxMidiLatency / 1e6,
+				m_totalMidiLatency / 1e6 / m_midiEvents,
+				( m_maxMidiLatency - m_minMidiLatency ) / 1e6 );
+	}
+	if( m_droppedMidiEvents > 0 )
+	{
+		fprintf( stderr, "MIDI input: %d events dropped, the queue was "
+					"full\n", m_droppedMidiEvents );
+	}
+	m_midiEvents = 0;
+	m_totalMidiLatency = 0;
+	m_droppedMidiEvents = 0;
+}
+
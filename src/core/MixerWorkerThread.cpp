@@ -24,7 +24,6 @@
 
 #include "MixerWorkerThread.h"
 
-#include <QDebug>
 #include <QMutex>
 #include <QWaitCondition>
 
@@ -37,9 +36,25 @@
 #endif
 
 MixerWorkerThread::JobQueue MixerWorkerThread::globalJobQueue;
+MixerWorkerThread::WorkStealingQueue MixerWorkerThread::stealingJobQueue;
+MixerWorkerThread::SchedulerMode MixerWorkerThread::s_schedulerMode =
+						MixerWorkerThread::GlobalQueue;
 QWaitCondition * MixerWorkerThread::queueReadyWaitCond = NULL;
 QList<MixerWorkerThread *> MixerWorkerThread::workerThreads;
 
+// index of the deque owned by the current thread while it is processing
+// jobs, -1 if the thread is not processing the work-stealing queue
+static thread_local int s_currentDeque = -1;
+
+
+static inline void cpuRelax()
+{
+#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
+	_mm_pause();
+#endif
+}
+
+
 // implementation of internal JobQueue
 void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
 {
@@ -51,7 +66,7 @@ void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
 
 
 
-void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
+bool MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 {
 	if( _job->requiresProcessing() )
 	{
@@ -62,10 +77,15 @@ void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 		if (index < JOB_QUEUE_SIZE) {
 			m_items[index] = _job;
 		} else {
-			qWarning() << "Job queue is full!";
+			// the render graph relies on every queued job getting
+			// processed to notify its dependents, so run it right here
+			// instead of dropping it
+			_job->process();
 			++m_itemsDone;
 		}
+		return true;
 	}
+	return false;
 }
 
 
@@ -98,9 +118,205 @@ void MixerWorkerThread::JobQueue::wait()
 {
 	while (m_itemsDone < m_writeIndex)
 	{
-#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
-		_mm_pause();
-#endif
+		cpuRelax();
+	}
+}
+
+
+
+
+// implementation of internal WorkStealingQueue
+MixerWorkerThread::WorkStealingQueue::Deque::Deque() :
+	m_head( 0 ),
+	m_tail( 0 )
+{
+	m_lock.clear();
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::Deque::lock()
+{
+	while( m_lock.test_and_set( std::memory_order_acquire ) )
+	{
+		cpuRelax();
+	}
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::Deque::clear()
+{
+	lock();
+	m_head = 0;
+	m_tail = 0;
+	unlock();
+}
+
+
+
+
+bool MixerWorkerThread::WorkStealingQueue::Deque::push( ThreadableJob * _job )
+{
+	lock();
+	const bool pushed = m_tail < JOB_QUEUE_SIZE;
+	if( pushed )
+	{
+		m_items[m_tail++] = _job;
+	}
+	unlock();
+	return pushed;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::WorkStealingQueue::Deque::pop()
+{
+	ThreadableJob * job = NULL;
+	lock();
+	if( m_tail > m_head )
+	{
+		job = m_items[--m_tail];
+	}
+	unlock();
+	return job;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::WorkStealingQueue::Deque::steal()
+{
+	ThreadableJob * job = NULL;
+	lock();
+	if( m_tail > m_head )
+	{
+		job = m_items[m_head++];
+	}
+	unlock();
+	return job;
+}
+
+
+
+
+MixerWorkerThread::WorkStealingQueue::~WorkStealingQueue()
+{
+	for( Deque * d : m_deques )
+	{
+		delete d;
+	}
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::addDeque()
+{
+	m_deques.push_back( new Deque );
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::reset(
+						JobQueue::OperationMode _opMode )
+{
+	for( Deque * d : m_deques )
+	{
+		d->clear();
+	}
+	m_itemsQueued = 0;
+	m_itemsDone = 0;
+	m_nextDeque = 0;
+	m_opMode = _opMode;
+}
+
+
+
+
+bool MixerWorkerThread::WorkStealingQueue::addJob( ThreadableJob * _job )
+{
+	if( !_job->requiresProcessing() )
+	{
+		return false;
+	}
+
+	_job->queue();
+	++m_itemsQueued;
+
+	const int numDeques = m_deques.size();
+	// jobs spawned by a running job (dynamic mode) stay with the worker
+	// that spawned them, everything else is spread across all workers
+	int d = s_currentDeque >= 0 ? s_currentDeque :
+						m_nextDeque++ % numDeques;
+	for( int i = 0; i < numDeques; ++i )
+	{
+		if( m_deques[( d + i ) % numDeques]->push( _job ) )
+		{
+			return true;
+		}
+	}
+
+	// all deques are full - process the job right here, as dropping it
+	// would leave its dependents in the render graph waiting forever
+	_job->process();
+	++m_itemsDone;
+	return true;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::WorkStealingQueue::nextJob( int _worker )
+{
+	ThreadableJob * job = m_deques[_worker]->pop();
+	const int numDeques = m_deques.size();
+	for( int i = 1; job == NULL && i < numDeques; ++i )
+	{
+		job = m_deques[( _worker + i ) % numDeques]->steal();
+	}
+	return job;
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::run( int _worker )
+{
+	s_currentDeque = _worker;
+	while( m_itemsDone < m_itemsQueued )
+	{
+		ThreadableJob * job = nextJob( _worker );
+		if( job )
+		{
+			job->process();
+			++m_itemsDone;
+		}
+		else if( m_opMode == JobQueue::Dynamic )
+		{
+			// running jobs may still spawn new ones
+			cpuRelax();
+		}
+		else
+		{
+			break;
+		}
+	}
+	s_currentDeque = -1;
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::wait()
+{
+	while( m_itemsDone < m_itemsQueued )
+	{
+		cpuRelax();
 	}
 }
 
@@ -112,6 +328,7 @@ void MixerWorkerThread::JobQueue::wait()
 
 MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
 	QThread( mixer ),
+	m_index( workerThreads.size() ),
 	m_quit( false )
 {
 	// initialize global static data
@@ -124,6 +341,7 @@ MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
 	// processing the last worker thread "inline", see comments in
 	// MixerWorkerThread::startAndWaitForJobs() for details
 	workerThreads << this;
+	stealingJobQueue.addDeque();
 
 	resetJobQueue();
 }
@@ -154,8 +372,16 @@ void MixerWorkerThread::startAndWaitForJobs()
 	// The last worker-thread is never started. Instead it's processed "inline"
 	// i.e. within the global Mixer thread. This way we can reduce latencies
 	// that otherwise would be caused by synchronizing with another thread.
-	globalJobQueue.run();
-	globalJobQueue.wait();
+	if( s_schedulerMode == WorkStealing )
+	{
+		stealingJobQueue.run( workerThreads.size() - 1 );
+		stealingJobQueue.wait();
+	}
+	else
+	{
+		globalJobQueue.run();
+		globalJobQueue.wait();
+	}
 }
 
 
@@ -171,7 +397,14 @@ void MixerWorkerThread::run()
 	{
 		m.lock();
 		queueReadyWaitCond->wait( &m );
-		globalJobQueue.run();
+		if( s_schedulerMode == WorkStealing )
+		{
+			stealingJobQueue.run( m_index );
+		}
+		else
+		{
+			globalJobQueue.run();
+		}
 		m.unlock();
 	}
 }
@@ -347,6 +347,15 @@ bool NotePlayHandle::isFromTrack( const Track * _track ) const
 
 
 
+f_cnt_t NotePlayHandle::latency() const
+{
+	return m_instrumentTrack->instrument() != NULL ?
+			m_instrumentTrack->instrument()->latency() : 0;
+}
+
+
+
+
 void NotePlayHandle::noteOff( const f_cnt_t _s )
 {
 	if( m_released )
@@ -558,25 +567,16 @@ void NotePlayHandle::resize( const bpm_t _new_tempo )
 }
 
 
-NotePlayHandle ** NotePlayHandleManager::s_available;
-QReadWriteLock NotePlayHandleManager::s_mutex;
-std::atomic_int NotePlayHandleManager::s_availableIndex;
-int NotePlayHandleManager::s_size;
+LocklessAllocatorT<NotePlayHandle> * NotePlayHandleManager::s_pool = NULL;
+std::atomic_int NotePlayHandleManager::s_inUse( 0 );
+std::atomic_int NotePlayHandleManager::s_highWaterMark( 0 );
+std::atomic_int NotePlayHandleManager::s_poolHits( 0 );
+std::atomic_int NotePlayHandleManager::s_poolMisses( 0 );
 
 
 void NotePlayHandleManager::init()
 {
-	s_available = MM_ALLOC( NotePlayHandle*, INITIAL_NPH_CACHE );
-
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, INITIAL_NPH_CACHE );
-
-	for( int i=0; i < INITIAL_NPH_CACHE; ++i )
-	{
-		s_available[ i ] = n;
-		++n;
-	}
-	s_availableIndex = INITIAL_NPH_CACHE - 1;
-	s_size = INITIAL_NPH_CACHE;
+	s_pool = new LocklessAllocatorT<NotePlayHandle>( NPH_CACHE_SIZE );
 }
 
 
@@ -588,11 +588,24 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 				int midiEventChannel,
 				NotePlayHandle::Origin origin )
 {
-	// TODO: use some lockless data structures
-	s_mutex.lockForWrite();
-	if (s_availableIndex < 0) { extend(NPH_CACHE_INCREMENT); }
-	NotePlayHandle * nph = s_available[s_availableIndex--];
-	s_mutex.unlock();
+	const int inUse = ++s_inUse;
+	int highWaterMark = s_highWaterMark;
+	while( inUse > highWaterMark &&
+		!s_highWaterMark.compare_exchange_weak( highWaterMark, inUse ) )
+	{
+	}
+
+	NotePlayHandle * nph = inUse <= NPH_CACHE_SIZE ? s_pool->alloc() : NULL;
+	if( nph )
+	{
+		++s_poolHits;
+	}
+	else
+	{
+		// pool exhausted, don't fail but fall back to the heap
+		++s_poolMisses;
+		nph = MM_ALLOC( NotePlayHandle, 1 );
+	}
 
 	new( (void*)nph ) NotePlayHandle( instrumentTrack, offset, frames, noteToPlay, parent, midiEventChannel, origin );
 	return nph;
@@ -602,29 +615,20 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 void NotePlayHandleManager::release( NotePlayHandle * nph )
 {
 	nph->NotePlayHandle::~NotePlayHandle();
-	s_mutex.lockForRead();
-	s_available[++s_availableIndex] = nph;
-	s_mutex.unlock();
-}
-
-
-void NotePlayHandleManager::extend( int c )
-{
-	s_size += c;
-	NotePlayHandle ** tmp = MM_ALLOC( NotePlayHandle*, s_size );
-	MM_FREE( s_available );
-	s_available = tmp;
-
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, c );
-
-	for( int i=0; i < c; ++i )
+	if( s_pool->contains( nph ) )
 	{
-		s_available[++s_availableIndex] = n;
-		++n;
+		s_pool->free( nph );
 	}
+	else
+	{
+		MM_FREE( nph );
+	}
+	--s_inUse;
 }
 
+
 void NotePlayHandleManager::free()
 {
-	MM_FREE(s_available);
+	delete s_pool;
+	s_pool = NULL;
 }
@@ -35,6 +35,26 @@
 #	include <sys/times.h>
 #endif
 
+#ifdef LMMS_HAVE_SYS_RESOURCE_H
+#	include <sys/resource.h>
+#endif
+
+// peak resident set size in KiB, -1 if unknown
+static long peakMemoryKiB()
+{
+#ifdef LMMS_HAVE_SYS_RESOURCE_H
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#	ifdef LMMS_BUILD_APPLE
+		return usage.ru_maxrss / 1024;
+#	else
+		return usage.ru_maxrss;
+#	endif
+	}
+#endif
+	return -1;
+}
+
 PerfTime::PerfTime()
 	: m_real(-1)
 {
@@ -95,8 +115,14 @@ PerfTime operator-(const PerfTime& lhs, const PerfTime& rhs)
 	return diff;
 }
 
-PerfLogTimer::PerfLogTimer(const QString& what)
+void perfLog(const QString& name, const QString& message)
+{
+	qWarning("PERFLOG | %20s | %s", qPrintable(name), qPrintable(message));
+}
+
+PerfLogTimer::PerfLogTimer(const QString& what, bool reportMemory)
 	: name(what)
+	, report_memory(reportMemory)
 {
 	begin();
 }
@@ -125,6 +151,10 @@ void PerfLogTimer::end()
 			 d.user() / (double)clktck,
 			 d.system() / (double)clktck,
 			 d.real() / (double)clktck);
+	if (report_memory) {
+		qWarning("PERFLOG | %20s | %ldKiB peak memory",
+				 qPrintable(name), peakMemoryKiB());
+	}
 
 	// Invalidate so destructor won't call print another log entry
 	begin_time = PerfTime();
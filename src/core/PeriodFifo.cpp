@@ -0,0 +1,178 @@
+/*
+ * PeriodFifo.cpp - preallocated single producer/single consumer queue of
+ *                  audio periods
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "PeriodFifo.h"
+
+#include <cstring>
+
+
+PeriodFifo::PeriodFifo( int depth, fpp_t frames ) :
+	m_depth( qMax( depth, 1 ) ),
+	// one more for the period the reader holds
+	m_slots( m_depth + 1 ),
+	m_frames( frames ),
+	m_buffers( new surroundSampleFrame[m_slots * frames] ),
+	m_written( 0 ),
+	m_readPos( 0 ),
+	m_released( 0 ),
+	m_writeSlot( 0 ),
+	m_readSlot( 0 ),
+	m_holding( false ),
+	m_ended( false ),
+	m_endRead( false ),
+	m_underruns( 0 ),
+	m_sleepers( 0 )
+{
+}
+
+
+
+
+PeriodFifo::~PeriodFifo()
+{
+	delete[] m_buffers;
+}
+
+
+
+
+template<class Condition>
+void PeriodFifo::waitFor( Condition ready )
+{
+	if( ready() )
+	{
+		return;
+	}
+
+	// announce the sleeper before checking again, so that notify() either
+	// sees it or its change is seen here
+	QMutexLocker lock( &m_mutex );
+	m_sleepers.fetch_add( 1 );
+	while( !ready() )
+	{
+		m_wakeUp.wait( &m_mutex );
+	}
+	m_sleepers.fetch_sub( 1 );
+}
+
+
+
+
+void PeriodFifo::notify()
+{
+	if( m_sleepers.load() > 0 )
+	{
+		QMutexLocker lock( &m_mutex );
+		m_wakeUp.wakeAll();
+	}
+}
+
+
+
+
+void PeriodFifo::write( const surroundSampleFrame * buffer )
+{
+	if( buffer == NULL )
+	{
+		m_ended = true;
+		notify();
+		return;
+	}
+
+	const unsigned int written = m_written.load( std::memory_order_relaxed );
+	waitFor( [this, written]() {
+		return written - m_released.load() < static_cast<unsigned int>( m_slots ); } );
+
+	memcpy( m_buffers + m_writeSlot * m_frames, buffer,
+					m_frames * sizeof( surroundSampleFrame ) );
+	m_writeSlot = ( m_writeSlot + 1 ) % m_slots;
+
+	m_written.store( written + 1 );
+	notify();
+}
+
+
+
+
+const surroundSampleFrame * PeriodFifo::read()
+{
+	// give back the previous period
+	const unsigned int readPos = m_readPos.load( std::memory_order_relaxed );
+	if( m_holding )
+	{
+		m_holding = false;
+		m_released.store( readPos );
+		notify();
+	}
+
+	auto ready = [this, readPos]() {
+		return m_written.load() != readPos || m_ended.load(); };
+	if( !ready() )
+	{
+		// waiting for the first period isn't an underrun
+		if( readPos > 0 )
+		{
+			m_underruns.fetch_add( 1, std::memory_order_relaxed );
+		}
+		waitFor( ready );
+	}
+
+	// the writer ends the stream after its last period
+	if( m_written.load() == readPos )
+	{
+		m_endRead = true;
+		notify();
+		return NULL;
+	}
+
+	const surroundSampleFrame * buffer = m_buffers + m_readSlot * m_frames;
+	m_readSlot = ( m_readSlot + 1 ) % m_slots;
+	m_holding = true;
+	m_readPos.store( readPos + 1 );
+
+	return buffer;
+}
+
+
+
+
+void PeriodFifo::waitUntilRead()
+{
+	waitFor( [this]() { return m_endRead.load(); } );
+}
+
+
+
+
+void PeriodFifo::reset()
+{
+	m_written = 0;
+	m_readPos = 0;
+	m_released = 0;
+	m_writeSlot = 0;
+	m_readSlot = 0;
+	m_holding = false;
+	m_ended = false;
+	m_endRead = false;
+	m_underruns = 0;
+}
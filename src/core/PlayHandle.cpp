@@ -23,6 +23,7 @@
  */
  
 #include "PlayHandle.h"
+#include "AudioPort.h"
 #include "BufferManager.h"
 #include "Engine.h"
 #include "Mixer.h"
@@ -61,6 +62,9 @@ void PlayHandle::doProcessing()
 	{
 		play( NULL );
 	}
+
+	// the audio port may start mixing once all its play handles are done
+	m_audioPort->incrementDeps();
 }
 
 
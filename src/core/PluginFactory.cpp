@@ -31,6 +31,7 @@
 #include "lmmsconfig.h"
 
 #include "ConfigManager.h"
+#include "PerfLog.h"
 #include "Plugin.h"
 #include "embed.h"
 
@@ -50,6 +51,8 @@ std::unique_ptr<PluginFactory> PluginFactory::s_instance;
 PluginFactory::PluginFactory()
 {
 	setupSearchPaths();
+
+	PerfLogTimer perfLog("Plugin discovery");
 	discoverPlugins();
 }
 
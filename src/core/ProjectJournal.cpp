@@ -25,6 +25,8 @@
 #include <cstdlib>
 
 #include "ProjectJournal.h"
+#include "ConfigManager.h"
+#include "DataFile.h"
 #include "Engine.h"
 #include "JournallingObject.h"
 #include "Song.h"
@@ -33,14 +35,18 @@
 //! and newly created IDs (have the bit set)
 static const int EO_ID_MSB = 1 << 23;
 
-const int ProjectJournal::MAX_UNDO_STATES = 100; // TODO: make this configurable in settings
+const int ProjectJournal::DEFAULT_MEMORY_BUDGET = 64;
 
 ProjectJournal::ProjectJournal() :
 	m_joIDs(),
 	m_undoCheckPoints(),
 	m_redoCheckPoints(),
+	m_memoryUsage( 0 ),
 	m_journalling( false )
 {
+	const int budget = ConfigManager::inst()->value( "app", "undomemory",
+			QString::number( DEFAULT_MEMORY_BUDGET ) ).toInt();
+	m_memoryBudget = static_cast<size_t>( qMax( budget, 1 ) ) << 20;
 }
 
 
@@ -57,18 +63,17 @@ void ProjectJournal::undo()
 {
 	while( !m_undoCheckPoints.isEmpty() )
 	{
-		CheckPoint c = m_undoCheckPoints.pop();
-		JournallingObject *jo = m_joIDs[c.joID];
+		jo_id_t id;
+		const JournalState state = popCheckPoint( m_undoCheckPoints, id );
+		JournallingObject *jo = m_joIDs[id];
 
 		if( jo )
 		{
-			DataFile curState( DataFile::JournalData );
-			jo->saveState( curState, curState.content() );
-			m_redoCheckPoints.push( CheckPoint( c.joID, curState ) );
+			pushCheckPoint( m_redoCheckPoints, id, saveState( jo ) );
 
 			bool prev = isJournalling();
 			setJournalling( false );
-			jo->restoreState( c.data.content().firstChildElement() );
+			restoreState( jo, state );
 			setJournalling( prev );
 			Engine::getSong()->setModified();
 			break;
@@ -82,18 +87,18 @@ void ProjectJournal::redo()
 {
 	while( !m_redoCheckPoints.isEmpty() )
 	{
-		CheckPoint c = m_redoCheckPoints.pop();
-		JournallingObject *jo = m_joIDs[c.joID];
+		jo_id_t id;
+		const JournalState state = popCheckPoint( m_redoCheckPoints, id );
+		JournallingObject *jo = m_joIDs[id];
 
 		if( jo )
 		{
-			DataFile curState( DataFile::JournalData );
-			jo->saveState( curState, curState.content() );
-			m_undoCheckPoints.push( CheckPoint( c.joID, curState ) );
+			pushCheckPoint( m_undoCheckPoints, id, saveState( jo ) );
+			trimCheckPoints();
 
 			bool prev = isJournalling();
 			setJournalling( false );
-			jo->restoreState( c.data.content().firstChildElement() );
+			restoreState( jo, state );
 			setJournalling( prev );
 			Engine::getSong()->setModified();
 			break;
@@ -117,17 +122,118 @@ void ProjectJournal::addJournalCheckPoint( JournallingObject *jo )
 {
 	if( isJournalling() )
 	{
-		m_redoCheckPoints.clear();
+		clearCheckPoints( m_redoCheckPoints );
+
+		pushCheckPoint( m_undoCheckPoints, jo->id(), saveState( jo ) );
+		trimCheckPoints();
+	}
+}
+
+
+
+
+JournalState ProjectJournal::saveState( JournallingObject * jo )
+{
+	DataFile dataFile( DataFile::JournalData );
+	jo->saveState( dataFile, dataFile.content() );
+	return JournalState( dataFile.content().firstChildElement() );
+}
+
+
+
+
+void ProjectJournal::restoreState( JournallingObject * jo,
+						const JournalState & state )
+{
+	DataFile dataFile( DataFile::JournalData );
+	jo->restoreState( state.toElement( dataFile, dataFile.content() ) );
+}
+
+
+
+
+void ProjectJournal::pushCheckPoint( CheckPointStack & stack, jo_id_t id,
+						const JournalState & state )
+{
+	// only keep what changed in the object's previous state
+	for( int i = stack.size() - 1; i >= 0; --i )
+	{
+		CheckPoint & prev = stack[i];
+		if( prev.joID == id )
+		{
+			prev.delta = JournalState::diff( state, prev.state );
+			prev.state = JournalState();
+
+			m_memoryUsage -= prev.size;
+			prev.size = sizeof( CheckPoint ) + prev.delta.memoryUsage();
+			m_memoryUsage += prev.size;
+			break;
+		}
+	}
+
+	const CheckPoint c = { id, state, JournalState::Delta(),
+				sizeof( CheckPoint ) + state.memoryUsage() };
+	stack.push_back( c );
+	m_memoryUsage += c.size;
+}
+
+
 
-		DataFile dataFile( DataFile::JournalData );
-		jo->saveState( dataFile, dataFile.content() );
 
-		m_undoCheckPoints.push( CheckPoint( jo->id(), dataFile ) );
-		if( m_undoCheckPoints.size() > MAX_UNDO_STATES )
+JournalState ProjectJournal::popCheckPoint( CheckPointStack & stack, jo_id_t & id )
+{
+	const CheckPoint c = stack.last();
+	stack.pop_back();
+	m_memoryUsage -= c.size;
+	id = c.joID;
+
+	// the object's previous state needs our state to be restored
+	for( int i = stack.size() - 1; i >= 0; --i )
+	{
+		CheckPoint & prev = stack[i];
+		if( prev.joID == id )
 		{
-			m_undoCheckPoints.remove( 0, m_undoCheckPoints.size() - MAX_UNDO_STATES );
+			prev.state = c.state;
+			prev.state.apply( prev.delta );
+			prev.delta = JournalState::Delta();
+
+			m_memoryUsage -= prev.size;
+			prev.size = sizeof( CheckPoint ) + prev.state.memoryUsage();
+			m_memoryUsage += prev.size;
+			break;
 		}
 	}
+
+	return c.state;
+}
+
+
+
+
+void ProjectJournal::clearCheckPoints( CheckPointStack & stack )
+{
+	for( const CheckPoint & c : stack )
+	{
+		m_memoryUsage -= c.size;
+	}
+	stack.clear();
+}
+
+
+
+
+void ProjectJournal::trimCheckPoints()
+{
+	// older states only depend on newer ones, so the oldest can always go;
+	// keep the newest one though, even if it's bigger than the budget
+	int drop = 0;
+	while( m_memoryUsage > m_memoryBudget &&
+				drop < m_undoCheckPoints.size() - 1 )
+	{
+		m_memoryUsage -= m_undoCheckPoints[drop].size;
+		++drop;
+	}
+	m_undoCheckPoints.remove( 0, drop );
 }
 
 
@@ -176,8 +282,8 @@ jo_id_t ProjectJournal::idFromSave( jo_id_t id )
 
 void ProjectJournal::clearJournal()
 {
-	m_undoCheckPoints.clear();
-	m_redoCheckPoints.clear();
+	clearCheckPoints( m_undoCheckPoints );
+	clearCheckPoints( m_redoCheckPoints );
 
 	for( JoIdMap::Iterator it = m_joIDs.begin(); it != m_joIDs.end(); )
 	{
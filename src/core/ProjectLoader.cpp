@@ -0,0 +1,285 @@
+/*
+ * ProjectLoader.cpp - loads song projects without a DOM of the whole file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "ProjectLoader.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QStringList>
+#include <QtCore/QXmlStreamReader>
+#include <QtCore/QXmlStreamWriter>
+
+#include "BinaryProjectFile.h"
+#include "ProjectVersion.h"
+#include "lmmsversion.h"
+
+
+class TrackParser : public QRunnable
+{
+public:
+	TrackParser( ProjectLoader * loader, int index ) :
+		m_loader( loader ),
+		m_index( index )
+	{
+	}
+
+	void run() override
+	{
+		m_loader->parseTrack( m_index );
+	}
+
+private:
+	ProjectLoader * m_loader;
+	int m_index;
+
+} ;
+
+
+
+
+ProjectLoader::ProjectLoader( const QString & fileName ) :
+	m_streaming( false ),
+	m_nestedTracks( 0 ),
+	m_nextTrack( 0 ),
+	m_scheduled( 0 )
+{
+	QFile file( fileName );
+	if( !file.open( QIODevice::ReadOnly ) ||
+		BinaryProjectFile::isBinary( file.peek( 4 ) ) )
+	{
+		return;
+	}
+
+	QByteArray data = file.readAll();
+	file.close();
+
+	int first = 0;
+	while( first < data.size() && QChar( data[first] ).isSpace() )
+	{
+		++first;
+	}
+	if( first == data.size() || data[first] != '<' )
+	{
+		// compressed project (*.mmpz)
+		data = qUncompress( data );
+	}
+
+	// projects are written as UTF-8, anything else is left to DataFile
+	const QByteArray declaration = data.startsWith( "<?xml" ) ?
+				data.left( data.indexOf( "?>" ) ).toLower() : QByteArray();
+	if( declaration.contains( "encoding" ) &&
+		!declaration.contains( "utf-8" ) )
+	{
+		return;
+	}
+
+	QString text = QString::fromUtf8( data );
+	data.clear();
+
+	// only the tracks' text is kept from here on
+	const bool scanned = scan( text );
+	text.clear();
+	if( !scanned )
+	{
+		m_skeleton.clear();
+		m_tracks.clear();
+		m_nestedTracks = 0;
+		return;
+	}
+
+	m_streaming = true;
+	m_parsed.resize( m_tracks.size() );
+	m_done.fill( false, m_tracks.size() );
+	scheduleParsing();
+}
+
+
+
+
+ProjectLoader::~ProjectLoader()
+{
+	// drop the tracks which haven't been started, e.g. on cancelling
+	m_pool.clear();
+	m_pool.waitForDone();
+}
+
+
+
+
+QDomElement ProjectLoader::nextTrack()
+{
+	QMutexLocker lock( &m_mutex );
+
+	// the caller is done with the previous track, so free its DOM
+	if( m_nextTrack > 0 )
+	{
+		m_parsed[m_nextTrack - 1] = QDomDocument();
+	}
+
+	QDomElement track;
+	while( track.isNull() && m_nextTrack < m_tracks.size() )
+	{
+		while( !m_done[m_nextTrack] )
+		{
+			m_parsedCondition.wait( &m_mutex );
+		}
+		track = m_parsed[m_nextTrack].documentElement();
+		if( track.isNull() )
+		{
+			qWarning( "ProjectLoader: could not parse track %d", m_nextTrack );
+		}
+		++m_nextTrack;
+	}
+
+	lock.unlock();
+	scheduleParsing();
+
+	return track;
+}
+
+
+
+
+bool ProjectLoader::scan( const QString & text )
+{
+	QXmlStreamReader reader( text );
+	QXmlStreamWriter writer( &m_skeleton );
+
+	// names of the currently open elements
+	QStringList path;
+	bool foundTracks = false;
+
+	while( !reader.atEnd() )
+	{
+		const QXmlStreamReader::TokenType token = reader.readNext();
+		if( token == QXmlStreamReader::StartElement )
+		{
+			const QString name = reader.name().toString();
+			if( path.isEmpty() )
+			{
+				// only take projects which won't be upgraded, as the
+				// upgrades work on the whole document
+				const QXmlStreamAttributes attributes = reader.attributes();
+				if( name != "lmms-project" ||
+					attributes.value( "type" ) != QLatin1String( "song" ) ||
+					!attributes.hasAttribute( "creatorversion" ) ||
+					ProjectVersion( attributes.value( "creatorversion" ).toString() ) <
+						ProjectVersion( LMMS_VERSION ) )
+				{
+					return false;
+				}
+			}
+			else if( path.size() == 3 && path[1] == "song" &&
+						path[2] == "trackcontainer" )
+			{
+				const int start = text.lastIndexOf( '<',
+						static_cast<int>( reader.characterOffset() ) - 1 );
+
+				// skip the track, counting the tracks of beat/bassline
+				// tracks for the progress dialog
+				for( int depth = 1; depth > 0 && !reader.atEnd(); )
+				{
+					const QXmlStreamReader::TokenType inner = reader.readNext();
+					if( inner == QXmlStreamReader::StartElement )
+					{
+						++depth;
+						if( reader.name() == QLatin1String( "track" ) )
+						{
+							++m_nestedTracks;
+						}
+					}
+					else if( inner == QXmlStreamReader::EndElement )
+					{
+						--depth;
+					}
+				}
+
+				const int end = static_cast<int>( reader.characterOffset() );
+				if( reader.hasError() || start < 0 ||
+					text.at( end - 1 ) != '>' ||
+					!text.midRef( start + 1 ).startsWith( name ) )
+				{
+					return false;
+				}
+				m_tracks.push_back( text.mid( start, end - start ) );
+				continue;
+			}
+			else if( path.size() == 2 && path[1] == "song" &&
+						name == "trackcontainer" )
+			{
+				// the song only loads one track container
+				if( foundTracks )
+				{
+					return false;
+				}
+				foundTracks = true;
+			}
+			path.push_back( name );
+		}
+		else if( token == QXmlStreamReader::EndElement )
+		{
+			path.pop_back();
+		}
+
+		writer.writeCurrentToken( reader );
+	}
+
+	return !reader.hasError() && foundTracks;
+}
+
+
+
+
+void ProjectLoader::scheduleParsing()
+{
+	QMutexLocker lock( &m_mutex );
+
+	// keep a few tracks ahead of the caller, but not the whole project
+	const int window = 2 * m_pool.maxThreadCount();
+	while( m_scheduled < m_tracks.size() &&
+				m_scheduled < m_nextTrack + window )
+	{
+		m_pool.start( new TrackParser( this, m_scheduled ) );
+		++m_scheduled;
+	}
+}
+
+
+
+
+void ProjectLoader::parseTrack( int index )
+{
+	QString text;
+	{
+		QMutexLocker lock( &m_mutex );
+		text.swap( m_tracks[index] );
+	}
+
+	QDomDocument doc;
+	doc.setContent( text );
+	text.clear();
+
+	QMutexLocker lock( &m_mutex );
+	m_parsed[index] = doc;
+	m_done[index] = true;
+	m_parsedCondition.wakeAll();
+}
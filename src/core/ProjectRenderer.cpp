@@ -23,11 +23,16 @@
  */
 
 
+#include <QElapsedTimer>
 #include <QFile>
 
 #include "ProjectRenderer.h"
 #include "Song.h"
 #include "PerfLog.h"
+#include "AudioPort.h"
+#include "NotePlayHandle.h"
+#include "SampleCache.h"
+#include "StemWriter.h"
 
 #include "AudioFileWave.h"
 #include "AudioFileOgg.h"
@@ -84,31 +89,65 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 	QThread( Engine::mixer() ),
 	m_fileDev( NULL ),
 	m_qualitySettings( qualitySettings ),
+	m_outputSettings( outputSettings ),
+	m_exportFileFormat( exportFileFormat ),
 	m_progress( 0 ),
 	m_abort( false )
 {
-	AudioFileDeviceInstantiaton audioEncoderFactory = fileEncodeDevices[exportFileFormat].m_getDevInst;
+	m_fileDev = createFileDevice( outputFilename );
+}
+
+
+
+
+ProjectRenderer::~ProjectRenderer()
+{
+	// finishes pending writes and closes the files
+	for( const Stem & stem : m_stems )
+	{
+		delete stem.writer;
+	}
+}
+
+
+
+
+AudioFileDevice * ProjectRenderer::createFileDevice(
+					const QString & outputFilename )
+{
+	AudioFileDeviceInstantiaton audioEncoderFactory = fileEncodeDevices[m_exportFileFormat].m_getDevInst;
 
+	AudioFileDevice * dev = NULL;
 	if (audioEncoderFactory)
 	{
 		bool successful = false;
 
-		m_fileDev = audioEncoderFactory(
-					outputFilename, outputSettings, DEFAULT_CHANNELS,
+		dev = audioEncoderFactory(
+					outputFilename, m_outputSettings, DEFAULT_CHANNELS,
 					Engine::mixer(), successful );
 		if( !successful )
 		{
-			delete m_fileDev;
-			m_fileDev = NULL;
+			delete dev;
+			dev = NULL;
 		}
 	}
+	return dev;
 }
 
 
 
 
-ProjectRenderer::~ProjectRenderer()
+bool ProjectRenderer::addStem( AudioPort * port,
+					const QString & outputFilename )
 {
+	AudioFileDevice * dev = createFileDevice( outputFilename );
+	if( dev == NULL )
+	{
+		return false;
+	}
+
+	m_stems.push_back( { port, new StemWriter( dev, &m_stemWriterPool ) } );
+	return true;
 }
 
 
@@ -184,15 +223,33 @@ void ProjectRenderer::run()
 	// Skip first empty buffer.
 	Engine::mixer()->nextBuffer();
 
+	for( const Stem & stem : m_stems )
+	{
+		// pick up the export quality's interpolation
+		stem.writer->fileDevice()->applyQualitySettings();
+		stem.port->setStemWriter( stem.writer );
+	}
+
 	m_progress = 0;
 
 	// Now start processing
 	Engine::mixer()->startProcessing(false);
 
+	QElapsedTimer throughputTimer;
+	throughputTimer.start();
+	f_cnt_t framesRendered = 0;
+
 	// Continually track and emit progress percentage to listeners.
 	while (!Engine::getSong()->isExportDone() && !m_abort)
 	{
+		// the audio threads hand the stems to their writers without
+		// waiting, so make sure there is room before rendering
+		for( const Stem & stem : m_stems )
+		{
+			stem.writer->waitForSpace();
+		}
 		m_fileDev->processNextBuffer();
+		framesRendered += Engine::mixer()->framesPerPeriod();
 		const int nprog = Engine::getSong()->getExportProgress();
 		if (m_progress != nprog)
 		{
@@ -204,15 +261,42 @@ void ProjectRenderer::run()
 	// Notify mixer of the end of processing.
 	Engine::mixer()->stopProcessing();
 
+	for( const Stem & stem : m_stems )
+	{
+		stem.port->setStemWriter( NULL );
+		stem.writer->finish();
+	}
+
 	Engine::getSong()->stopExport();
 
 	perfLog.end();
 
-	// If the user aborted export-process, the file has to be deleted.
-	const QString f = m_fileDev->outputFile();
+	// report throughput, e.g. for comparing offline and realtime rendering
+	const double seconds = qMax<qint64>( throughputTimer.elapsed(), 1 ) / 1000.0;
+	perfLog( "Project Render", QString( "%1 frames/s, %2x realtime, "
+						"%3 frames per period" ).
+			arg( framesRendered / seconds, 0, 'f', 0 ).
+			arg( framesRendered / seconds /
+				Engine::mixer()->processingSampleRate(), 0, 'f', 1 ).
+			arg( Engine::mixer()->framesPerPeriod() ) );
+	perfLog( "Note play handles", QString( "%1 from pool, %2 from heap, "
+						"at most %3 at once" ).
+			arg( NotePlayHandleManager::poolHits() ).
+			arg( NotePlayHandleManager::poolMisses() ).
+			arg( NotePlayHandleManager::highWaterMark() ) );
+	perfLog( "Sample cache", QString( "%1 hits, %2 misses, %3 KiB retained" ).
+			arg( SampleCache::hits() ).
+			arg( SampleCache::misses() ).
+			arg( SampleCache::retainedBytes() / 1024 ) );
+
+	// If the user aborted export-process, the files have to be deleted.
 	if( m_abort )
 	{
-		QFile( f ).remove();
+		QFile( m_fileDev->outputFile() ).remove();
+		for( const Stem & stem : m_stems )
+		{
+			QFile( stem.writer->fileDevice()->outputFile() ).remove();
+		}
 	}
 }
 
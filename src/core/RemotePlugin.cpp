@@ -29,9 +29,11 @@
 #endif
 
 #include "BufferManager.h"
+#include "ConfigManager.h"
 #include "RemotePlugin.h"
 #include "Mixer.h"
 #include "Engine.h"
+#include "Song.h"
 
 #include <QDebug>
 #include <QDir>
@@ -94,7 +96,11 @@ RemotePlugin::RemotePlugin() :
 	m_shmSize( 0 ),
 	m_shm( NULL ),
 	m_inputCount( DEFAULT_CHANNELS ),
-	m_outputCount( DEFAULT_CHANNELS )
+	m_outputCount( DEFAULT_CHANNELS ),
+	m_pipelined( ConfigManager::inst()->value( "app",
+					"pipelineremoteplugins" ).toInt() ),
+	m_processingPending( false ),
+	m_periodInFlight( false )
 {
 #ifndef SYNC_WITH_SHM_FIFO
 	struct sockaddr_un sa;
@@ -311,6 +317,78 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		return false;
 	}
 
+	lock();
+
+	// Collect a period still in flight, its reply may have arrived while
+	// waiting for something else already
+	const bool collected = m_periodInFlight;
+	if( m_processingPending )
+	{
+		waitForMessage( IdProcessingDone );
+		m_processingPending = false;
+	}
+	m_periodInFlight = false;
+
+	sendPendingChanges();
+
+	// Delaying the output by a period would misalign it when exporting
+	if( m_pipelined && !Engine::getSong()->isExporting() )
+	{
+		// Return the previous period and leave the plugin processing this
+		// one while we go on with the rest of the mixer
+		if( _out_buf != NULL )
+		{
+			if( collected )
+			{
+				readOutputs( _out_buf, frames );
+			}
+			else
+			{
+				BufferManager::clear( _out_buf, frames );
+			}
+		}
+
+		writeInputs( _in_buf, frames );
+		sendMessage( IdStartProcessing );
+		m_processingPending = !m_failed;
+		m_periodInFlight = m_processingPending;
+		unlock();
+
+		return collected && _out_buf != NULL;
+	}
+
+	writeInputs( _in_buf, frames );
+	sendMessage( IdStartProcessing );
+
+	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
+	{
+		unlock();
+		return false;
+	}
+
+	waitForMessage( IdProcessingDone );
+	unlock();
+
+	readOutputs( _out_buf, frames );
+
+	return true;
+}
+
+
+
+
+f_cnt_t RemotePlugin::latency() const
+{
+	// see process()
+	return m_pipelined && !m_failed && !Engine::getSong()->isExporting() ?
+				Engine::mixer()->framesPerPeriod() : 0;
+}
+
+
+
+
+void RemotePlugin::writeInputs( const sampleFrame * _in_buf, const fpp_t frames )
+{
 	memset( m_shm, 0, m_shmSize );
 
 	ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
@@ -344,19 +422,13 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			}
 		}
 	}
+}
 
-	lock();
-	sendMessage( IdStartProcessing );
 
-	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
-	{
-		unlock();
-		return false;
-	}
 
-	waitForMessage( IdProcessingDone );
-	unlock();
 
+void RemotePlugin::readOutputs( sampleFrame * _out_buf, const fpp_t frames )
+{
 	const ch_cnt_t outputs = qMin<ch_cnt_t>( m_outputCount,
 							DEFAULT_CHANNELS );
 	if( m_splitChannels )
@@ -391,8 +463,6 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			}
 		}
 	}
-
-	return true;
 }
 
 
@@ -540,6 +610,10 @@ bool RemotePlugin::processMessage( const message & _m )
 			break;
 
 		case IdProcessingDone:
+			// might have been received while waiting for another reply
+			m_processingPending = false;
+			break;
+
 		case IdQuit:
 		default:
 			break;
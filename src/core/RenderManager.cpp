@@ -26,9 +26,12 @@
 #include <QDir>
 
 #include "RenderManager.h"
+#include "AssetLoader.h"
 #include "Song.h"
 #include "BBTrackContainer.h"
 #include "BBTrack.h"
+#include "InstrumentTrack.h"
+#include "SampleTrack.h"
 
 
 RenderManager::RenderManager(
@@ -42,6 +45,8 @@ RenderManager::RenderManager(
 	m_format(fmt),
 	m_outputPath(outputPath)
 {
+	// don't render samples that are still being loaded as silence
+	AssetLoader::waitForDone();
 	Engine::mixer()->storeAudioDevice();
 }
 
@@ -91,12 +96,12 @@ void RenderManager::renderNextTrack()
 	}
 }
 
-// Render the song into individual tracks
-void RenderManager::renderTracks()
+// Find all currently unmuted tracks -- we want to render these.
+QVector<Track*> RenderManager::unmutedTracks() const
 {
-	const TrackContainer::TrackList & tl = Engine::getSong()->tracks();
+	QVector<Track*> tracks;
 
-	// find all currently unnmuted tracks -- we want to render these.
+	const TrackContainer::TrackList & tl = Engine::getSong()->tracks();
 	for( auto it = tl.begin(); it != tl.end(); ++it )
 	{
 		Track* tk = (*it);
@@ -106,7 +111,7 @@ void RenderManager::renderTracks()
 		if ( tk->isMuted() == false &&
 				( type == Track::InstrumentTrack || type == Track::SampleTrack ) )
 		{
-			m_unmuted.push_back(tk);
+			tracks.push_back(tk);
 		}
 	}
 
@@ -120,10 +125,18 @@ void RenderManager::renderTracks()
 		if ( tk->isMuted() == false &&
 				( type == Track::InstrumentTrack || type == Track::SampleTrack ) )
 		{
-			m_unmuted.push_back(tk);
+			tracks.push_back(tk);
 		}
 	}
 
+	return tracks;
+}
+
+// Render the song into individual tracks
+void RenderManager::renderTracks()
+{
+	m_unmuted = unmutedTracks();
+
 	// copy the list of unmuted tracks into our rendering queue.
 	// we need to remember which tracks were unmuted to restore state at the end.
 	m_tracksToRender = m_unmuted;
@@ -131,6 +144,45 @@ void RenderManager::renderTracks()
 	renderNextTrack();
 }
 
+// Render the song into individual tracks, playing it only once
+void RenderManager::renderStems()
+{
+	QString extension = ProjectRenderer::getFileExtensionFromFormat( m_format );
+
+	m_activeRenderer = std::make_unique<ProjectRenderer>(
+			m_qualitySettings,
+			m_outputSettings,
+			m_format,
+			QDir(m_outputPath).filePath( "master" + extension ));
+
+	if( m_activeRenderer->isReady() )
+	{
+		// number the files the same way renderTracks() does
+		const QVector<Track*> tracks = unmutedTracks();
+		for( int i = 0; i < tracks.size(); ++i )
+		{
+			AudioPort * port = NULL;
+			if( tracks[i]->type() == Track::InstrumentTrack )
+			{
+				port = static_cast<InstrumentTrack *>( tracks[i] )->audioPort();
+			}
+			else
+			{
+				port = static_cast<SampleTrack *>( tracks[i] )->audioPort();
+			}
+
+			const QString path = pathForTrack( tracks[i], i + 1 );
+			if( !m_activeRenderer->addStem( port, path ) )
+			{
+				qDebug( "Renderer failed to acquire a file device for %s!",
+						qPrintable( path ) );
+			}
+		}
+	}
+
+	startRenderer();
+}
+
 // Render the song into a single track
 void RenderManager::renderProject()
 {
@@ -145,6 +197,11 @@ void RenderManager::render(QString outputPath)
 			m_format,
 			outputPath);
 
+	startRenderer();
+}
+
+void RenderManager::startRenderer()
+{
 	if( m_activeRenderer->isReady() )
 	{
 		// pass progress signals through
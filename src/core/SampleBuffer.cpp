@@ -25,6 +25,7 @@
 #include "SampleBuffer.h"
 
 #include <algorithm>
+#include <vector>
 
 #include <QBuffer>
 #include <QFile>
@@ -49,6 +50,7 @@
 #endif
 
 
+#include "AssetLoader.h"
 #include "base64.h"
 #include "ConfigManager.h"
 #include "DrumSynth.h"
@@ -57,10 +59,17 @@
 #include "GuiApplication.h"
 #include "Mixer.h"
 #include "PathUtil.h"
+#include "SampleCache.h"
+#include "SamplePeaks.h"
 
 #include "FileDialog.h"
 
 
+// File size and sample length limits
+static const int fileSizeMax = 300; // MB
+static const int sampleLengthMax = 90; // Minutes
+
+
 SampleBuffer::SampleBuffer() :
 	m_audioFile( "" ),
 	m_origData( NULL ),
@@ -74,7 +83,10 @@ SampleBuffer::SampleBuffer() :
 	m_amplification( 1.0f ),
 	m_reversed( false ),
 	m_frequency( BaseFreq ),
-	m_sampleRate( mixerSampleRate () )
+	m_sampleRate( mixerSampleRate () ),
+	m_loadGeneration( 0 ),
+	m_peaksPending( false ),
+	m_peaksGeneration( 0 )
 {
 
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( sampleRateChanged() ) );
@@ -134,7 +146,7 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames )
 SampleBuffer::~SampleBuffer()
 {
 	MM_FREE( m_origData );
-	MM_FREE( m_data );
+	freeData();
 }
 
 
@@ -157,13 +169,9 @@ void SampleBuffer::update( bool _keep_settings )
 	{
 		Engine::mixer()->requestChangeInModel();
 		m_varLock.lockForWrite();
-		MM_FREE( m_data );
+		freeData();
 	}
 
-	// File size and sample length limits
-	const int fileSizeMax = 300; // MB
-	const int sampleLengthMax = 90; // Minutes
-
 	bool fileLoadError = false;
 	if( m_audioFile.isEmpty() && m_origData != NULL && m_origFrames > 0 )
 	{
@@ -180,83 +188,8 @@ void SampleBuffer::update( bool _keep_settings )
 	}
 	else if( !m_audioFile.isEmpty() )
 	{
-		QString file = PathUtil::toAbsolute( m_audioFile );
-		int_sample_t * buf = NULL;
-		sample_t * fbuf = NULL;
-		ch_cnt_t channels = DEFAULT_CHANNELS;
-		sample_rate_t samplerate = mixerSampleRate();
-		m_frames = 0;
-
-		const QFileInfo fileInfo( file );
-		if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
-		{
-			fileLoadError = true;
-		}
-		else
-		{
-			// Use QFile to handle unicode file names on Windows
-			QFile f(file);
-			f.open(QIODevice::ReadOnly);
-			SNDFILE * snd_file;
-			SF_INFO sf_info;
-			sf_info.format = 0;
-			if( ( snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) != NULL )
-			{
-				f_cnt_t frames = sf_info.frames;
-				int rate = sf_info.samplerate;
-				if( frames / rate > sampleLengthMax * 60 )
-				{
-					fileLoadError = true;
-				}
-				sf_close( snd_file );
-			}
-			f.close();
-		}
-
-		if( !fileLoadError )
-		{
-#ifdef LMMS_HAVE_OGGVORBIS
-			// workaround for a bug in libsndfile or our libsndfile decoder
-			// causing some OGG files to be distorted -> try with OGG Vorbis
-			// decoder first if filename extension matches "ogg"
-			if( m_frames == 0 && fileInfo.suffix() == "ogg" )
-			{
-				m_frames = decodeSampleOGGVorbis( file, buf, channels, samplerate );
-			}
-#endif
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleSF( file, fbuf, channels,
-									samplerate );
-			}
-#ifdef LMMS_HAVE_OGGVORBIS
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleOGGVorbis( file, buf, channels,
-									samplerate );
-			}
-#endif
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleDS( file, buf, channels,
-									samplerate );
-			}
-		}
-
-		if ( m_frames == 0 || fileLoadError )  // if still no frames, bail
-		{
-			// sample couldn't be decoded, create buffer containing
-			// one sample-frame
-			m_data = MM_ALLOC( sampleFrame, 1 );
-			memset( m_data, 0, sizeof( *m_data ) );
-			m_frames = 1;
-			m_loopStartFrame = m_startFrame = 0;
-			m_loopEndFrame = m_endFrame = 1;
-		}
-		else // otherwise normalize sample rate
-		{
-			normalizeSampleRate( samplerate, _keep_settings );
-		}
+		fileLoadError = !loadAudioFile( PathUtil::toAbsolute( m_audioFile ),
+							_keep_settings );
 	}
 	else
 	{
@@ -275,6 +208,7 @@ void SampleBuffer::update( bool _keep_settings )
 		Engine::mixer()->doneChangeInModel();
 	}
 
+	invalidatePeaks();
 	emit sampleUpdated();
 
 	if( fileLoadError )
@@ -296,72 +230,255 @@ void SampleBuffer::update( bool _keep_settings )
 }
 
 
-void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels)
+bool SampleBuffer::loadAudioFile( const QString & file, bool _keep_settings )
 {
-	// following code transforms int-samples into
-	// float-samples and does amplifying & reversing
-	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
-	m_data = MM_ALLOC( sampleFrame, _frames );
-	const int ch = ( _channels > 1 ) ? 1 : 0;
+	bool fileLoadError = false;
+	int_sample_t * buf = NULL;
+	sample_t * fbuf = NULL;
+	ch_cnt_t channels = DEFAULT_CHANNELS;
+	sample_rate_t samplerate = mixerSampleRate();
+	m_frames = 0;
+
+	const QFileInfo fileInfo( file );
+	// another SampleBuffer might have decoded this file already
+	SampleCache::EntryPtr cached =
+			SampleCache::get( file, mixerSampleRate() );
+	bool large = false;
+	if( cached )
+	{
+		setSharedData( m_reversed ? SampleCache::reversed( cached ) : cached );
+	}
+	else if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
+	{
+		fileLoadError = true;
+	}
+	else
+	{
+		// Use QFile to handle unicode file names on Windows
+		QFile f(file);
+		f.open(QIODevice::ReadOnly);
+		SNDFILE * snd_file;
+		SF_INFO sf_info;
+		sf_info.format = 0;
+		if( ( snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) != NULL )
+		{
+			f_cnt_t frames = sf_info.frames;
+			int rate = sf_info.samplerate;
+			if( frames / rate > sampleLengthMax * 60 )
+			{
+				fileLoadError = true;
+			}
+			// see the OGG Vorbis workaround below
+			large = fileInfo.suffix() != "ogg" && SampleCache::isMapped(
+				qint64( frames ) * mixerSampleRate() / rate );
+			sf_close( snd_file );
+		}
+		f.close();
+	}
 
-	// if reversing is on, we also reverse when
-	// scaling
-	if( m_reversed )
+	if( large && !fileLoadError )
 	{
-		int idx = ( _frames - 1 ) * _channels;
-		for( f_cnt_t frame = 0; frame < _frames;
-						++frame )
+		// the cache maps it anyway, so don't decode it into memory first
+		cached = streamSampleSF( file );
+		if( cached )
 		{
-			m_data[frame][0] = _ibuf[idx+0] * fac;
-			m_data[frame][1] = _ibuf[idx+ch] * fac;
-			idx -= _channels;
+			setSharedData( m_reversed ?
+				SampleCache::reversed( cached ) : cached );
 		}
 	}
-	else
+
+	if( !cached && !fileLoadError )
 	{
-		int idx = 0;
-		for( f_cnt_t frame = 0; frame < _frames;
-						++frame )
+#ifdef LMMS_HAVE_OGGVORBIS
+		// workaround for a bug in libsndfile or our libsndfile decoder
+		// causing some OGG files to be distorted -> try with OGG Vorbis
+		// decoder first if filename extension matches "ogg"
+		if( m_frames == 0 && fileInfo.suffix() == "ogg" )
+		{
+			m_frames = decodeSampleOGGVorbis( file, buf, channels, samplerate );
+		}
+#endif
+		if( m_frames == 0 )
 		{
-			m_data[frame][0] = _ibuf[idx+0] * fac;
-			m_data[frame][1] = _ibuf[idx+ch] * fac;
-			idx += _channels;
+			m_frames = decodeSampleSF( file, fbuf, channels,
+								samplerate );
+		}
+#ifdef LMMS_HAVE_OGGVORBIS
+		if( m_frames == 0 )
+		{
+			m_frames = decodeSampleOGGVorbis( file, buf, channels,
+								samplerate );
+		}
+#endif
+		if( m_frames == 0 )
+		{
+			m_frames = decodeSampleDS( file, buf, channels,
+								samplerate );
 		}
 	}
 
-	delete[] _ibuf;
+	if( cached )
+	{
+		// just update the frame-variables
+		normalizeSampleRate( mixerSampleRate(), _keep_settings );
+	}
+	else if ( m_frames == 0 || fileLoadError )  // if still no frames, bail
+	{
+		// sample couldn't be decoded, create buffer containing
+		// one sample-frame
+		m_data = MM_ALLOC( sampleFrame, 1 );
+		memset( m_data, 0, sizeof( *m_data ) );
+		m_frames = 1;
+		m_loopStartFrame = m_startFrame = 0;
+		m_loopEndFrame = m_endFrame = 1;
+	}
+	else // otherwise normalize sample rate
+	{
+		normalizeSampleRate( samplerate, _keep_settings );
+		const SampleCache::EntryPtr entry = SampleCache::insert( file,
+					mixerSampleRate(), m_data, m_frames );
+		setSharedData( m_reversed ? SampleCache::reversed( entry ) : entry );
+	}
+
+	return !fileLoadError;
 }
 
-void SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels)
 
+
+
+void SampleBuffer::setSharedData( const SampleCache::EntryPtr & entry )
 {
+	m_sharedData = entry;
+	// shared data is never written to, even reversing it swaps in
+	// another entry, see setReversed()
+	m_data = const_cast<sampleFrame *>( entry->data() );
+	m_frames = entry->frames();
+}
+
 
-	m_data = MM_ALLOC( sampleFrame, _frames );
-	const int ch = ( _channels > 1 ) ? 1 : 0;
 
-	// if reversing is on, we also reverse when
-	// scaling
-	if( m_reversed )
+
+void SampleBuffer::freeData()
+{
+	if( m_sharedData )
 	{
-		int idx = ( _frames - 1 ) * _channels;
-		for( f_cnt_t frame = 0; frame < _frames;
-						++frame )
-		{
-			m_data[frame][0] = _fbuf[idx+0];
-			m_data[frame][1] = _fbuf[idx+ch];
-			idx -= _channels;
-		}
+		m_sharedData.reset();
 	}
 	else
 	{
-		int idx = 0;
-		for( f_cnt_t frame = 0; frame < _frames;
-						++frame )
+		MM_FREE( m_data );
+	}
+	m_data = NULL;
+}
+
+
+
+
+void SampleBuffer::invalidatePeaks()
+{
+	m_peaks.reset();
+	++m_peaksGeneration;
+}
+
+
+
+
+void SampleBuffer::requestPeaks()
+{
+	if( m_peaksPending || !gui )
+	{
+		return;
+	}
+	m_peaksPending = true;
+
+	// shared audio is never modified, so it is read in place, anything
+	// else is copied as it may change meanwhile
+	SampleCache::EntryPtr source = m_sharedData;
+	if( !source )
+	{
+		sampleFrame * copy = MM_ALLOC( sampleFrame, m_frames );
+		memcpy( copy, m_data, m_frames * BYTES_PER_FRAME );
+		source = std::make_shared<const SampleCache::Entry>( copy, m_frames );
+	}
+
+	// only the peaks of unmodified files are kept, like their audio. The
+	// file is named after the cache entry, which includes the size and
+	// modification time of the audio file, so it is never outdated.
+	const QString peaksFile = m_sharedData ?
+			SampleCache::peaksFilePath( m_sharedData ) : QString();
+	const int generation = m_peaksGeneration;
+	auto peaks = std::make_shared<std::shared_ptr<const SamplePeaks> >();
+
+	AssetLoader::load( m_audioFile.isEmpty() ? QString( "waveform" ) :
+						"waveform of " + m_audioFile,
+		[source, peaksFile, peaks]()
 		{
-			m_data[frame][0] = _fbuf[idx+0];
-			m_data[frame][1] = _fbuf[idx+ch];
-			idx += _channels;
-		}
+			if( !peaksFile.isEmpty() )
+			{
+				*peaks = SamplePeaks::load( peaksFile, source->frames() );
+			}
+			if( !*peaks )
+			{
+				*peaks = std::make_shared<const SamplePeaks>(
+						source->data(), source->frames() );
+				if( !peaksFile.isEmpty() &&
+					( *peaks )->save( peaksFile ) )
+				{
+					SampleCache::pruneCacheFiles( peaksFile );
+				}
+			}
+		},
+		this,
+		[this, generation, peaks]()
+		{
+			m_peaksPending = false;
+			// if the data changed meanwhile, the next redraw asks for
+			// new peaks
+			if( generation == m_peaksGeneration )
+			{
+				m_peaks = *peaks;
+			}
+			emit peaksUpdated();
+		} );
+}
+
+
+
+
+void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels)
+{
+	// following code transforms int-samples into
+	// float-samples, reversing is done once the data is shared
+	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
+	m_data = MM_ALLOC( sampleFrame, _frames );
+	const int ch = ( _channels > 1 ) ? 1 : 0;
+
+	int idx = 0;
+	for( f_cnt_t frame = 0; frame < _frames;
+					++frame )
+	{
+		m_data[frame][0] = _ibuf[idx+0] * fac;
+		m_data[frame][1] = _ibuf[idx+ch] * fac;
+		idx += _channels;
+	}
+
+	delete[] _ibuf;
+}
+
+void SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels)
+
+{
+
+	m_data = MM_ALLOC( sampleFrame, _frames );
+	const int ch = ( _channels > 1 ) ? 1 : 0;
+
+	int idx = 0;
+	for( f_cnt_t frame = 0; frame < _frames;
+					++frame )
+	{
+		m_data[frame][0] = _fbuf[idx+0];
+		m_data[frame][1] = _fbuf[idx+ch];
+		idx += _channels;
 	}
 
 	delete[] _fbuf;
@@ -379,7 +496,7 @@ void SampleBuffer::normalizeSampleRate( const sample_rate_t _src_sr,
 					mixerSampleRate() );
 
 		m_sampleRate = mixerSampleRate();
-		MM_FREE( m_data );
+		freeData();
 		m_frames = resampled->frames();
 		m_data = MM_ALLOC( sampleFrame, m_frames );
 		memcpy( m_data, resampled->data(), m_frames *
@@ -938,38 +1055,88 @@ f_cnt_t SampleBuffer::getPingPongIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t
 void SampleBuffer::visualize( QPainter & _p, const QRect & _dr,
 							const QRect & _clip, f_cnt_t _from_frame, f_cnt_t _to_frame )
 {
-	if( m_frames == 0 ) return;
+	if( m_frames == 0 || _dr.width() <= 0 ) return;
 
 	const bool focus_on_range = _to_frame <= m_frames
 					&& 0 <= _from_frame && _from_frame < _to_frame;
-	//_p.setClipRect( _clip );
 	const int w = _dr.width();
 	const int h = _dr.height();
 
 	const int yb = h / 2 + _dr.y();
-	const float y_space = h*0.5f;
-	const int nb_frames = focus_on_range ? _to_frame - _from_frame : m_frames;
+	const float y_space = h * 0.5f * m_amplification;
+	const f_cnt_t nb_frames = focus_on_range ? _to_frame - _from_frame : m_frames;
 
-	const int fpp = qBound<int>( 1, nb_frames / w, 20 );
-	QPointF * l = new QPointF[nb_frames / fpp + 1];
-	QPointF * r = new QPointF[nb_frames / fpp + 1];
-	int n = 0;
 	const int xb = _dr.x();
-	const int first = focus_on_range ? _from_frame : 0;
-	const int last = focus_on_range ? _to_frame : m_frames;
-	for( int frame = first; frame < last; frame += fpp )
-	{
-		l[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][0] * y_space * m_amplification ) ) );
-		r[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][1] * y_space * m_amplification ) ) );
-		++n;
-	}
-	_p.setRenderHint( QPainter::Antialiasing );
-	_p.drawPolyline( l, nb_frames / fpp );
-	_p.drawPolyline( r, nb_frames / fpp );
-	delete[] l;
-	delete[] r;
+	const f_cnt_t first = focus_on_range ? _from_frame : 0;
+	const f_cnt_t last = focus_on_range ? _to_frame : m_frames;
+
+	if( nb_frames < 2 * w )
+	{
+		// zoomed in far enough to draw the single frames
+		QPolygonF l( nb_frames );
+		QPolygonF r( nb_frames );
+		for( f_cnt_t frame = first; frame < last; ++frame )
+		{
+			const double x = xb + ( frame - first ) * double( w ) / nb_frames;
+			l[frame - first] = QPointF( x, yb - m_data[frame][0] * y_space );
+			r[frame - first] = QPointF( x, yb - m_data[frame][1] * y_space );
+		}
+		_p.setRenderHint( QPainter::Antialiasing );
+		_p.drawPolyline( l );
+		_p.drawPolyline( r );
+		return;
+	}
+
+	// otherwise draw a line from the minimum to the maximum of each pixel
+	// column and a stronger one for its RMS, so the cost depends on the
+	// width only
+	const double framesPerPixel = double( nb_frames ) / w;
+	std::shared_ptr<const SamplePeaks> peaks;
+	if( framesPerPixel >= SamplePeaks::BlockFrames )
+	{
+		if( m_peaks && m_peaks->frames() == m_frames )
+		{
+			peaks = m_peaks;
+		}
+		else
+		{
+			requestPeaks();
+		}
+	}
+	const int level = peaks ? peaks->levelFor( framesPerPixel ) : 0;
+	// until the peaks are built, only look at some of the frames
+	const f_cnt_t step = qMax<f_cnt_t>( 1, static_cast<f_cnt_t>(
+				framesPerPixel / SamplePeaks::BlockFrames ) );
+
+	const QRect area = _dr.intersected( _clip );
+	QVector<QLine> envelope;
+	QVector<QLine> rms;
+	envelope.reserve( area.width() );
+	rms.reserve( area.width() );
+	for( int x = area.left(); x <= area.right(); ++x )
+	{
+		const f_cnt_t from = first +
+			static_cast<f_cnt_t>( ( x - xb ) * framesPerPixel );
+		const f_cnt_t to = qMin( last, first +
+			static_cast<f_cnt_t>( ( x - xb + 1 ) * framesPerPixel ) );
+		const SamplePeaks::Peak peak = peaks ?
+					peaks->range( level, from, to ) :
+					SamplePeaks::fromFrames( m_data, from, to, step );
+		envelope.push_back( QLine( x, qRound( yb - peak.max * y_space ),
+					x, qRound( yb - peak.min * y_space ) ) );
+		rms.push_back( QLine(
+			x, qRound( yb - qMin( peak.rms, peak.max ) * y_space ),
+			x, qRound( yb - qMax( -peak.rms, peak.min ) * y_space ) ) );
+	}
+
+	const QPen pen = _p.pen();
+	QColor faded = pen.color();
+	faded.setAlpha( faded.alpha() / 2 );
+	_p.setRenderHint( QPainter::Antialiasing, false );
+	_p.setPen( faded );
+	_p.drawLines( envelope );
+	_p.setPen( pen );
+	_p.drawLines( rms );
 }
 
 
@@ -1223,12 +1390,166 @@ SampleBuffer * SampleBuffer::resample( const sample_rate_t _src_sr,
 
 void SampleBuffer::setAudioFile( const QString & _audio_file )
 {
+	++m_loadGeneration;
 	m_audioFile = PathUtil::toShortestRelative( _audio_file );
 	update();
 }
 
 
 
+
+void SampleBuffer::setAudioFileAsync( const QString & _audio_file )
+{
+	if( !gui )
+	{
+		// when rendering from the command line, the data is needed
+		// right away
+		setAudioFile( _audio_file );
+		emit audioFileLoaded();
+		return;
+	}
+
+	const int generation = ++m_loadGeneration;
+	// set right away so that e.g. saving the project keeps the file
+	m_audioFile = PathUtil::toShortestRelative( _audio_file );
+	const QString file = PathUtil::toAbsolute( _audio_file );
+	// keeps the decoded data cached until it is swapped in
+	auto decoded = std::make_shared<SampleCache::EntryPtr>();
+
+	AssetLoader::load( file,
+		[file, decoded]()
+		{
+			*decoded = decodeToCache( file );
+		},
+		this,
+		[this, _audio_file, generation, decoded]()
+		{
+			// skip if another file has been set meanwhile
+			if( generation == m_loadGeneration )
+			{
+				// finds the data in the cache, so the mixer is only
+				// held up for swapping it in
+				setAudioFile( _audio_file );
+				emit audioFileLoaded();
+			}
+		} );
+}
+
+
+
+
+SampleCache::EntryPtr SampleBuffer::decodeToCache( const QString & file )
+{
+	// decode into a scratch buffer, without locking the mixer or
+	// reporting errors from a loader thread
+	SampleBuffer scratch;
+	scratch.freeData();
+	scratch.loadAudioFile( file, false );
+	return scratch.m_sharedData;
+}
+
+
+
+
+SampleCache::EntryPtr SampleBuffer::streamSampleSF( const QString & file )
+{
+	// Use QFile to handle unicode file names on Windows
+	QFile f( file );
+	SF_INFO sf_info;
+	sf_info.format = 0;
+	SNDFILE * snd_file;
+	if( !f.open( QIODevice::ReadOnly ) || ( snd_file =
+		sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) == NULL )
+	{
+		return SampleCache::EntryPtr();
+	}
+
+	const sample_rate_t rate = mixerSampleRate();
+	int error;
+	SRC_STATE * state = NULL;
+	if( sf_info.samplerate != static_cast<int>( rate ) &&
+		( state = src_new( SRC_SINC_MEDIUM_QUALITY,
+					DEFAULT_CHANNELS, &error ) ) == NULL )
+	{
+		sf_close( snd_file );
+		return SampleCache::EntryPtr();
+	}
+
+	const SampleCache::EntryPtr entry = SampleCache::insertStreamed( file,
+								rate,
+		[snd_file, &sf_info, state, rate]( QIODevice & out )
+		{
+			const f_cnt_t ChunkFrames = 65536;
+			std::vector<sample_t> in( ChunkFrames * sf_info.channels );
+			std::vector<sampleFrame> frames( ChunkFrames );
+			std::vector<sampleFrame> resampled( state ? ChunkFrames : 0 );
+			const int ch = sf_info.channels > 1 ? 1 : 0;
+
+			SRC_DATA src_data;
+			src_data.src_ratio = (double) rate / sf_info.samplerate;
+			src_data.data_out = resampled.data()->data();
+			src_data.output_frames = resampled.size();
+
+			bool endOfInput = false;
+			while( !endOfInput )
+			{
+				const sf_count_t read = sf_readf_float( snd_file,
+							in.data(), ChunkFrames );
+				endOfInput = read < ChunkFrames;
+				for( sf_count_t frame = 0; frame < read; ++frame )
+				{
+					frames[frame][0] = in[frame * sf_info.channels];
+					frames[frame][1] = in[frame * sf_info.channels + ch];
+				}
+
+				if( state == NULL )
+				{
+					const qint64 bytes = read * sizeof( sampleFrame );
+					if( out.write( reinterpret_cast<const char *>(
+						frames.data() ), bytes ) != bytes )
+					{
+						return false;
+					}
+					continue;
+				}
+
+				// libsamplerate might not take all frames at once and
+				// keeps returning frames at the end of the input
+				src_data.data_in = frames.data()->data();
+				src_data.input_frames = read;
+				src_data.end_of_input = endOfInput;
+				do
+				{
+					if( src_process( state, &src_data ) )
+					{
+						return false;
+					}
+					const qint64 bytes = src_data.output_frames_gen *
+							sizeof( sampleFrame );
+					if( out.write( reinterpret_cast<const char *>(
+						resampled.data() ), bytes ) != bytes )
+					{
+						return false;
+					}
+					src_data.data_in += src_data.input_frames_used *
+								DEFAULT_CHANNELS;
+					src_data.input_frames -= src_data.input_frames_used;
+				} while( src_data.input_frames > 0 ||
+					( endOfInput && src_data.output_frames_gen > 0 ) );
+			}
+			return true;
+		} );
+
+	if( state )
+	{
+		src_delete( state );
+	}
+	sf_close( snd_file );
+	return entry;
+}
+
+
+
 #ifdef LMMS_HAVE_FLAC_STREAM_DECODER_H
 
 struct flacStreamDecoderClientData
@@ -1413,9 +1734,29 @@ void SampleBuffer::setAmplification( float _a )
 
 void SampleBuffer::setReversed( bool _on )
 {
+	// shared audio is swapped for its reversed version, which is shared
+	// as well, instead of copying it. Looked up or created before holding
+	// up the mixer.
+	SampleCache::EntryPtr reversed;
+	if( m_reversed != _on && m_sharedData )
+	{
+		reversed = SampleCache::reversed( m_sharedData );
+	}
+
 	Engine::mixer()->requestChangeInModel();
 	m_varLock.lockForWrite();
-	if (m_reversed != _on) { std::reverse(m_data, m_data + m_frames); }
+	if (m_reversed != _on)
+	{
+		if( reversed )
+		{
+			setSharedData( reversed );
+		}
+		else
+		{
+			std::reverse(m_data, m_data + m_frames);
+		}
+		invalidatePeaks();
+	}
 	m_reversed = _on;
 	m_varLock.unlock();
 	Engine::mixer()->doneChangeInModel();
@@ -0,0 +1,542 @@
+/*
+ * SampleCache.cpp - process-wide cache of decoded audio files
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleCache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+#include <algorithm>
+
+#include "lmmsconfig.h"
+
+#ifdef LMMS_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "ConfigManager.h"
+#include "MemoryManager.h"
+
+
+// default memory budget in MB
+static const int DefaultCacheSize = 256;
+// default size in MB from which on decoded audio is memory-mapped
+static const int DefaultMapThreshold = 16;
+// default size of all cache files in MB
+static const int DefaultDiskCacheSize = 2048;
+
+// prefix of the keys of reversed audio
+static const QString ReversedPrefix = "reversed:";
+
+static QMutex s_mutex;
+// every entry still in use, whether retained by the cache or not
+static QHash<QString, std::weak_ptr<const SampleCache::Entry> > s_entries;
+// most recently used entries, the least recently used one first
+static QList<SampleCache::EntryPtr> s_retained;
+static qint64 s_retainedBytes = 0;
+static int s_hits = 0;
+static int s_misses = 0;
+
+
+// read every page of a mapping, so playing it doesn't have to wait for the
+// disk - unless the OS drops the pages again under memory pressure
+static void prefault( const uchar * data, qint64 size )
+{
+#ifdef LMMS_HAVE_SYS_MMAN_H
+	madvise( const_cast<uchar *>( data ), size, MADV_WILLNEED );
+#endif
+	const qint64 PageSize = 4096;
+	uchar sum = 0;
+	for( qint64 i = 0; i < size; i += PageSize )
+	{
+		sum += static_cast<const volatile uchar *>( data )[i];
+	}
+	Q_UNUSED( sum );
+}
+
+
+SampleCache::Entry::Entry( sampleFrame * data, f_cnt_t frames,
+						const QString & key ) :
+	m_file( NULL ),
+	m_data( data ),
+	m_frames( frames ),
+	m_key( key )
+{
+}
+
+
+
+
+SampleCache::Entry::Entry( QFile * file, sampleFrame * data, f_cnt_t frames,
+						const QString & key ) :
+	m_file( file ),
+	m_data( data ),
+	m_frames( frames ),
+	m_key( key )
+{
+}
+
+
+
+
+SampleCache::Entry::~Entry()
+{
+	if( m_file )
+	{
+		m_file->unmap( reinterpret_cast<uchar *>( m_data ) );
+		delete m_file;
+	}
+	else
+	{
+		MM_FREE( m_data );
+	}
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::get( const QString & file,
+						sample_rate_t sampleRate )
+{
+	const EntryPtr entry = lookup( key( file, sampleRate ) );
+
+	QMutexLocker lock( &s_mutex );
+	if( entry )
+	{
+		++s_hits;
+	}
+	else
+	{
+		++s_misses;
+	}
+	return entry;
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::insert( const QString & file,
+						sample_rate_t sampleRate,
+						sampleFrame * data, f_cnt_t frames )
+{
+	return store( key( file, sampleRate ), data, frames );
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::insertStreamed( const QString & file,
+				sample_rate_t sampleRate,
+				const std::function<bool( QIODevice & )> & write )
+{
+	return storeStreamed( key( file, sampleRate ), write );
+}
+
+
+
+
+bool SampleCache::isMapped( qint64 frames )
+{
+	const qint64 mapThreshold = ConfigManager::inst()->value( "app",
+			"samplemapthreshold",
+			QString::number( DefaultMapThreshold ) ).toLongLong() * 1024 * 1024;
+	return frames * qint64( sizeof( sampleFrame ) ) >= mapThreshold;
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::reversed( const EntryPtr & entry )
+{
+	const QString & k = entry->key();
+	const QString otherKey = k.isEmpty() ? QString() :
+			k.startsWith( ReversedPrefix ) ?
+				k.mid( ReversedPrefix.length() ) : ReversedPrefix + k;
+	if( !otherKey.isEmpty() )
+	{
+		const EntryPtr other = lookup( otherKey );
+		if( other )
+		{
+			return other;
+		}
+	}
+
+	if( !otherKey.isEmpty() && isMapped( entry->frames() ) )
+	{
+		// reverse chunk by chunk into the cache file
+		const EntryPtr other = storeStreamed( otherKey,
+			[&entry]( QIODevice & out )
+			{
+				const f_cnt_t ChunkFrames = 4096;
+				sampleFrame chunk[ChunkFrames];
+				for( f_cnt_t end = entry->frames(); end > 0; )
+				{
+					const f_cnt_t frames = qMin( end, ChunkFrames );
+					std::reverse_copy( entry->data() + end - frames,
+						entry->data() + end, chunk );
+					const qint64 bytes = frames * sizeof( sampleFrame );
+					if( out.write( reinterpret_cast<const char *>( chunk ),
+								bytes ) != bytes )
+					{
+						return false;
+					}
+					end -= frames;
+				}
+				return true;
+			} );
+		if( other )
+		{
+			return other;
+		}
+	}
+
+	sampleFrame * data = MM_ALLOC( sampleFrame, entry->frames() );
+	std::reverse_copy( entry->data(), entry->data() + entry->frames(), data );
+	if( otherKey.isEmpty() )
+	{
+		return std::make_shared<const Entry>( data, entry->frames() );
+	}
+	return store( otherKey, data, entry->frames() );
+}
+
+
+
+
+void SampleCache::clear()
+{
+	QMutexLocker lock( &s_mutex );
+	s_retained.clear();
+	s_retainedBytes = 0;
+}
+
+
+
+
+int SampleCache::hits()
+{
+	QMutexLocker lock( &s_mutex );
+	return s_hits;
+}
+
+
+
+
+int SampleCache::misses()
+{
+	QMutexLocker lock( &s_mutex );
+	return s_misses;
+}
+
+
+
+
+qint64 SampleCache::retainedBytes()
+{
+	QMutexLocker lock( &s_mutex );
+	return s_retainedBytes;
+}
+
+
+
+
+QString SampleCache::peaksFilePath( const EntryPtr & entry )
+{
+	if( entry->key().isEmpty() )
+	{
+		return QString();
+	}
+	QString path = cacheFilePath( entry->key() );
+	path.chop( 4 );
+	return path + ".peaks";
+}
+
+
+
+
+QString SampleCache::key( const QString & file, sample_rate_t sampleRate )
+{
+	const QFileInfo fileInfo( file );
+	return QString( "%1:%2:%3:%4" ).
+			arg( sampleRate ).
+			arg( fileInfo.size() ).
+			arg( fileInfo.lastModified().toMSecsSinceEpoch() ).
+			arg( fileInfo.absoluteFilePath() );
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::lookup( const QString & key )
+{
+	EntryPtr entry;
+	{
+		QMutexLocker lock( &s_mutex );
+		entry = s_entries.value( key ).lock();
+		if( entry )
+		{
+			retain( entry );
+			return entry;
+		}
+	}
+
+	// decoded in an earlier session? mapped without holding the lock, as
+	// that may have to wait for the disk
+	entry = mapCacheFile( cacheFilePath( key ), key );
+	if( !entry )
+	{
+		return entry;
+	}
+
+	QMutexLocker lock( &s_mutex );
+	// another thread might have mapped it meanwhile
+	const EntryPtr existing = s_entries.value( key ).lock();
+	if( existing )
+	{
+		entry = existing;
+	}
+	else
+	{
+		s_entries.insert( key, entry );
+	}
+	retain( entry );
+	return entry;
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::store( const QString & key,
+					sampleFrame * data, f_cnt_t frames )
+{
+	if( isMapped( frames ) )
+	{
+		const EntryPtr entry = storeStreamed( key,
+			[data, frames]( QIODevice & out )
+			{
+				const qint64 bytes = frames * sizeof( sampleFrame );
+				return out.write( reinterpret_cast<const char *>( data ),
+								bytes ) == bytes;
+			} );
+		if( entry )
+		{
+			MM_FREE( data );
+			return entry;
+		}
+	}
+
+	return publish( key, std::make_shared<const Entry>( data, frames, key ) );
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::storeStreamed( const QString & key,
+				const std::function<bool( QIODevice & )> & write )
+{
+	const QString path = cacheFilePath( key );
+	QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+	// QSaveFile replaces the file atomically, so other instances that
+	// still map the old one are not affected
+	QSaveFile out( path );
+	if( !out.open( QIODevice::WriteOnly ) || !write( out ) || !out.commit() )
+	{
+		qWarning( "SampleCache: could not write %s", qPrintable( path ) );
+		return EntryPtr();
+	}
+
+	pruneCacheFiles( path );
+	const EntryPtr entry = mapCacheFile( path, key );
+	return entry ? publish( key, entry ) : entry;
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::publish( const QString & key,
+						const EntryPtr & entry )
+{
+	QMutexLocker lock( &s_mutex );
+	// forget about files no SampleBuffer uses anymore
+	auto it = s_entries.begin();
+	while( it != s_entries.end() )
+	{
+		if( it->expired() )
+		{
+			it = s_entries.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+	// the same audio might have been decoded by another thread meanwhile
+	const EntryPtr existing = s_entries.value( key ).lock();
+	if( existing )
+	{
+		retain( existing );
+		return existing;
+	}
+	s_entries.insert( key, entry );
+	retain( entry );
+	return entry;
+}
+
+
+
+
+void SampleCache::retain( const EntryPtr & entry )
+{
+	const qint64 bytes = entry->heapBytes();
+	if( s_retained.removeOne( entry ) )
+	{
+		s_retainedBytes -= bytes;
+	}
+	s_retained.append( entry );
+	s_retainedBytes += bytes;
+
+	const qint64 budget = ConfigManager::inst()->value( "app",
+			"samplecachesize",
+			QString::number( DefaultCacheSize ) ).toLongLong() * 1024 * 1024;
+
+	// evict least recently used entries, SampleBuffers using them keep
+	// their own reference
+	while( s_retainedBytes > budget && !s_retained.isEmpty() )
+	{
+		s_retainedBytes -= s_retained.first()->heapBytes();
+		s_retained.removeFirst();
+	}
+}
+
+
+
+
+QString SampleCache::cacheFilePath( const QString & key )
+{
+	return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) +
+		"/samples/" +
+		QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Sha1 ).toHex() +
+		".raw";
+}
+
+
+
+
+SampleCache::EntryPtr SampleCache::mapCacheFile( const QString & path,
+							const QString & key )
+{
+	QFile * f = new QFile( path );
+	const qint64 size = f->size();
+
+	uchar * mapped = NULL;
+	if( size > 0 && size % sizeof( sampleFrame ) == 0 &&
+		f->open( QIODevice::ReadOnly ) )
+	{
+		// mapped read-only, SampleBuffer never modifies shared data
+		mapped = f->map( 0, size );
+	}
+	if( mapped == NULL )
+	{
+		delete f;
+		return EntryPtr();
+	}
+
+#if QT_VERSION >= 0x050a00
+	// pruneCacheFiles() deletes the least recently used files first
+	f->setFileTime( QDateTime::currentDateTime(),
+					QFileDevice::FileModificationTime );
+#endif
+
+	// done by the thread loading the sample, not the first audio thread
+	// playing it
+	prefault( mapped, size );
+
+	return std::make_shared<const Entry>( f,
+					reinterpret_cast<sampleFrame *>( mapped ),
+					size / sizeof( sampleFrame ), key );
+}
+
+
+
+
+void SampleCache::pruneCacheFiles( const QString & keep )
+{
+	const qint64 budget = ConfigManager::inst()->value( "app",
+			"samplediskcachesize",
+			QString::number( DefaultDiskCacheSize ) ).toLongLong() * 1024 * 1024;
+
+	// the cache file and the peaks of an entry share their base name and
+	// are deleted together
+	const QDir dir( QFileInfo( keep ).absolutePath() );
+	const QString keepName = QFileInfo( keep ).completeBaseName();
+	QHash<QString, qint64> sizes;
+	QHash<QString, QDateTime> used;
+	qint64 total = 0;
+	const QFileInfoList files = dir.entryInfoList(
+			QStringList() << "*.raw" << "*.peaks", QDir::Files );
+	for( const QFileInfo & file : files )
+	{
+		const QString name = file.completeBaseName();
+		sizes[name] += file.size();
+		total += file.size();
+		if( !used.contains( name ) || used[name] < file.lastModified() )
+		{
+			used[name] = file.lastModified();
+		}
+	}
+	if( total <= budget )
+	{
+		return;
+	}
+
+	QList<QString> names = sizes.keys();
+	std::sort( names.begin(), names.end(),
+		[&used]( const QString & a, const QString & b )
+		{
+			return used.value( a ) < used.value( b );
+		} );
+
+	// files still mapped stay readable until they are unmapped, or can't
+	// be deleted at all on Windows
+	for( const QString & name : names )
+	{
+		if( total <= budget )
+		{
+			break;
+		}
+		if( name == keepName )
+		{
+			continue;
+		}
+		dir.remove( name + ".raw" );
+		dir.remove( name + ".peaks" );
+		total -= sizes[name];
+	}
+}
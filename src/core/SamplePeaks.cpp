@@ -0,0 +1,240 @@
+/*
+ * SamplePeaks.cpp - peak levels of a sample at several resolutions
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SamplePeaks.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+
+static const char Magic[] = "LMPK";
+static const quint32 FormatVersion = 1;
+
+// magic, version, block size and frame count
+static const int HeaderSize = 4 + 4 + 4 + 8;
+
+
+SamplePeaks::SamplePeaks( const sampleFrame * data, f_cnt_t frames ) :
+	m_frames( frames )
+{
+	QVector<Peak> base( ( frames + BlockFrames - 1 ) / BlockFrames );
+	for( int i = 0; i < base.size(); ++i )
+	{
+		base[i] = fromFrames( data, i * BlockFrames,
+				qMin<f_cnt_t>( ( i + 1 ) * BlockFrames, frames ) );
+	}
+	m_levels.push_back( base );
+	buildLevels();
+}
+
+
+
+
+SamplePeaks::SamplePeaks( f_cnt_t frames, const QVector<Peak> & base ) :
+	m_frames( frames )
+{
+	m_levels.push_back( base );
+	buildLevels();
+}
+
+
+
+
+std::shared_ptr<const SamplePeaks> SamplePeaks::load( const QString & path,
+								f_cnt_t frames )
+{
+	QFile file( path );
+	if( !file.open( QIODevice::ReadOnly ) )
+	{
+		return std::shared_ptr<const SamplePeaks>();
+	}
+
+	const QByteArray header = file.read( HeaderSize );
+	const int blocks = ( frames + BlockFrames - 1 ) / BlockFrames;
+	quint32 version, blockFrames;
+	qint64 savedFrames;
+	if( header.size() != HeaderSize || !header.startsWith( Magic ) )
+	{
+		return std::shared_ptr<const SamplePeaks>();
+	}
+	memcpy( &version, header.constData() + 4, 4 );
+	memcpy( &blockFrames, header.constData() + 8, 4 );
+	memcpy( &savedFrames, header.constData() + 12, 8 );
+	if( version != FormatVersion || blockFrames != BlockFrames ||
+		savedFrames != frames ||
+		file.size() != HeaderSize + blocks * qint64( sizeof( Peak ) ) )
+	{
+		return std::shared_ptr<const SamplePeaks>();
+	}
+
+	QVector<Peak> base( blocks );
+	const qint64 bytes = blocks * qint64( sizeof( Peak ) );
+	if( file.read( reinterpret_cast<char *>( base.data() ), bytes ) != bytes )
+	{
+		return std::shared_ptr<const SamplePeaks>();
+	}
+
+	return std::shared_ptr<const SamplePeaks>(
+					new SamplePeaks( frames, base ) );
+}
+
+
+
+
+bool SamplePeaks::save( const QString & path ) const
+{
+	QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+	// written in host byte order, like the sample cache files
+	const quint32 version = FormatVersion;
+	const quint32 blockFrames = BlockFrames;
+	const qint64 frames = m_frames;
+	QByteArray header( Magic, 4 );
+	header.append( reinterpret_cast<const char *>( &version ), 4 );
+	header.append( reinterpret_cast<const char *>( &blockFrames ), 4 );
+	header.append( reinterpret_cast<const char *>( &frames ), 8 );
+
+	const QVector<Peak> & base = m_levels[0];
+	const qint64 bytes = base.size() * qint64( sizeof( Peak ) );
+	QSaveFile out( path );
+	return out.open( QIODevice::WriteOnly ) &&
+		out.write( header ) == HeaderSize &&
+		out.write( reinterpret_cast<const char *>( base.constData() ),
+							bytes ) == bytes &&
+		out.commit();
+}
+
+
+
+
+f_cnt_t SamplePeaks::blockFrames( int level ) const
+{
+	f_cnt_t frames = BlockFrames;
+	for( int i = 0; i < level; ++i )
+	{
+		frames *= LevelFactor;
+	}
+	return frames;
+}
+
+
+
+
+int SamplePeaks::levelFor( double framesPerPixel ) const
+{
+	int level = 0;
+	while( level + 1 < levels() && blockFrames( level + 1 ) <= framesPerPixel )
+	{
+		++level;
+	}
+	return level;
+}
+
+
+
+
+SamplePeaks::Peak SamplePeaks::range( int level, f_cnt_t from, f_cnt_t to ) const
+{
+	const QVector<Peak> & peaks = m_levels[level];
+	const f_cnt_t size = blockFrames( level );
+	const int first = qBound<int>( 0, from / size, peaks.size() - 1 );
+	const int last = qBound<int>( first + 1, ( to + size - 1 ) / size,
+								peaks.size() );
+	return combine( level, first, last );
+}
+
+
+
+
+SamplePeaks::Peak SamplePeaks::fromFrames( const sampleFrame * data,
+					f_cnt_t from, f_cnt_t to, f_cnt_t step )
+{
+	Peak peak = { 0, 0, 0 };
+	if( from >= to )
+	{
+		return peak;
+	}
+
+	peak.min = peak.max = data[from][0];
+	float squares = 0;
+	f_cnt_t count = 0;
+	for( f_cnt_t f = from; f < to; f += step, ++count )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			const float s = data[f][ch];
+			peak.min = qMin( peak.min, s );
+			peak.max = qMax( peak.max, s );
+			squares += s * s;
+		}
+	}
+	peak.rms = sqrtf( squares / ( count * DEFAULT_CHANNELS ) );
+	return peak;
+}
+
+
+
+
+SamplePeaks::Peak SamplePeaks::combine( int level, int first, int last ) const
+{
+	const QVector<Peak> & peaks = m_levels[level];
+	const f_cnt_t size = blockFrames( level );
+
+	Peak peak = peaks[first];
+	// weighted by the frames of each block, as the last one may be shorter
+	double squares = 0;
+	for( int i = first; i < last; ++i )
+	{
+		const f_cnt_t frames = qMin( size, m_frames - i * size );
+		peak.min = qMin( peak.min, peaks[i].min );
+		peak.max = qMax( peak.max, peaks[i].max );
+		squares += double( peaks[i].rms ) * peaks[i].rms * frames;
+	}
+	const f_cnt_t frames = qMin( last * size, m_frames ) - first * size;
+	peak.rms = static_cast<float>( sqrt( squares / frames ) );
+	return peak;
+}
+
+
+
+
+void SamplePeaks::buildLevels()
+{
+	while( m_levels.last().size() > 1 )
+	{
+		const int below = m_levels.size() - 1;
+		const int blocks = m_levels[below].size();
+		QVector<Peak> level( ( blocks + LevelFactor - 1 ) / LevelFactor );
+		for( int i = 0; i < level.size(); ++i )
+		{
+			const int first = i * LevelFactor;
+			level[i] = combine( below, first,
+					qMin( first + LevelFactor, blocks ) );
+		}
+		m_levels.push_back( level );
+	}
+}
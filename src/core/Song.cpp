@@ -47,8 +47,10 @@
 #include "GuiApplication.h"
 #include "ExportFilter.h"
 #include "Pattern.h"
+#include "PerfLog.h"
 #include "PianoRoll.h"
 #include "ProjectJournal.h"
+#include "ProjectLoader.h"
 #include "ProjectNotes.h"
 #include "SongEditor.h"
 #include "TimeLineWidget.h"
@@ -90,7 +92,8 @@ Song::Song() :
 	m_elapsedTicks( 0 ),
 	m_elapsedBars( 0 ),
 	m_loopRenderCount(1),
-	m_loopRenderRemaining(1)
+	m_loopRenderRemaining(1),
+	m_nextAutomation()
 {
 	for(int i = 0; i < Mode_Count; ++i) m_elapsedMilliSeconds[i] = 0;
 	connect( &m_tempoModel, SIGNAL( dataChanged() ),
@@ -393,7 +396,7 @@ void Song::processNextBuffer()
 
 		if( ( f_cnt_t ) currentFrame == 0 )
 		{
-			processAutomations(trackList, m_playPos[m_playMode], framesToPlay);
+			processAutomations(trackList, m_playPos[m_playMode], framesPlayed);
 
 			// loop through all tracks and play them
 			for( int i = 0; i < trackList.size(); ++i )
@@ -415,7 +418,7 @@ void Song::processNextBuffer()
 }
 
 
-void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fpp_t)
+void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, f_cnt_t frameOffset)
 {
 	AutomatedValueMap values;
 
@@ -442,7 +445,27 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 		return;
 	}
 
-	values = container->automatedValuesAt(timeStart, tcoNum);
+	// the values of this tick were looked up as the next values of the
+	// last tick, unless playback jumped or one of their models is gone
+	const unsigned int destroyedModels = AutomatableModel::destroyedCount();
+	if (m_nextAutomation.time == timeStart && m_nextAutomation.container == container
+		&& m_nextAutomation.tcoNum == tcoNum
+		&& m_nextAutomation.destroyedModels == destroyedModels)
+	{
+		values.swap(m_nextAutomation.values);
+	}
+	else
+	{
+		values = container->automatedValuesAt(timeStart, tcoNum);
+	}
+
+	// values of the next tick, to let the models ramp towards them
+	m_nextAutomation.values = container->automatedValuesAt(timeStart + 1, tcoNum);
+	m_nextAutomation.time = timeStart + 1;
+	m_nextAutomation.container = container;
+	m_nextAutomation.tcoNum = tcoNum;
+	m_nextAutomation.destroyedModels = destroyedModels;
+	const AutomatedValueMap & nextValues = m_nextAutomation.values;
 	TrackList tracks = container->tracks();
 
 	Track::tcoVector tcos;
@@ -468,11 +491,14 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 	}
 
 	// Apply values
+	const f_cnt_t framesPerTick = static_cast<f_cnt_t>(Engine::framesPerTick());
 	for (auto it = values.begin(); it != values.end(); it++)
 	{
 		if (! recordedModels.contains(it.key()))
 		{
-			it.key()->setAutomatedValue(it.value());
+			it.key()->setAutomatedValue(it.value(),
+					nextValues.value(it.key(), it.value()),
+					frameOffset, framesPerTick);
 		}
 	}
 }
@@ -1047,7 +1073,12 @@ void Song::loadProject( const QString & fileName )
 	m_oldFileName = m_fileName;
 	setProjectFileName(fileName);
 
-	DataFile dataFile( m_fileName );
+	PerfLogTimer perfLog( "Project Load", true );
+
+	// with a streamed project, dataFile holds everything but the tracks
+	ProjectLoader loader( m_fileName );
+	DataFile dataFile = loader.isStreaming() ?
+			DataFile( loader.skeleton() ) : DataFile( m_fileName );
 	// if file could not be opened, head-node is null and we create
 	// new project
 	if( dataFile.head().isNull() )
@@ -1122,12 +1153,18 @@ void Song::loadProject( const QString & fileName )
 			}
 		}
 	}
+	m_nLoadingTrack += loader.trackCount();
 
 	while( !node.isNull() && !isCancelled() )
 	{
 		if( node.isElement() )
 		{
-			if( node.nodeName() == "trackcontainer" )
+			if( node.nodeName() == "trackcontainer" && loader.isStreaming() )
+			{
+				// the tracks are the only settings of the container
+				loadTracks( [&loader]() { return loader.nextTrack(); } );
+			}
+			else if( node.nodeName() == "trackcontainer" )
 			{
 				( (JournallingObject *)( this ) )->restoreState( node.toElement() );
 			}
@@ -1181,6 +1218,8 @@ void Song::loadProject( const QString & fileName )
 
 	Engine::mixer()->doneChangeInModel();
 
+	perfLog.end();
+
 	ConfigManager::inst()->addRecentlyOpenedProject( fileName );
 
 	Engine::projectJournal()->setJournalling( true );
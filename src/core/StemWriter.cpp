@@ -0,0 +1,151 @@
+/*
+ * StemWriter.cpp - encodes the output of a single audio port into a file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QtCore/QThreadPool>
+
+#include <cstring>
+
+#include "StemWriter.h"
+#include "AudioFileDevice.h"
+#include "BufferManager.h"
+#include "Engine.h"
+#include "Mixer.h"
+
+
+StemWriter::StemWriter( AudioFileDevice * fileDev, QThreadPool * pool ) :
+	m_fileDev( fileDev ),
+	m_pool( pool ),
+	m_frames( Engine::mixer()->framesPerPeriod() ),
+	m_buffers( new sampleFrame[MaxPendingBuffers * m_frames] ),
+	m_written( 0 ),
+	m_encoded( 0 ),
+	m_scheduled( false )
+{
+	// we get re-submitted to the pool whenever new buffers arrive
+	setAutoDelete( false );
+}
+
+
+
+
+StemWriter::~StemWriter()
+{
+	finish();
+	delete m_fileDev;
+	delete[] m_buffers;
+}
+
+
+
+
+void StemWriter::write( const sampleFrame * buf )
+{
+	const unsigned int written = m_written.load( std::memory_order_relaxed );
+	if( written - m_encoded.load() >=
+					static_cast<unsigned int>( MaxPendingBuffers ) )
+	{
+		// the export loop waits for room before every period
+		Q_ASSERT( false );
+		return;
+	}
+
+	sampleFrame * slot = m_buffers + ( written % MaxPendingBuffers ) * m_frames;
+	if( buf )
+	{
+		memcpy( slot, buf, m_frames * sizeof( sampleFrame ) );
+	}
+	else
+	{
+		BufferManager::clear( slot, m_frames );
+	}
+
+	m_written.store( written + 1 );
+}
+
+
+
+
+void StemWriter::waitForSpace()
+{
+	QMutexLocker lock( &m_mutex );
+	schedule();
+	while( m_written.load() - m_encoded.load() >=
+					static_cast<unsigned int>( MaxPendingBuffers ) )
+	{
+		m_drained.wait( &m_mutex );
+	}
+}
+
+
+
+
+void StemWriter::finish()
+{
+	QMutexLocker lock( &m_mutex );
+	schedule();
+	while( m_scheduled )
+	{
+		m_drained.wait( &m_mutex );
+	}
+}
+
+
+
+
+void StemWriter::schedule()
+{
+	if( !m_scheduled && m_written.load() != m_encoded.load() )
+	{
+		m_scheduled = true;
+		m_pool->start( this );
+	}
+}
+
+
+
+
+void StemWriter::run()
+{
+	unsigned int encoded = m_encoded.load( std::memory_order_relaxed );
+	while( true )
+	{
+		while( encoded != m_written.load() )
+		{
+			m_fileDev->writeProcessedBuffer( m_buffers +
+				( encoded % MaxPendingBuffers ) * m_frames, m_frames );
+			m_encoded.store( ++encoded );
+
+			QMutexLocker lock( &m_mutex );
+			m_drained.wakeAll();
+		}
+
+		// buffers written before the last schedule() are encoded by us,
+		// as it doesn't start us again while we're running
+		QMutexLocker lock( &m_mutex );
+		if( encoded == m_written.load() )
+		{
+			m_scheduled = false;
+			m_drained.wakeAll();
+			return;
+		}
+	}
+}
@@ -156,6 +156,10 @@ void TrackContentObject::movePosition( const MidiTime & pos )
 	{
 		Engine::mixer()->requestChangeInModel();
 		m_startPosition = newPos;
+		if( getTrack() )
+		{
+			getTrack()->updateTCOPosition( this );
+		}
 		Engine::mixer()->doneChangeInModel();
 		Engine::getSong()->updateLength();
 		emit positionChanged();
@@ -174,7 +178,12 @@ void TrackContentObject::movePosition( const MidiTime & pos )
  */
 void TrackContentObject::changeLength( const MidiTime & length )
 {
+	const MidiTime oldLength = m_length;
 	m_length = length;
+	if( getTrack() )
+	{
+		getTrack()->updateTCOLength( this, oldLength );
+	}
 	Engine::getSong()->updateLength();
 	emit lengthChanged();
 }
@@ -2458,6 +2467,10 @@ Track::Track( TrackTypes type, TrackContainer * tc ) :
 					/*!< For controlling track soloing */
 	m_simpleSerializingMode( false ),
 	m_trackContentObjects(),        /*!< The track content objects (segments) */
+	m_tcosByStart(),
+	m_maxTCOLength( 0 ),
+	m_tcoIndex( new TCOIndex{ tcoVector(), 0 } ),
+	m_deferTCOIndex( false ),
 	m_color( 0, 0, 0 ),
 	m_hasColor( false )
 {
@@ -2483,6 +2496,7 @@ Track::~Track()
 	lock();
 	emit destroyedTrack();
 
+	deferTCOIndex();
 	while( !m_trackContentObjects.isEmpty() )
 	{
 		delete m_trackContentObjects.last();
@@ -2490,6 +2504,17 @@ Track::~Track()
 
 	m_trackContainer->removeTrack( this );
 	unlock();
+
+	// the mixer is gone already when the last tracks get deleted on
+	// shutdown
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->retire( m_tcoIndex.load() );
+	}
+	else
+	{
+		delete m_tcoIndex.load();
+	}
 }
 
 
@@ -2687,6 +2712,9 @@ void Track::loadSettings( const QDomElement & element )
 		return;
 	}
 
+	// publish the index once all TCOs are loaded
+	deferTCOIndex();
+
 	while( !m_trackContentObjects.empty() )
 	{
 		delete m_trackContentObjects.front();
@@ -2714,6 +2742,8 @@ void Track::loadSettings( const QDomElement & element )
 		node = node.nextSibling();
 	}
 
+	endDeferTCOIndex();
+
 	int storedHeight = element.attribute( "trackheight" ).toInt();
 	if( storedHeight >= MINIMAL_TRACK_HEIGHT )
 	{
@@ -2731,6 +2761,11 @@ void Track::loadSettings( const QDomElement & element )
 TrackContentObject * Track::addTCO( TrackContentObject * tco )
 {
 	m_trackContentObjects.push_back( tco );
+	m_tcosByStart.insert( std::upper_bound( m_tcosByStart.begin(),
+					m_tcosByStart.end(), tco,
+					TrackContentObject::comparePosition ), tco );
+	m_maxTCOLength = qMax<tick_t>( m_maxTCOLength, tco->length() );
+	publishTCOIndex();
 
 	emit trackContentObjectAdded( tco );
 
@@ -2752,6 +2787,14 @@ void Track::removeTCO( TrackContentObject * tco )
 	if( it != m_trackContentObjects.end() )
 	{
 		m_trackContentObjects.erase( it );
+		m_tcosByStart.erase( std::find( m_tcosByStart.begin(),
+						m_tcosByStart.end(), tco ) );
+		if( tco->length() >= m_maxTCOLength )
+		{
+			updateMaxTCOLength();
+		}
+		publishTCOIndex();
+
 		if( Engine::getSong() )
 		{
 			Engine::getSong()->updateLength();
@@ -2761,13 +2804,119 @@ void Track::removeTCO( TrackContentObject * tco )
 }
 
 
+/*! \brief Move a TrackContentObject to its new place in the position index
+ *
+ *  Called by TrackContentObject::movePosition() while the mixer is locked.
+ *
+ *  \param tco The TrackContentObject whose start position changed.
+ */
+void Track::updateTCOPosition( TrackContentObject * tco )
+{
+	tcoVector::iterator it = std::find( m_tcosByStart.begin(),
+						m_tcosByStart.end(), tco );
+	if( it == m_tcosByStart.end() )
+	{
+		return;
+	}
+	m_tcosByStart.erase( it );
+	m_tcosByStart.insert( std::upper_bound( m_tcosByStart.begin(),
+					m_tcosByStart.end(), tco,
+					TrackContentObject::comparePosition ), tco );
+	publishTCOIndex();
+}
+
+
+
+
+/*! \brief Keep track of the longest TrackContentObject
+ *
+ *  \param tco The TrackContentObject whose length changed.
+ *  \param oldLength Its length before the change.
+ */
+void Track::updateTCOLength( TrackContentObject * tco,
+						const MidiTime & oldLength )
+{
+	const tick_t maxLength = m_maxTCOLength;
+	if( tco->length() >= m_maxTCOLength )
+	{
+		m_maxTCOLength = tco->length();
+	}
+	else if( oldLength >= m_maxTCOLength )
+	{
+		// the longest TCO got shorter
+		updateMaxTCOLength();
+	}
+
+	if( m_maxTCOLength != maxLength )
+	{
+		publishTCOIndex();
+	}
+}
+
+
+
+
+void Track::updateMaxTCOLength()
+{
+	tick_t maxLength = 0;
+	for( const TrackContentObject * tco : m_trackContentObjects )
+	{
+		maxLength = qMax<tick_t>( maxLength, tco->length() );
+	}
+	m_maxTCOLength = maxLength;
+}
+
+
+
+
+void Track::publishTCOIndex()
+{
+	if( m_deferTCOIndex )
+	{
+		return;
+	}
+
+	TCOIndex * index = new TCOIndex{ m_tcosByStart, m_maxTCOLength };
+	TCOIndex * old = m_tcoIndex.exchange( index );
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->retire( old );
+	}
+	else
+	{
+		delete old;
+	}
+}
+
+
+
+
+void Track::deferTCOIndex()
+{
+	m_deferTCOIndex = true;
+}
+
+
+
+
+void Track::endDeferTCOIndex()
+{
+	m_deferTCOIndex = false;
+	publishTCOIndex();
+}
+
+
+
+
 /*! \brief Remove all TCOs from this track */
 void Track::deleteTCOs()
 {
+	deferTCOIndex();
 	while( ! m_trackContentObjects.isEmpty() )
 	{
 		delete m_trackContentObjects.first();
 	}
+	endDeferTCOIndex();
 }
 
 
@@ -2842,6 +2991,10 @@ int Track::getTCONum( const TrackContentObject * tco )
  *  the given time period.
  *
  *  We return the TCOs we find in order by time, earliest TCOs first.
+ *  Only TCOs starting between start minus the length of our longest TCO
+ *  and end can intersect the period, so we binary search for these in
+ *  the last published snapshot of our position index. This is safe to
+ *  call from the audio threads while the GUI edits the track.
  *
  *  \param tcoV The list to contain the found trackContentObjects.
  *  \param start The MIDI start time of the range.
@@ -2850,16 +3003,38 @@ int Track::getTCONum( const TrackContentObject * tco )
 void Track::getTCOsInRange( tcoVector & tcoV, const MidiTime & start,
 							const MidiTime & end )
 {
-	for( TrackContentObject* tco : m_trackContentObjects )
+	const TCOIndex * index = m_tcoIndex.load();
+	const int first = start - index->maxLength;
+	tcoVector::const_iterator it = std::lower_bound(
+		index->tcos.constBegin(), index->tcos.constEnd(), first,
+		[]( const TrackContentObject * tco, int pos )
+		{
+			return tco->startPosition() < pos;
+		} );
+
+	const int oldSize = tcoV.size();
+	for( ; it != index->tcos.constEnd() &&
+			( *it )->startPosition() <= end; ++it )
 	{
-		int s = tco->startPosition();
-		int e = tco->endPosition();
-		if( ( s <= end ) && ( e >= start ) )
+		if( ( *it )->endPosition() >= start )
 		{
 			// TCO is within given range
-			// Insert sorted by TCO's position
-			tcoV.insert(std::upper_bound(tcoV.begin(), tcoV.end(), tco, TrackContentObject::comparePosition),
-						tco);
+			tcoV.push_back( *it );
+		}
+	}
+
+	// tcoV may already contain TCOs of other tracks, keep it sorted by
+	// TCO's position. Merge by hand, as std::inplace_merge may allocate a
+	// temporary buffer.
+	if( oldSize > 0 )
+	{
+		tcoVector::iterator pos = tcoV.begin();
+		for( int i = oldSize; i < tcoV.size(); ++i )
+		{
+			pos = std::upper_bound( pos, tcoV.begin() + i, tcoV[i],
+					TrackContentObject::comparePosition );
+			std::rotate( pos, tcoV.begin() + i, tcoV.begin() + i + 1 );
+			++pos;
 		}
 	}
 }
@@ -86,9 +86,24 @@ void TrackContainer::loadSettings( const QDomElement & _this )
 		clearAllTracks();
 	}
 
+	QDomElement track = _this.firstChildElement();
+	loadTracks( [&track]()
+		{
+			const QDomElement current = track;
+			track = track.nextSiblingElement();
+			return current;
+		}, !journalRestore );
+}
+
+
+
+
+void TrackContainer::loadTracks( const std::function<QDomElement()> & nextTrack,
+							bool showProgress )
+{
 	static QProgressDialog * pd = NULL;
 	bool was_null = ( pd == NULL );
-	if( !journalRestore && gui != nullptr )
+	if( showProgress && gui != nullptr )
 	{
 		if( pd == NULL )
 		{
@@ -102,8 +117,7 @@ void TrackContainer::loadSettings( const QDomElement & _this )
 		}
 	}
 
-	QDomNode node = _this.firstChild();
-	while( !node.isNull() )
+	for( QDomElement node = nextTrack(); !node.isNull(); node = nextTrack() )
 	{
 		if( pd != NULL )
 		{
@@ -124,20 +138,18 @@ void TrackContainer::loadSettings( const QDomElement & _this )
 			}
 		}
 
-		if( node.isElement() &&
-			!node.toElement().attribute( "metadata" ).toInt() )
+		if( !node.attribute( "metadata" ).toInt() )
 		{
-			QString trackName = node.toElement().hasAttribute( "name" ) ?
-						node.toElement().attribute( "name" ) :
+			QString trackName = node.hasAttribute( "name" ) ?
+						node.attribute( "name" ) :
 						node.firstChild().toElement().attribute( "name" );
 			if( pd != NULL )
 			{
 				pd->setLabelText( tr("Loading Track %1 (%2/Total %3)").arg( trackName ).
 						  arg( pd->value() + 1 ).arg( Engine::getSong()->getLoadingTrackCount() ) );
 			}
-			Track::create( node.toElement(), this );
+			Track::create( node, this );
 		}
-		node = node.nextSibling();
 	}
 
 	if( pd != NULL )
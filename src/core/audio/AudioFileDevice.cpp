@@ -28,6 +28,7 @@
 #include "AudioFileDevice.h"
 #include "ExportProjectDialog.h"
 #include "GuiApplication.h"
+#include "Mixer.h"
 
 
 AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
@@ -36,7 +37,8 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 					Mixer*  _mixer ) :
 	AudioDevice( _channels, _mixer ),
 	m_outputFile( _file ),
-	m_outputSettings(outputSettings)
+	m_outputSettings(outputSettings),
+	m_resampleBuffer( NULL )
 {
 	setSampleRate( outputSettings.getSampleRate() );
 
@@ -72,6 +74,29 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 AudioFileDevice::~AudioFileDevice()
 {
 	m_outputFile.close();
+	delete[] m_resampleBuffer;
+}
+
+
+
+
+void AudioFileDevice::writeProcessedBuffer( const surroundSampleFrame * _ab,
+							const fpp_t _frames )
+{
+	if( mixer()->processingSampleRate() == sampleRate() )
+	{
+		writeBuffer( _ab, _frames, 1.0f );
+		return;
+	}
+
+	if( m_resampleBuffer == NULL )
+	{
+		m_resampleBuffer =
+			new surroundSampleFrame[mixer()->framesPerPeriod()];
+	}
+	const fpp_t frames = resample( _ab, _frames, m_resampleBuffer,
+				mixer()->processingSampleRate(), sampleRate() );
+	writeBuffer( m_resampleBuffer, frames, 1.0f );
 }
 
 
@@ -28,8 +28,10 @@
 #include "FxMixer.h"
 #include "Engine.h"
 #include "Mixer.h"
+#include "MixerWorkerThread.h"
 #include "MixHelpers.h"
 #include "BufferManager.h"
+#include "StemWriter.h"
 
 
 AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
@@ -43,7 +45,11 @@ AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
 	m_effects( _has_effect_chain ? new EffectChain( NULL ) : NULL ),
 	m_volumeModel( volumeModel ),
 	m_panningModel( panningModel ),
-	m_mutedModel( mutedModel )
+	m_mutedModel( mutedModel ),
+	m_dependencies( 0 ),
+	m_dependenciesMet( 0 ),
+	m_graphFxChannel( NULL ),
+	m_stemWriter( NULL )
 {
 	Engine::mixer()->addAudioPort( this );
 	setExtOutputEnabled( true );
@@ -81,6 +87,18 @@ void AudioPort::setExtOutputEnabled( bool _enabled )
 
 
 
+void AudioPort::setNextFxChannel( const fx_ch_t _chnl )
+{
+	if( _chnl != m_nextFxChannel )
+	{
+		m_nextFxChannel = _chnl;
+		Engine::mixer()->invalidateRenderGraph();
+	}
+}
+
+
+
+
 void AudioPort::setName( const QString & _name )
 {
 	m_name = _name;
@@ -101,10 +119,57 @@ bool AudioPort::processEffects()
 }
 
 
+f_cnt_t AudioPort::latency()
+{
+	// play handles are mixed as they are, so the port is as late as the
+	// latest of them
+	f_cnt_t frames = 0;
+	m_playHandleLock.lock();
+	for( const PlayHandle * handle : m_playHandles )
+	{
+		frames = qMax( frames, handle->latency() );
+	}
+	m_playHandleLock.unlock();
+
+	return m_effects ? frames + m_effects->latency() : frames;
+}
+
+
+
+
+void AudioPort::incrementDeps()
+{
+	if( ++m_dependenciesMet == m_dependencies )
+	{
+		MixerWorkerThread::addJob( this );
+	}
+}
+
+
+
+
+void AudioPort::processed()
+{
+	// let the FX channel know we're done, no matter whether we produced
+	// any output
+	if( m_graphFxChannel )
+	{
+		m_graphFxChannel->incrementDeps();
+	}
+}
+
+
+
+
 void AudioPort::doProcessing()
 {
 	if( m_mutedModel && m_mutedModel->value() )
 	{
+		if( m_stemWriter )
+		{
+			m_stemWriter->write( NULL );
+		}
+		processed();
 		return;
 	}
 
@@ -133,86 +198,18 @@ void AudioPort::doProcessing()
 	if( m_bufferUsage )
 	{
 		// handle volume and panning
-		// has both vol and pan models
-		if( m_volumeModel && m_panningModel )
-		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-			ValueBuffer * panBuf = m_panningModel->valueBuffer();
-
-			// both vol and pan have s.ex.data:
-			if( volBuf && panBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-
-			// only vol has s.ex.data:
-			else if( volBuf )
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float l = ( p <= 0 ? 1.0f : 1.0f - p );
-				float r = ( p >= 0 ? 1.0f : 1.0f + p );
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v * l;
-					m_portBuffer[f][1] *= v * r;
-				}
-			}
-
-			// only pan has s.ex.data:
-			else if( panBuf )
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-
-			// neither has s.ex.data:
-			else
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-		}
-
-		// has vol model only
-		else if( m_volumeModel )
+		if( m_volumeModel )
 		{
 			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-
-			if( volBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
-			else
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
+			ValueBuffer * panBuf = m_panningModel ?
+					m_panningModel->valueBuffer() : NULL;
+
+			MixHelpers::multiplyByVolumePanning( m_portBuffer,
+				volBuf ? volBuf->values() : NULL,
+				m_volumeModel->value(),
+				panBuf ? panBuf->values() : NULL,
+				m_panningModel ? m_panningModel->value() : 0.0f,
+				fpp );
 		}
 	}
 	// as of now there's no situation where we only have panning model but no volume model
@@ -220,12 +217,24 @@ void AudioPort::doProcessing()
 
 	// handle effects
 	const bool me = processEffects();
-	if( me || m_bufferUsage )
+	const bool hasOutput = me || m_bufferUsage;
+	if( hasOutput )
 	{
-		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
-																			// TODO: improve the flow here - convert to pull model
+		if( m_graphFxChannel )
+		{
+			// send output to fx mixer
+			Engine::fxMixer()->mixToChannel( m_portBuffer,
+					m_graphFxChannel->m_channelIndex );
+		}
 		m_bufferUsage = false;
 	}
+
+	if( m_stemWriter )
+	{
+		m_stemWriter->write( hasOutput ? m_portBuffer : NULL );
+	}
+
+	processed();
 }
 
 
@@ -59,6 +59,7 @@
 
 #include "MainApplication.h"
 #include "ConfigManager.h"
+#include "DataFile.h"
 #include "NotePlayHandle.h"
 #include "embed.h"
 #include "Engine.h"
@@ -180,6 +181,8 @@ void printHelp()
 		"          geometry is <xsizexysize+xoffset+yoffsety>.\n"
 		"      --import <in> [-e]         Import MIDI or Hydrogen file <in>.\n"
 		"          If -e is specified lmms exits after importing the file.\n"
+		"      --midi-latency <out>       Log the latency of each MIDI input\n"
+		"          event in microseconds to <out>\n"
 		"\nOptions for \"render\" and \"rendertracks\":\n"
 		"  -a, --float                    Use 32bit float bit depth\n"
 		"  -b, --bitrate <bitrate>        Specify output bitrate in KBit/s\n"
@@ -199,6 +202,9 @@ void printHelp()
 		"            j: Joint Stereo\n"
 		"            m: Mono\n"
 		"          Default: j\n"
+		"      --offline                  Render in larger blocks for faster than\n"
+		"          realtime rendering. Ignored for projects with\n"
+		"          automation or controllers, which need normal blocks.\n"
 		"  -o, --output <path>            Render into <path>\n"
 		"          For \"render\", provide a file path\n"
 		"          For \"rendertracks\", provide a directory path\n"
@@ -207,6 +213,15 @@ void printHelp()
 		"  -p, --profile <out>            Dump profiling information to file <out>\n"
 		"  -s, --samplerate <samplerate>  Specify output samplerate in Hz\n"
 		"          Range: 44100 (default) to 192000\n"
+		"      --singlepass               For \"rendertracks\", render all tracks\n"
+		"          in a single pass, taking each track's output before the\n"
+		"          FX mixer. The master mix is rendered as well.\n"
+		"      --scheduler <scheduler>    Specify the job scheduler\n"
+		"          Possible values:\n"
+		"            - queue: one job queue shared by all threads\n"
+		"            - stealing: per-thread job queues with work stealing\n"
+		"  -t, --threads <count>          Specify the number of render threads\n"
+		"          Default: number of CPU cores\n"
 		"  -x, --oversampling <value>     Specify oversampling\n"
 		"          Possible values: 1, 2, 4, 8\n"
 		"          Default: 2\n\n",
@@ -234,6 +249,23 @@ void fileCheck( QString &file )
 	}
 }
 
+// Whether rendering \p file in OFFLINE_BUFFER_SIZE periods would change
+// it: parameters read with value() only follow automation clips and
+// controllers once per period, so only render offline without them.
+bool hasAutomation( const QString & file )
+{
+	DataFile dataFile( file );
+	QDomNodeList patterns = dataFile.elementsByTagName( "automationpattern" );
+	for( int i = 0; i < patterns.count(); ++i )
+	{
+		if( !patterns.item( i ).firstChildElement( "time" ).isNull() )
+		{
+			return true;
+		}
+	}
+	return !dataFile.elementsByTagName( "connection" ).isEmpty();
+}
+
 int usageError(const QString& message)
 {
 	qCritical().noquote() << QString("\n%1.\n\nTry \"%2 --help\" for more information.\n\n")
@@ -302,7 +334,11 @@ int main( int argc, char * * argv )
 	bool allowRoot = false;
 	bool renderLoop = false;
 	bool renderTracks = false;
+	bool renderSinglePass = false;
+	bool renderOffline = false;
 	QString fileToLoad, fileToImport, renderOut, profilerOutputFile, configFile;
+	QString midiLatencyFile;
+	QString numThreads, scheduler;
 
 	// first of two command-line parsing stages
 	for( int i = 1; i < argc; ++i )
@@ -463,6 +499,14 @@ int main( int argc, char * * argv )
 		{
 			renderLoop = true;
 		}
+		else if( arg == "--singlepass" )
+		{
+			renderSinglePass = true;
+		}
+		else if( arg == "--offline" )
+		{
+			renderOffline = true;
+		}
 		else if( arg == "--output" || arg == "-o" )
 		{
 			++i;
@@ -668,6 +712,17 @@ int main( int argc, char * * argv )
 				++i;
 			}
 		}
+		else if( arg == "--midi-latency" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No file specified for the MIDI latency log" );
+			}
+
+			midiLatencyFile = QString::fromLocal8Bit( argv[i] );
+		}
 		else if( arg == "--profile" || arg == "-p" )
 		{
 			++i;
@@ -680,6 +735,36 @@ int main( int argc, char * * argv )
 
 			profilerOutputFile = QString::fromLocal8Bit( argv[i] );
 		}
+		else if( arg == "--threads" || arg == "-t" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No number of threads specified" );
+			}
+
+			numThreads = QString( argv[i] );
+			if( numThreads.toInt() < 1 )
+			{
+				return usageError( QString( "Invalid number of threads %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--scheduler" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No scheduler specified" );
+			}
+
+			scheduler = QString( argv[i] );
+			if( scheduler != "queue" && scheduler != "stealing" )
+			{
+				return usageError( QString( "Invalid scheduler %1" ).arg( argv[i] ) );
+			}
+		}
 		else if( arg == "--config" || arg == "-c" )
 		{
 			++i;
@@ -713,6 +798,21 @@ int main( int argc, char * * argv )
 
 	ConfigManager::inst()->loadConfigFile(configFile);
 
+	if( renderOffline && !renderOut.isEmpty() && hasAutomation( fileToLoad ) )
+	{
+		printf( "The project contains automation, rendering with normal "
+			"periods to keep it sample accurate.\n" );
+		renderOffline = false;
+	}
+
+	// Options overriding the mixer configuration for this run only
+	Mixer::RunOptions mixerOptions;
+	mixerOptions.threads = numThreads.toInt();
+	mixerOptions.workStealing = scheduler.isEmpty() ? -1 :
+						scheduler == "stealing";
+	mixerOptions.offline = renderOffline;
+	Mixer::setRunOptions( mixerOptions );
+
 	// Hidden settings
 	MixHelpers::setNaNHandler( ConfigManager::inst()->value( "app",
 						"nanhandler", "1" ).toInt() );
@@ -817,7 +917,11 @@ int main( int argc, char * * argv )
 		}
 
 		// start now!
-		if ( renderTracks )
+		if ( renderTracks && renderSinglePass )
+		{
+			r->renderStems();
+		}
+		else if ( renderTracks )
 		{
 			r->renderTracks();
 		}
@@ -830,6 +934,11 @@ int main( int argc, char * * argv )
 	{
 		new GuiApplication();
 
+		if( !midiLatencyFile.isEmpty() )
+		{
+			Engine::mixer()->profiler().setMidiLatencyFile( midiLatencyFile );
+		}
+
 		// re-intialize RNG - shared libraries might have srand() or
 		// srandom() calls in their init procedure
 		srand( getpid() + time( 0 ) );
@@ -26,13 +26,18 @@
 #include <QDomElement>
 
 #include "MidiPort.h"
+#include "Engine.h"
 #include "MidiClient.h"
 #include "MidiDummy.h"
+#include "Mixer.h"
 #include "Note.h"
 #include "Song.h"
 
 static MidiDummy s_dummyClient;
 
+// more events than this arriving within one period are dropped
+static const int MaxQueuedInEvents = 256;
+
 
 
 MidiPort::MidiPort( const QString& name,
@@ -56,8 +61,11 @@ MidiPort::MidiPort( const QString& name,
 	m_outputProgramModel( 1, 1, MidiProgramCount, this, tr( "Output MIDI program" ) ),
 	m_baseVelocityModel( MidiMaxVelocity/2, 1, MidiMaxVelocity, this, tr( "Base velocity" ) ),
 	m_readableModel( false, this, tr( "Receive MIDI-events" ) ),
-	m_writableModel( false, this, tr( "Send MIDI-events" ) )
+	m_writableModel( false, this, tr( "Send MIDI-events" ) ),
+	m_inEvents( MaxQueuedInEvents ),
+	m_droppedInEvents( 0 )
 {
+	Engine::mixer()->addMidiInputPort( this );
 	m_midiClient->addPort( this );
 
 	m_readableModel.setValue( m_mode == Input || m_mode == Duplex );
@@ -97,6 +105,10 @@ MidiPort::~MidiPort()
 
 	// and finally unregister ourself
 	m_midiClient->removePort( this );
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->removeMidiInputPort( this );
+	}
 }
 
 
@@ -142,13 +154,32 @@ void MidiPort::processInEvent( const MidiEvent& event, const MidiTime& time )
 			}
 		}
 
-		m_midiEventProcessor->processInEvent( inEvent, time );
+		if( !m_inEvents.push( inEvent, time ) )
+		{
+			// the mixer didn't take the events in time, it reports
+			// them instead of the input thread
+			++m_droppedInEvents;
+		}
 	}
 }
 
 
 
 
+int MidiPort::processQueuedInEvents()
+{
+	m_inEvents.drain( [this]( const MidiEventQueue::TimedEvent& e )
+	{
+		m_midiEventProcessor->processInEvent( e.event, e.time,
+				Engine::mixer()->midiInputOffset( e.arrival ) );
+	} );
+
+	return m_droppedInEvents.exchange( 0 );
+}
+
+
+
+
 void MidiPort::processOutEvent( const MidiEvent& event, const MidiTime& time )
 {
 	// When output is enabled, route midi events if the selected channel matches
@@ -93,6 +93,8 @@ ExportProjectDialog::ExportProjectDialog( const QString & _file_name,
 		);
 	}
 	compLevelCB->setCurrentIndex(MAX_LEVEL/2);
+
+	singlePassCB->setVisible( m_multiExport );
 #ifndef LMMS_HAVE_SF_COMPLEVEL
 	// Disable this widget; the setting would be ignored by the renderer.
 	compressionWidget->setVisible(false);
@@ -199,7 +201,11 @@ void ExportProjectDialog::startExport()
 	connect( m_renderManager.get(), SIGNAL( finished() ),
 			gui->mainWindow(), SLOT( resetWindowTitle() ) );
 
-	if ( m_multiExport )
+	if ( m_multiExport && singlePassCB->isChecked() )
+	{
+		m_renderManager->renderStems();
+	}
+	else if ( m_multiExport )
 	{
 		m_renderManager->renderTracks();
 	}
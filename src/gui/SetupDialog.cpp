@@ -140,6 +140,8 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 			"mixer", "hqaudio").toInt()),
 	m_bufferSize(ConfigManager::inst()->value(
 			"mixer", "framesperaudiobuffer").toInt()),
+	m_workStealing(ConfigManager::inst()->value(
+			"mixer", "workstealing").toInt()),
 	m_workingDir(QDir::toNativeSeparators(ConfigManager::inst()->workingDir())),
 	m_vstDir(QDir::toNativeSeparators(ConfigManager::inst()->vstDir())),
 	m_ladspaDir(QDir::toNativeSeparators(ConfigManager::inst()->ladspaDir())),
@@ -554,6 +556,15 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 	connect(hqaudio, SIGNAL(toggled(bool)),
 			this, SLOT(toggleHQAudioDev(bool)));
 
+	// Work-stealing scheduler LED.
+	LedCheckBox * workStealing = new LedCheckBox(
+			tr("Use work-stealing job scheduler"), audio_w);
+	workStealing->setChecked(m_workStealing);
+	connect(workStealing, SIGNAL(toggled(bool)),
+			this, SLOT(toggleWorkStealing(bool)));
+	connect(workStealing, SIGNAL(toggled(bool)),
+			this, SLOT(showRestartWarning()));
+
 
 	// Buffer size tab.
 	TabWidget * bufferSize_tw = new TabWidget(
@@ -590,6 +601,7 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 	audio_layout->addWidget(audioiface_tw);
 	audio_layout->addWidget(as_w);
 	audio_layout->addWidget(hqaudio);
+	audio_layout->addWidget(workStealing);
 	audio_layout->addWidget(bufferSize_tw);
 	audio_layout->addStretch();
 
@@ -946,6 +958,8 @@ void SetupDialog::accept()
 					QString::number(m_hqAudioDev));
 	ConfigManager::inst()->setValue("mixer", "framesperaudiobuffer",
 					QString::number(m_bufferSize));
+	ConfigManager::inst()->setValue("mixer", "workstealing",
+					QString::number(m_workStealing));
 	ConfigManager::inst()->setValue("mixer", "mididev",
 					m_midiIfaceNames[m_midiInterfaces->currentText()]);
 	ConfigManager::inst()->setValue("midi", "midiautoassign",
@@ -1139,6 +1153,12 @@ void SetupDialog::toggleHQAudioDev(bool enabled)
 }
 
 
+void SetupDialog::toggleWorkStealing(bool enabled)
+{
+	m_workStealing = enabled;
+}
+
+
 void SetupDialog::audioInterfaceChanged(const QString & iface)
 {
 	for(AswMap::iterator it = m_audioIfaceSetupWidgets.begin();
@@ -99,6 +99,14 @@ void CPULoadWidget::updateCpuLoad()
 		m_changed = true;
 		update();
 	}
+
+	if( Engine::mixer()->hasFifoWriter() )
+	{
+		const PeriodFifo & fifo = Engine::mixer()->outputFifo();
+		setToolTip( tr( "Output buffer: %1/%2 periods, %3 underruns" ).
+				arg( fifo.fillLevel() ).arg( fifo.depth() ).
+				arg( fifo.underruns() ) );
+	}
 }
 
 
@@ -31,7 +31,9 @@
 #include "EffectRackView.h"
 #include "EffectSelectDialog.h"
 #include "EffectView.h"
+#include "Engine.h"
 #include "GroupBox.h"
+#include "Mixer.h"
 
 
 EffectRackView::EffectRackView( EffectChain* model, QWidget* parent ) :
@@ -139,7 +141,9 @@ void EffectRackView::deletePlugin( EffectView* view )
 	m_effectViews.erase( std::find( m_effectViews.begin(), m_effectViews.end(), view ) );
 	delete view;
 	fxChain()->removeEffect( e );
-	e->deleteLater();
+	// the chain doesn't own the effect anymore
+	e->setParent( NULL );
+	Engine::mixer()->retire( e );
 	update();
 }
 
@@ -145,6 +145,9 @@ int InstrumentTrack::baseNote() const
 
 InstrumentTrack::~InstrumentTrack()
 {
+	// don't get live input while being destroyed
+	Engine::mixer()->removeMidiInputPort( &m_midiPort );
+
 	// De-assign midi device
 	if (m_hasAutoMidiDev)
 	{
@@ -666,23 +669,10 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 			cur_start -= p->startPosition();
 		}
 
-		// get all notes from the given pattern...
+		// get all notes from the given pattern and skip the ones
+		// posated before start-bar
 		const NoteVector & notes = p->notes();
-		// ...and set our index to zero
-		NoteVector::ConstIterator nit = notes.begin();
-
-		// very effective algorithm for playing notes that are
-		// posated within the current sample-frame
-
-
-		if( cur_start > 0 )
-		{
-			// skip notes which are posated before start-bar
-			while( nit != notes.end() && ( *nit )->pos() < cur_start )
-			{
-				++nit;
-			}
-		}
+		NoteVector::ConstIterator nit = p->firstNoteFrom( cur_start );
 
 		Note * cur_note;
 		while( nit != notes.end() &&
@@ -269,6 +269,18 @@ Note * Pattern::noteAtStep( int _step )
 
 
 
+NoteVector::ConstIterator Pattern::firstNoteFrom( const MidiTime & pos ) const
+{
+	return std::lower_bound( m_notes.begin(), m_notes.end(), pos,
+		[]( const Note * note, const MidiTime & p )
+		{
+			return note->pos() < p;
+		} );
+}
+
+
+
+
 void Pattern::rearrangeAllNotes()
 {
 	// sort notes by start time
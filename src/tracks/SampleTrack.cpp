@@ -57,7 +57,8 @@
 SampleTCO::SampleTCO( Track * _track ) :
 	TrackContentObject( _track ),
 	m_sampleBuffer( new SampleBuffer ),
-	m_isPlaying( false )
+	m_isPlaying( false ),
+	m_savedSampleRate( 0 )
 {
 	saveJournallingState( false );
 	setSampleFile( "" );
@@ -292,8 +293,23 @@ void SampleTCO::loadSettings( const QDomElement & _this )
 	{
 		movePosition( _this.attribute( "pos" ).toInt() );
 	}
-	setSampleFile( _this.attribute( "src" ) );
-	if( sampleFile().isEmpty() && _this.hasAttribute( "data" ) )
+	const QString src = _this.attribute( "src" );
+	if( src.isEmpty() )
+	{
+		setSampleFile( src );
+	}
+	else
+	{
+		// decoded in the background, the length is restored below and
+		// the sample rate once it is loaded, see sampleLoaded()
+		m_savedSampleRate = _this.attribute( "sample_rate" ).toInt();
+		connect( m_sampleBuffer, SIGNAL( sampleUpdated() ),
+				this, SIGNAL( sampleChanged() ), Qt::UniqueConnection );
+		connect( m_sampleBuffer, SIGNAL( audioFileLoaded() ),
+				this, SLOT( sampleLoaded() ), Qt::UniqueConnection );
+		m_sampleBuffer->setAudioFileAsync( src );
+	}
+	if( src.isEmpty() && _this.hasAttribute( "data" ) )
 	{
 		m_sampleBuffer->loadFromBase64( _this.attribute( "data" ) );
 	}
@@ -301,7 +317,7 @@ void SampleTCO::loadSettings( const QDomElement & _this )
 	setMuted( _this.attribute( "muted" ).toInt() );
 	setStartTimeOffset( _this.attribute( "off" ).toInt() );
 
-	if ( _this.hasAttribute( "sample_rate" ) ) {
+	if ( src.isEmpty() && _this.hasAttribute( "sample_rate" ) ) {
 		m_sampleBuffer->setSampleRate( _this.attribute( "sample_rate" ).toInt() );
 	}
 	
@@ -315,6 +331,21 @@ void SampleTCO::loadSettings( const QDomElement & _this )
 
 
 
+void SampleTCO::sampleLoaded()
+{
+	// loading the file resets the buffer's sample rate
+	if( m_savedSampleRate > 0 )
+	{
+		m_sampleBuffer->setSampleRate( m_savedSampleRate );
+		m_savedSampleRate = 0;
+	}
+	// like setSampleFile(), stop play handles of the old data
+	playbackPositionChanged();
+}
+
+
+
+
 TrackContentObjectView * SampleTCO::createView( TrackView * _tv )
 {
 	return new SampleTCOView( this, _tv );
@@ -340,6 +371,9 @@ SampleTCOView::SampleTCOView( SampleTCO * _tco, TrackView * _tv ) :
 
 void SampleTCOView::updateSample()
 {
+	// redraw once the waveform peaks of a new buffer are there
+	connect( m_tco->m_sampleBuffer, SIGNAL( peaksUpdated() ),
+			this, SLOT( update() ), Qt::UniqueConnection );
 	update();
 	// set tooltip to filename so that user can see what sample this
 	// sample-tco contains
@@ -523,7 +557,7 @@ void SampleTCOView::mouseDoubleClickEvent( QMouseEvent * )
 
 
 
-void SampleTCOView::paintEvent( QPaintEvent * pe )
+void SampleTCOView::paintEvent( QPaintEvent * )
 {
 	QPainter painter( this );
 
@@ -576,7 +610,8 @@ void SampleTCOView::paintEvent( QPaintEvent * pe )
 	float offset =  m_tco->startTimeOffset() / ticksPerBar * pixelsPerBar();
 	QRect r = QRect( TCO_BORDER_WIDTH + offset, spacing,
 			qMax( static_cast<int>( m_tco->sampleLength() * ppb / ticksPerBar ), 1 ), rect().bottom() - 2 * spacing );
-	m_tco->m_sampleBuffer->visualize( p, r, pe->rect() );
+	// the whole pixmap is kept for later paint events
+	m_tco->m_sampleBuffer->visualize( p, r, rect() );
 
 	QString name = PathUtil::cleanName(m_tco->m_sampleBuffer->audioFile());
 	paintTextLabel(name, p);
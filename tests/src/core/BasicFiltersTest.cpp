@@ -0,0 +1,190 @@
+/*
+ * BasicFiltersTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "BasicFilters.h"
+
+class BasicFiltersTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	typedef BasicFilters<> Filter;
+
+	static const sample_rate_t SampleRate = 44100;
+	static const fpp_t Frames = 256;
+
+	static void fillSaw(std::vector<sampleFrame>& buffer, float freq)
+	{
+		for (size_t f = 0; f < buffer.size(); ++f)
+		{
+			const float phase = std::fmod(f * freq / SampleRate, 1.0f);
+			buffer[f][0] = 2.0f * phase - 1.0f;
+			buffer[f][1] = 1.0f - 2.0f * phase;
+		}
+	}
+
+	// cutoff sweep of a filter envelope, crossing many integer frequencies
+	static std::vector<float> sweep(fpp_t frames, float from, float to)
+	{
+		std::vector<float> cut(frames);
+		for (fpp_t f = 0; f < frames; ++f)
+		{
+			cut[f] = from + (to - from) * f / frames;
+		}
+		return cut;
+	}
+
+	// what InstrumentSoundShaping did per sample before process() existed
+	static void filterPerSample(Filter& filter, std::vector<sampleFrame>& buffer,
+		const float* cut, float res)
+	{
+		int oldCut = 0;
+		for (size_t f = 0; f < buffer.size(); ++f)
+		{
+			if (cut && static_cast<int>(cut[f]) != oldCut)
+			{
+				filter.calcFilterCoeffs(cut[f], res);
+				oldCut = static_cast<int>(cut[f]);
+			}
+			buffer[f][0] = filter.update(buffer[f][0], 0);
+			buffer[f][1] = filter.update(buffer[f][1], 1);
+		}
+	}
+
+	static bool same(const std::vector<sampleFrame>& a, const std::vector<sampleFrame>& b)
+	{
+		for (size_t f = 0; f < a.size(); ++f)
+		{
+			if (std::abs(a[f][0] - b[f][0]) > 1e-6f || std::abs(a[f][1] - b[f][1]) > 1e-6f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private slots:
+	void testBlockMatchesPerSample()
+	{
+		for (int type = 0; type < Filter::NumFilters; ++type)
+		{
+			Filter perSample(SampleRate);
+			Filter block(SampleRate);
+			perSample.setFilterType(type);
+			block.setFilterType(type);
+			perSample.calcFilterCoeffs(3000.0f, 2.0f);
+			block.calcFilterCoeffs(3000.0f, 2.0f);
+
+			std::vector<sampleFrame> expected(Frames);
+			fillSaw(expected, 220.0f);
+			std::vector<sampleFrame> actual = expected;
+
+			filterPerSample(perSample, expected, nullptr, 2.0f);
+			block.process(actual.data(), Frames);
+
+			QVERIFY(same(actual, expected));
+		}
+	}
+
+	void testCoefficientInterval()
+	{
+		const std::vector<float> cut = sweep(Frames, 200.0f, 8000.0f);
+
+		Filter reference(SampleRate);
+		Filter block(SampleRate);
+		reference.setFilterType(Filter::LowPass);
+		block.setFilterType(Filter::LowPass);
+		block.calcFilterCoeffs(cut[0], 1.0f);
+
+		std::vector<sampleFrame> expected(Frames);
+		fillSaw(expected, 110.0f);
+		std::vector<sampleFrame> actual = expected;
+
+		// coefficients only follow the sweep every CoeffInterval frames
+		for (fpp_t f = 0; f < Frames; ++f)
+		{
+			if (f % Filter::CoeffInterval == 0)
+			{
+				reference.calcFilterCoeffs(cut[f], 1.0f);
+			}
+			expected[f][0] = reference.update(expected[f][0], 0);
+			expected[f][1] = reference.update(expected[f][1], 1);
+		}
+		block.process(actual.data(), Frames, cut.data(), nullptr);
+
+		QVERIFY(same(actual, expected));
+	}
+
+	// A polyphonic patch with a filter envelope on every note, like a pad
+	// playing 32 voices through a 24 dB lowpass
+	void benchmarkPolyphonicPerSample()
+	{
+		const int voices = 32;
+		std::vector<std::unique_ptr<Filter>> filters;
+		for (int v = 0; v < voices; ++v)
+		{
+			filters.emplace_back(new Filter(SampleRate));
+			filters.back()->setFilterType(Filter::Lowpass_RC24);
+		}
+		const std::vector<float> cut = sweep(Frames, 8000.0f, 300.0f);
+		std::vector<sampleFrame> buffer(Frames);
+
+		QBENCHMARK
+		{
+			for (int v = 0; v < voices; ++v)
+			{
+				fillSaw(buffer, 55.0f * (v + 1));
+				filterPerSample(*filters[v], buffer, cut.data(), 1.5f);
+			}
+		}
+	}
+
+	void benchmarkPolyphonicBlock()
+	{
+		const int voices = 32;
+		std::vector<std::unique_ptr<Filter>> filters;
+		for (int v = 0; v < voices; ++v)
+		{
+			filters.emplace_back(new Filter(SampleRate));
+			filters.back()->setFilterType(Filter::Lowpass_RC24);
+		}
+		const std::vector<float> cut = sweep(Frames, 8000.0f, 300.0f);
+		std::vector<sampleFrame> buffer(Frames);
+
+		QBENCHMARK
+		{
+			for (int v = 0; v < voices; ++v)
+			{
+				fillSaw(buffer, 55.0f * (v + 1));
+				filters[v]->calcFilterCoeffs(cut[0], 1.5f);
+				filters[v]->process(buffer.data(), Frames, cut.data(), nullptr);
+			}
+		}
+	}
+} BasicFiltersTest;
+
+#include "BasicFiltersTest.moc"
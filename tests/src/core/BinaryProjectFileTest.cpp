@@ -0,0 +1,199 @@
+/*
+ * BinaryProjectFileTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <QDomDocument>
+
+#include "BinaryProjectFile.h"
+
+class BinaryProjectFileTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	// a song with a few patterns and an embedded sample
+	static QDomDocument project(int notes)
+	{
+		QDomDocument doc;
+		doc.appendChild(doc.createProcessingInstruction("xml", "version=\"1.0\""));
+		QDomElement root = doc.createElement("lmms-project");
+		root.setAttribute("type", "song");
+		doc.appendChild(root);
+		QDomElement song = doc.createElement("song");
+		root.appendChild(song);
+
+		for (int t = 0; t < 8; ++t)
+		{
+			QDomElement track = doc.createElement("track");
+			track.setAttribute("name", QString::fromUtf8("Spur \xc3\xbc %1").arg(t));
+			song.appendChild(track);
+			QDomElement pattern = doc.createElement("pattern");
+			track.appendChild(pattern);
+			for (int i = 0; i < notes; ++i)
+			{
+				QDomElement note = doc.createElement("note");
+				note.setAttribute("pos", i * 12);
+				note.setAttribute("key", 57 + i % 12);
+				note.setAttribute("vol", 100);
+				note.setAttribute("len", 12);
+				pattern.appendChild(note);
+			}
+		}
+
+		QByteArray sample(256 * 1024, 0);
+		for (int i = 0; i < sample.size(); ++i)
+		{
+			sample[i] = static_cast<char>(i * 7 + i / 13);
+		}
+		QDomElement tco = doc.createElement("sampletco");
+		tco.setAttribute("data", QString::fromLatin1(sample.toBase64()));
+		song.appendChild(tco);
+
+		QDomElement comment = doc.createElement("projectnotes");
+		comment.appendChild(doc.createCDATASection("<b>notes</b>"));
+		song.appendChild(comment);
+
+		return doc;
+	}
+
+	static bool sameTree(const QDomNode& a, const QDomNode& b)
+	{
+		if (a.nodeType() != b.nodeType() || a.nodeName() != b.nodeName()
+			|| a.nodeValue() != b.nodeValue())
+		{
+			return false;
+		}
+		const QDomNamedNodeMap attrs = a.attributes();
+		if (attrs.count() != b.attributes().count())
+		{
+			return false;
+		}
+		for (int i = 0; i < attrs.count(); ++i)
+		{
+			const QDomAttr attr = attrs.item(i).toAttr();
+			if (b.toElement().attribute(attr.name(), "\x01") != attr.value())
+			{
+				return false;
+			}
+		}
+		QDomNode ca = a.firstChild();
+		QDomNode cb = b.firstChild();
+		for (; !ca.isNull() && !cb.isNull(); ca = ca.nextSibling(), cb = cb.nextSibling())
+		{
+			if (!sameTree(ca, cb))
+			{
+				return false;
+			}
+		}
+		return ca.isNull() && cb.isNull();
+	}
+
+private slots:
+	void testRoundTrip()
+	{
+		const QDomDocument doc = project(50);
+		const QByteArray data = BinaryProjectFile::write(doc);
+		QVERIFY(BinaryProjectFile::isBinary(data));
+
+		BinaryProjectFile file(data);
+		QVERIFY(file.isValid());
+		// the sample is stored raw in its own section
+		QCOMPARE(file.sectionCount(), 2);
+		QCOMPARE(file.sectionType(1), BinaryProjectFile::BlobSection);
+		QCOMPARE(file.section(1).size(), 256 * 1024);
+
+		QDomDocument restored;
+		QVERIFY(file.read(restored));
+		QVERIFY(sameTree(doc, restored));
+
+		// and back to XML
+		QDomDocument xml;
+		QVERIFY(xml.setContent(restored.toString()));
+		QVERIFY(sameTree(doc.documentElement(), xml.documentElement()));
+	}
+
+	void testNonCanonicalBase64()
+	{
+		QDomDocument doc;
+		QDomElement e = doc.createElement("vst");
+		// line breaks are dropped by decoding, so this has to stay text
+		const QString chunk = QString("QUFB\n").repeated(2000);
+		e.setAttribute("chunk", chunk);
+		doc.appendChild(e);
+
+		BinaryProjectFile file(BinaryProjectFile::write(doc, false));
+		QCOMPARE(file.sectionCount(), 1);
+		QDomDocument restored;
+		QVERIFY(file.read(restored));
+		QCOMPARE(restored.documentElement().attribute("chunk"), chunk);
+	}
+
+	void testCompressedBlob()
+	{
+		QDomDocument doc;
+		QDomElement e = doc.createElement("vst");
+		// plugin states are often mostly zeros
+		const QByteArray state(64 * 1024, 0);
+		e.setAttribute("chunk", QString::fromLatin1(state.toBase64()));
+		doc.appendChild(e);
+
+		const QByteArray data = BinaryProjectFile::write(doc);
+		QVERIFY(data.size() < state.size() / 4);
+		BinaryProjectFile file(data);
+		QCOMPARE(file.sectionCount(), 2);
+		QCOMPARE(file.section(1), state);
+		QDomDocument restored;
+		QVERIFY(file.read(restored));
+		QVERIFY(sameTree(doc, restored));
+	}
+
+	void testDamagedData()
+	{
+		QByteArray data = BinaryProjectFile::write(project(2));
+		QDomDocument doc;
+		QVERIFY(!BinaryProjectFile(data.left(40)).read(doc));
+		QVERIFY(!BinaryProjectFile(QByteArray("LMMB")).isValid());
+		QVERIFY(!BinaryProjectFile(QByteArray("<?xml")).isValid());
+	}
+
+	void benchmarkLoadXml()
+	{
+		const QString xml = project(2000).toString();
+		QBENCHMARK
+		{
+			QDomDocument doc;
+			doc.setContent(xml);
+		}
+	}
+
+	void benchmarkLoadBinary()
+	{
+		const QByteArray data = BinaryProjectFile::write(project(2000));
+		QBENCHMARK
+		{
+			QDomDocument doc;
+			BinaryProjectFile(data).read(doc);
+		}
+	}
+} BinaryProjectFileTest;
+
+#include "BinaryProjectFileTest.moc"
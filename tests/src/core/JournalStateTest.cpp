@@ -0,0 +1,115 @@
+/*
+ * JournalStateTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <QDomDocument>
+
+#include "JournalState.h"
+
+class JournalStateTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	static QDomElement pattern(QDomDocument& doc, int notes, int moved = -1)
+	{
+		QDomElement p = doc.createElement("pattern");
+		p.setAttribute("name", "Pattern 1");
+		p.setAttribute("pos", 0);
+		for (int i = 0; i < notes; ++i)
+		{
+			QDomElement note = doc.createElement("note");
+			note.setAttribute("pos", i == moved ? notes * 12 : i * 12);
+			note.setAttribute("key", 57 + i % 12);
+			note.setAttribute("len", 12);
+			p.appendChild(note);
+		}
+		doc.appendChild(p);
+		return p;
+	}
+
+	static QString toString(const JournalState& state)
+	{
+		QDomDocument doc;
+		state.toElement(doc, doc);
+		return doc.toString();
+	}
+
+private slots:
+	void testRoundTrip()
+	{
+		QDomDocument doc;
+		QDomElement p = pattern(doc, 3);
+		QDomElement text = doc.createElement("comment");
+		text.appendChild(doc.createTextNode(QString::fromUtf8("caf\xc3\xa9 & more")));
+		p.appendChild(text);
+		QDomElement data = doc.createElement("data");
+		data.appendChild(doc.createCDATASection("<raw>"));
+		p.appendChild(data);
+
+		const JournalState state(p);
+		QDomDocument restored;
+		QDomElement e = state.toElement(restored, restored);
+		QCOMPARE(e.tagName(), QString("pattern"));
+		QCOMPARE(e.elementsByTagName("note").count(), 3);
+		QCOMPARE(e.firstChildElement("comment").text(), QString::fromUtf8("caf\xc3\xa9 & more"));
+		QVERIFY(e.firstChildElement("data").firstChild().isCDATASection());
+		QCOMPARE(e.attribute("name"), QString("Pattern 1"));
+		QCOMPARE(e.elementsByTagName("note").item(2).toElement().attribute("key"), QString("59"));
+	}
+
+	void testDelta()
+	{
+		QDomDocument before, after;
+		const JournalState from(pattern(before, 2000));
+		const JournalState to(pattern(after, 2000, 17));
+
+		// moving one note only stores that note
+		const JournalState::Delta delta = JournalState::diff(from, to);
+		QVERIFY(delta.memoryUsage() < from.memoryUsage() / 100);
+
+		JournalState state = from;
+		state.apply(delta);
+		QVERIFY(state == to);
+		QCOMPARE(toString(state), toString(to));
+
+		state.apply(JournalState::diff(to, from));
+		QVERIFY(state == from);
+	}
+
+	void testUnrelatedStates()
+	{
+		QDomDocument a, b;
+		const JournalState from(pattern(a, 5));
+		const JournalState to(pattern(b, 0));
+
+		JournalState state = from;
+		state.apply(JournalState::diff(from, to));
+		QVERIFY(state == to);
+
+		state = JournalState();
+		state.apply(JournalState::diff(JournalState(), from));
+		QVERIFY(state == from);
+	}
+} JournalStateTest;
+
+#include "JournalStateTest.moc"
@@ -0,0 +1,133 @@
+/*
+ * LadspaPluginCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+#include "QTestSuite.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+#include "LadspaPluginCache.h"
+
+class LadspaPluginCacheTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	static QVector<LadspaPluginCache::Plugin> plugins()
+	{
+		LadspaPluginCache::Plugin plugin;
+		plugin.label = "amp_stereo";
+		plugin.index = 1;
+		plugin.name = "Stereo Amplifier";
+		plugin.maker = "Someone";
+		plugin.copyright = "GPL";
+		plugin.properties = 4;
+		plugin.inputChannels = 2;
+		plugin.outputChannels = 2;
+		return QVector<LadspaPluginCache::Plugin>() << plugin;
+	}
+
+	static void writeFile(const QString& path, const QByteArray& data)
+	{
+		QFile file(path);
+		QVERIFY(file.open(QIODevice::WriteOnly));
+		file.write(data);
+	}
+
+private slots:
+	void testSaveLoad()
+	{
+		QTemporaryDir dir;
+		const QString index = dir.path() + "/ladspa.index";
+		const QString library = dir.path() + "/amp.so";
+		writeFile(library, "library");
+
+		LadspaPluginCache cache(index);
+		QVector<LadspaPluginCache::Plugin> found;
+		QVERIFY(!cache.lookup(QFileInfo(library), found));
+		cache.insert(QFileInfo(library), plugins());
+		QVERIFY(cache.save());
+
+		LadspaPluginCache loaded(index);
+		QVERIFY(loaded.lookup(QFileInfo(library), found));
+		QCOMPARE(found.size(), 1);
+		QCOMPARE(found[0].label, QString("amp_stereo"));
+		QCOMPARE(found[0].index, quint32(1));
+		QCOMPARE(found[0].name, QString("Stereo Amplifier"));
+		QCOMPARE(found[0].properties, qint32(4));
+		QCOMPARE(found[0].outputChannels, quint16(2));
+	}
+
+	void testChangedLibrary()
+	{
+		QTemporaryDir dir;
+		const QString index = dir.path() + "/ladspa.index";
+		const QString library = dir.path() + "/amp.so";
+		writeFile(library, "library");
+
+		LadspaPluginCache cache(index);
+		cache.insert(QFileInfo(library), plugins());
+		QVERIFY(cache.save());
+
+		// a new version of the library with another size
+		writeFile(library, "updated library");
+		QVector<LadspaPluginCache::Plugin> found;
+		QVERIFY(!LadspaPluginCache(index).lookup(QFileInfo(library), found));
+	}
+
+	void testRemovedLibrary()
+	{
+		QTemporaryDir dir;
+		const QString index = dir.path() + "/ladspa.index";
+		const QString kept = dir.path() + "/amp.so";
+		const QString removed = dir.path() + "/delay.so";
+		writeFile(kept, "library");
+		writeFile(removed, "library");
+
+		LadspaPluginCache cache(index);
+		cache.insert(QFileInfo(kept), plugins());
+		cache.insert(QFileInfo(removed), QVector<LadspaPluginCache::Plugin>());
+		QVERIFY(cache.save());
+
+		// only the first library is found on the next start
+		QVector<LadspaPluginCache::Plugin> found;
+		LadspaPluginCache next(index);
+		QVERIFY(next.lookup(QFileInfo(kept), found));
+		QVERIFY(next.save());
+
+		LadspaPluginCache last(index);
+		QVERIFY(last.lookup(QFileInfo(kept), found));
+		QVERIFY(!last.lookup(QFileInfo(removed), found));
+	}
+
+	void testDamagedIndex()
+	{
+		QTemporaryDir dir;
+		const QString index = dir.path() + "/ladspa.index";
+		const QString library = dir.path() + "/amp.so";
+		writeFile(library, "library");
+		writeFile(index, "garbage");
+
+		QVector<LadspaPluginCache::Plugin> found;
+		QVERIFY(!LadspaPluginCache(index).lookup(QFileInfo(library), found));
+	}
+} LadspaPluginCacheTest;
+
+#include "LadspaPluginCacheTest.moc"
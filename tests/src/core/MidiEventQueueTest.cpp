@@ -0,0 +1,111 @@
+/*
+ * MidiEventQueueTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <thread>
+
+#include "MidiEventQueue.h"
+
+class MidiEventQueueTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void testOrder()
+	{
+		MidiEventQueue queue(64);
+		const qint64 before = MidiEventQueue::now();
+		for (int key = 0; key < 10; ++key)
+		{
+			QVERIFY(queue.push(MidiEvent(MidiNoteOn, 0, key, 100), MidiTime(key)));
+		}
+
+		int next = 0;
+		qint64 last = before;
+		queue.drain([&](const MidiEventQueue::TimedEvent& e)
+		{
+			QCOMPARE(e.event.key(), next);
+			QCOMPARE(e.time.getTicks(), next);
+			QVERIFY(e.arrival >= last);
+			last = e.arrival;
+			++next;
+		});
+		QCOMPARE(next, 10);
+
+		// drained events are gone
+		queue.drain([&](const MidiEventQueue::TimedEvent&) { ++next; });
+		QCOMPARE(next, 10);
+	}
+
+	void testFull()
+	{
+		MidiEventQueue queue(32);
+		int pushed = 0;
+		while (queue.push(MidiEvent(MidiNoteOff, 0, 60, 0), MidiTime()) && pushed < 100)
+		{
+			++pushed;
+		}
+		QCOMPARE(pushed, 32);
+
+		// the space is available again after draining
+		queue.drain([](const MidiEventQueue::TimedEvent&) {});
+		QVERIFY(queue.push(MidiEvent(MidiNoteOn, 0, 60, 100), MidiTime()));
+	}
+
+	void testConcurrentWriters()
+	{
+		const int perThread = 5000;
+		MidiEventQueue queue(256);
+		int received[2] = { 0, 0 };
+		bool ordered = true;
+
+		auto writer = [&queue](int channel)
+		{
+			for (int i = 0; i < perThread;)
+			{
+				if (queue.push(MidiEvent(MidiControlChange, channel, 7, i % 128), MidiTime(i)))
+				{
+					++i;
+				}
+			}
+		};
+		std::thread a(writer, 0);
+		std::thread b(writer, 1);
+
+		while (received[0] < perThread || received[1] < perThread)
+		{
+			queue.drain([&](const MidiEventQueue::TimedEvent& e)
+			{
+				int& count = received[e.event.channel()];
+				// each writer's events keep their order
+				ordered = ordered && e.time.getTicks() == count;
+				++count;
+			});
+		}
+		a.join();
+		b.join();
+
+		QVERIFY(ordered);
+	}
+} MidiEventQueueTest;
+
+#include "MidiEventQueueTest.moc"
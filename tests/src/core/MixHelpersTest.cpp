@@ -0,0 +1,309 @@
+/*
+ * MixHelpersTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "MixHelpers.h"
+#include "ValueBuffer.h"
+
+// The mixing functions use vector code where available. They are checked
+// against plain per-frame loops, which must give bit-identical results.
+// An odd number of frames makes sure the scalar tail is covered as well.
+const int Frames = 67;
+
+class MixHelpersTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	typedef std::vector<sampleFrame> Buffer;
+
+	static float randomSample(unsigned int& seed, float range)
+	{
+		seed = seed * 1103515245 + 12345;
+		return (static_cast<int>((seed >> 8) % 20001) - 10000) / 10000.0f * range;
+	}
+
+	static Buffer randomBuffer(unsigned int seed, float range = 1.0f)
+	{
+		Buffer buf(Frames);
+		for (sampleFrame& frame : buf)
+		{
+			frame[0] = randomSample(seed, range);
+			frame[1] = randomSample(seed, range);
+		}
+		return buf;
+	}
+
+	static ValueBuffer randomValues(unsigned int seed, float range)
+	{
+		ValueBuffer values(Frames);
+		for (int i = 0; i < Frames; ++i)
+		{
+			values[i] = randomSample(seed, range);
+		}
+		return values;
+	}
+
+	static bool identical(const Buffer& a, const Buffer& b)
+	{
+		return memcmp(a.data(), b.data(), Frames * sizeof(sampleFrame)) == 0;
+	}
+
+private slots:
+	void testAdd()
+	{
+		const Buffer src = randomBuffer(1);
+		Buffer dst = randomBuffer(2);
+		Buffer expected = dst;
+
+		MixHelpers::add(dst.data(), src.data(), Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][0];
+			expected[f][1] += src[f][1];
+		}
+		QVERIFY(identical(dst, expected));
+	}
+
+	void testAddMultiplied()
+	{
+		const Buffer src = randomBuffer(3);
+		const Buffer orig = randomBuffer(4);
+		const float coeff = 0.73f;
+
+		Buffer dst = orig;
+		Buffer expected = orig;
+		MixHelpers::addMultiplied(dst.data(), src.data(), coeff, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][0] * coeff;
+			expected[f][1] += src[f][1] * coeff;
+		}
+		QVERIFY(identical(dst, expected));
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::addSwappedMultiplied(dst.data(), src.data(), coeff, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][1] * coeff;
+			expected[f][1] += src[f][0] * coeff;
+		}
+		QVERIFY(identical(dst, expected));
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::addMultipliedStereo(dst.data(), src.data(), coeff, 0.31f, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][0] * coeff;
+			expected[f][1] += src[f][1] * 0.31f;
+		}
+		QVERIFY(identical(dst, expected));
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::multiplyAndAddMultiplied(dst.data(), src.data(), 0.5f, coeff, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] = expected[f][0] * 0.5f + src[f][0] * coeff;
+			expected[f][1] = expected[f][1] * 0.5f + src[f][1] * coeff;
+		}
+		QVERIFY(identical(dst, expected));
+	}
+
+	void testMultiplyAndAddMultipliedJoined()
+	{
+		const ValueBuffer left = randomValues(5, 1.0f);
+		const ValueBuffer right = randomValues(6, 1.0f);
+		Buffer dst = randomBuffer(7);
+		Buffer expected = dst;
+
+		MixHelpers::multiplyAndAddMultipliedJoined(dst.data(),
+				left.values(), right.values(), 0.25f, 0.8f, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] = expected[f][0] * 0.25f + left[f] * 0.8f;
+			expected[f][1] = expected[f][1] * 0.25f + right[f] * 0.8f;
+		}
+		QVERIFY(identical(dst, expected));
+	}
+
+	void testAddMultipliedByBuffers()
+	{
+		Buffer src = randomBuffer(8);
+		const Buffer orig = randomBuffer(9);
+		ValueBuffer coeffs1 = randomValues(10, 2.0f);
+		ValueBuffer coeffs2 = randomValues(11, 2.0f);
+
+		Buffer dst = orig;
+		Buffer expected = orig;
+		MixHelpers::addMultipliedByBuffer(dst.data(), src.data(), 0.6f, &coeffs1, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][0] * 0.6f * coeffs1[f];
+			expected[f][1] += src[f][1] * 0.6f * coeffs1[f];
+		}
+		QVERIFY(identical(dst, expected));
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::addMultipliedByBuffers(dst.data(), src.data(), &coeffs1, &coeffs2, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			expected[f][0] += src[f][0] * coeffs1[f] * coeffs2[f];
+			expected[f][1] += src[f][1] * coeffs1[f] * coeffs2[f];
+		}
+		QVERIFY(identical(dst, expected));
+
+		// sanitized versions skip infs and nans in the source
+		const bool useNaNHandler = MixHelpers::useNaNHandler();
+		MixHelpers::setNaNHandler(true);
+		src[3][0] = std::numeric_limits<float>::infinity();
+		src[8][1] = -std::numeric_limits<float>::infinity();
+		src[Frames - 1][1] = std::numeric_limits<float>::quiet_NaN();
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::addSanitizedMultipliedByBuffers(dst.data(), src.data(), &coeffs1, &coeffs2, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			for (int c = 0; c < 2; ++c)
+			{
+				if (std::isfinite(src[f][c]))
+				{
+					expected[f][c] += src[f][c] * coeffs1[f] * coeffs2[f];
+				}
+			}
+		}
+		QVERIFY(identical(dst, expected));
+
+		dst = orig;
+		expected = orig;
+		MixHelpers::addSanitizedMultiplied(dst.data(), src.data(), 0.6f, Frames);
+		for (int f = 0; f < Frames; ++f)
+		{
+			for (int c = 0; c < 2; ++c)
+			{
+				if (std::isfinite(src[f][c]))
+				{
+					expected[f][c] += src[f][c] * 0.6f;
+				}
+			}
+		}
+		QVERIFY(identical(dst, expected));
+
+		MixHelpers::setNaNHandler(useNaNHandler);
+	}
+
+	void testIsSilent()
+	{
+		Buffer buf(Frames);
+		for (sampleFrame& frame : buf)
+		{
+			frame[0] = frame[1] = 0.00000001f;
+		}
+		QVERIFY(MixHelpers::isSilent(buf.data(), Frames));
+
+		// one loud sample anywhere, including the scalar tail
+		for (int f : { 0, 5, Frames - 1 })
+		{
+			Buffer loud = buf;
+			loud[f][1] = -0.001f;
+			QVERIFY(!MixHelpers::isSilent(loud.data(), Frames));
+		}
+	}
+
+	void testSanitize()
+	{
+		const bool useNaNHandler = MixHelpers::useNaNHandler();
+		MixHelpers::setNaNHandler(true);
+
+		Buffer buf = randomBuffer(12, 2000.0f);
+		Buffer expected = buf;
+		QVERIFY(!MixHelpers::sanitize(buf.data(), Frames));
+		for (sampleFrame& frame : expected)
+		{
+			frame[0] = qBound(-1000.0f, frame[0], 1000.0f);
+			frame[1] = qBound(-1000.0f, frame[1], 1000.0f);
+		}
+		QVERIFY(identical(buf, expected));
+
+		buf[20][1] = std::numeric_limits<float>::quiet_NaN();
+		QVERIFY(MixHelpers::sanitize(buf.data(), Frames));
+		QVERIFY(identical(buf, Buffer(Frames, sampleFrame{ 0.0f, 0.0f })));
+
+		MixHelpers::setNaNHandler(useNaNHandler);
+	}
+
+	void testPeakValues()
+	{
+		Buffer buf = randomBuffer(13);
+		buf[10][0] = -1.5f;
+		buf[Frames - 1][1] = 1.25f;
+		buf[4][1] = std::numeric_limits<float>::quiet_NaN();
+
+		sample_t left, right;
+		MixHelpers::getPeakValues(buf.data(), Frames, left, right);
+		QCOMPARE(left, 1.5f);
+		QCOMPARE(right, 1.25f);
+	}
+
+	void testVolumePanning()
+	{
+		const Buffer orig = randomBuffer(14);
+		// volume and panning in percent, as stored in the models
+		ValueBuffer volumes = randomValues(15, 200.0f);
+		ValueBuffer pannings = randomValues(16, 100.0f);
+		pannings[0] = 0.0f;
+		pannings[1] = -100.0f;
+		pannings[2] = 100.0f;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			const float* volBuf = i & 1 ? volumes.values() : NULL;
+			const float* panBuf = i & 2 ? pannings.values() : NULL;
+			const float volume = 80.0f;
+			const float panning = -30.0f;
+
+			Buffer dst = orig;
+			Buffer expected = orig;
+			MixHelpers::multiplyByVolumePanning(dst.data(),
+					volBuf, volume, panBuf, panning, Frames);
+			for (int f = 0; f < Frames; ++f)
+			{
+				const float v = (volBuf ? volBuf[f] : volume) * 0.01f;
+				const float p = (panBuf ? panBuf[f] : panning) * 0.01f;
+				expected[f][0] *= (p <= 0 ? 1.0f : 1.0f - p) * v;
+				expected[f][1] *= (p >= 0 ? 1.0f : 1.0f + p) * v;
+			}
+			QVERIFY(identical(dst, expected));
+		}
+	}
+} MixHelpersTest;
+
+#include "MixHelpersTest.moc"
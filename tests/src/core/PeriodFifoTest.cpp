@@ -0,0 +1,107 @@
+/*
+ * PeriodFifoTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <thread>
+
+#include "PeriodFifo.h"
+
+class PeriodFifoTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	static const fpp_t Frames = 64;
+
+	static void fill(surroundSampleFrame* buffer, int period)
+	{
+		for (fpp_t f = 0; f < Frames; ++f)
+		{
+			buffer[f].fill(static_cast<sample_t>(period));
+		}
+	}
+
+private slots:
+	void testOrder()
+	{
+		PeriodFifo fifo(3, Frames);
+		surroundSampleFrame buffer[Frames];
+
+		for (int i = 0; i < 3; ++i)
+		{
+			fill(buffer, i);
+			fifo.write(buffer);
+		}
+		QCOMPARE(fifo.fillLevel(), 3);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const surroundSampleFrame* b = fifo.read();
+			QVERIFY(b != nullptr);
+			QCOMPARE(b[Frames - 1][0], static_cast<sample_t>(i));
+		}
+		QCOMPARE(fifo.fillLevel(), 0);
+
+		fifo.write(nullptr);
+		QVERIFY(fifo.read() == nullptr);
+		QVERIFY(fifo.read() == nullptr);
+		fifo.waitUntilRead();
+		QCOMPARE(fifo.underruns(), 0);
+	}
+
+	void testThreads()
+	{
+		const int periods = 20000;
+		PeriodFifo fifo(2, Frames);
+
+		for (int run = 0; run < 2; ++run)
+		{
+			fifo.reset();
+			std::thread writer([&fifo]()
+			{
+				surroundSampleFrame buffer[Frames];
+				for (int i = 0; i < periods; ++i)
+				{
+					fill(buffer, i);
+					fifo.write(buffer);
+				}
+				fifo.write(nullptr);
+				fifo.waitUntilRead();
+			});
+
+			int read = 0;
+			bool ordered = true;
+			while (const surroundSampleFrame* b = fifo.read())
+			{
+				ordered = ordered && b[0][0] == static_cast<sample_t>(read)
+						&& b[Frames - 1][1] == static_cast<sample_t>(read);
+				++read;
+			}
+			writer.join();
+
+			QVERIFY(ordered);
+			QCOMPARE(read, periods);
+		}
+	}
+} PeriodFifoTest;
+
+#include "PeriodFifoTest.moc"
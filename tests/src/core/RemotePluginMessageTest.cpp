@@ -0,0 +1,111 @@
+/*
+ * RemotePluginMessageTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <vector>
+
+#include "RemotePlugin.h"
+
+class RemotePluginMessageTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	typedef RemotePluginBase::message Message;
+
+	// Pass a message through its wire format
+	static Message roundTrip(const Message& m)
+	{
+		std::vector<char> buf;
+		m.serialize(buf);
+
+		int32_t header[3];
+		memcpy(header, buf.data(), sizeof(header));
+
+		Message received;
+		received.id = header[0];
+		received.deserialize(buf.data() + sizeof(header), header[2], header[1]);
+		return received;
+	}
+
+	// A batch of parameter changes as sent when automating a VST
+	static Message parameterBatch(int count)
+	{
+		Message m(IdUserBase);
+		m.addInt(count);
+		for (int i = 0; i < count; ++i)
+		{
+			m.addInt(i).addFloat(i / float(count));
+		}
+		return m;
+	}
+
+private slots:
+	void testRoundTrip()
+	{
+		Message m(IdMidiEvent);
+		m.addInt(-123456).addFloat(0.25f).addString("some text").addString("");
+
+		const Message r = roundTrip(m);
+		QCOMPARE(r.id, int(IdMidiEvent));
+		QCOMPARE(r.fieldCount(), 4);
+		QCOMPARE(r.getInt(0), -123456);
+		QCOMPARE(r.getFloat(1), 0.25f);
+		QCOMPARE(r.getString(2), std::string("some text"));
+		QCOMPARE(r.getString(3), std::string());
+	}
+
+	void testTextFallback()
+	{
+		// numbers sent as text are still understood, and binary numbers
+		// can be read as text
+		Message m(IdMidiEvent);
+		m.addString("42").addString("0.5").addInt(7);
+
+		const Message r = roundTrip(m);
+		QCOMPARE(r.getInt(0), 42);
+		QCOMPARE(r.getFloat(1), 0.5f);
+		QCOMPARE(r.getString(2), std::string("7"));
+	}
+
+	void testMalformed()
+	{
+		std::vector<char> buf;
+		parameterBatch(4).serialize(buf);
+
+		Message r;
+		QVERIFY(!r.deserialize(buf.data() + 12, buf.size() - 13, 9));
+	}
+
+	void benchmarkParameterBatch()
+	{
+		int messages = 0;
+		QBENCHMARK
+		{
+			const Message r = roundTrip(parameterBatch(64));
+			messages += r.getInt(0) > 0;
+		}
+		QVERIFY(messages > 0);
+	}
+} RemotePluginMessageTest;
+
+#include "RemotePluginMessageTest.moc"
@@ -0,0 +1,117 @@
+/*
+ * SamplePeaksTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <QtCore/QTemporaryDir>
+
+#include <cmath>
+#include <vector>
+
+#include "SamplePeaks.h"
+
+class SamplePeaksTest : QTestSuite
+{
+	Q_OBJECT
+private:
+	// the last block is shorter than the others
+	static const f_cnt_t Frames = 100000;
+
+	static std::vector<sampleFrame> sine()
+	{
+		std::vector<sampleFrame> data(Frames);
+		for (f_cnt_t f = 0; f < Frames; ++f)
+		{
+			// getting louder, so each block has different peaks
+			const float amp = float(f) / Frames;
+			data[f][0] = amp * sinf(f * 0.01f);
+			data[f][1] = -0.5f * data[f][0];
+		}
+		return data;
+	}
+
+private slots:
+	void testLevels()
+	{
+		const std::vector<sampleFrame> data = sine();
+		SamplePeaks peaks(data.data(), Frames);
+
+		QCOMPARE(peaks.frames(), f_cnt_t(Frames));
+		QCOMPARE(peaks.level(peaks.levels() - 1).size(), 1);
+		for (int level = 1; level < peaks.levels(); ++level)
+		{
+			QCOMPARE(peaks.blockFrames(level),
+				peaks.blockFrames(level - 1) * SamplePeaks::LevelFactor);
+		}
+
+		QCOMPARE(peaks.levelFor(1), 0);
+		QCOMPARE(peaks.levelFor(SamplePeaks::BlockFrames * 5), 1);
+		QCOMPARE(peaks.levelFor(1e9), peaks.levels() - 1);
+
+		// the top level describes the whole sample
+		const SamplePeaks::Peak all = SamplePeaks::fromFrames(data.data(), 0, Frames);
+		const SamplePeaks::Peak top = peaks.level(peaks.levels() - 1)[0];
+		QCOMPARE(top.min, all.min);
+		QCOMPARE(top.max, all.max);
+		QVERIFY(std::abs(top.rms - all.rms) < 1e-3f);
+	}
+
+	void testRange()
+	{
+		const std::vector<sampleFrame> data = sine();
+		SamplePeaks peaks(data.data(), Frames);
+
+		const f_cnt_t block = peaks.blockFrames(2);
+		const SamplePeaks::Peak range = peaks.range(2, 3 * block, 7 * block);
+		const SamplePeaks::Peak exact =
+				SamplePeaks::fromFrames(data.data(), 3 * block, 7 * block);
+		QCOMPARE(range.min, exact.min);
+		QCOMPARE(range.max, exact.max);
+		QVERIFY(std::abs(range.rms - exact.rms) < 1e-4f);
+	}
+
+	void testSaveLoad()
+	{
+		const std::vector<sampleFrame> data = sine();
+		SamplePeaks peaks(data.data(), Frames);
+
+		QTemporaryDir dir;
+		const QString path = dir.path() + "/sample.peaks";
+		QVERIFY(peaks.save(path));
+
+		auto loaded = SamplePeaks::load(path, Frames);
+		QVERIFY(loaded != nullptr);
+		QCOMPARE(loaded->levels(), peaks.levels());
+		for (int level = 0; level < peaks.levels(); ++level)
+		{
+			QCOMPARE(loaded->level(level).size(), peaks.level(level).size());
+			QCOMPARE(loaded->level(level).last().max,
+					peaks.level(level).last().max);
+		}
+
+		// peaks of another version of the file
+		QVERIFY(SamplePeaks::load(path, Frames - 1) == nullptr);
+		QVERIFY(SamplePeaks::load(dir.path() + "/missing.peaks", Frames) == nullptr);
+	}
+} SamplePeaksTest;
+
+#include "SamplePeaksTest.moc"
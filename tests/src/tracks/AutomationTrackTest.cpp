@@ -26,6 +26,8 @@
 
 #include "QCoreApplication"
 
+#include <cmath>
+
 #include "AutomationPattern.h"
 #include "AutomationTrack.h"
 #include "BBTrack.h"
@@ -41,6 +43,75 @@
 class AutomationTrackTest : QTestSuite
 {
 	Q_OBJECT
+private:
+	//! AutomationPattern::valueAt() as it was before the curves got
+	//! compiled into segments
+	static float referenceValueAt(const AutomationPattern& p, int time)
+	{
+		const AutomationPattern::timeMap& map = p.getTimeMap();
+		if (map.isEmpty()) { return 0; }
+		if (map.contains(time)) { return map[time]; }
+
+		auto v = map.lowerBound(time);
+		if (v == map.begin()) { return 0; }
+		if (v == map.end()) { return (v - 1).value(); }
+		--v;
+
+		const int offset = time - v.key();
+		switch (p.progressionType())
+		{
+		case AutomationPattern::DiscreteProgression:
+			return v.value();
+		case AutomationPattern::LinearProgression:
+			return v.value() + offset *
+				((v + 1).value() - v.value()) / ((v + 1).key() - v.key());
+		default:
+		{
+			const int numValues = (v + 1).key() - v.key();
+			const float t = float(offset) / numValues;
+			const float m1 = p.getTangents()[v.key()] * numValues * p.getTension();
+			const float m2 = p.getTangents()[(v + 1).key()] * numValues * p.getTension();
+			return (2*pow(t,3) - 3*pow(t,2) + 1) * v.value()
+				+ (pow(t,3) - 2*pow(t,2) + t) * m1
+				+ (-2*pow(t,3) + 3*pow(t,2)) * (v + 1).value()
+				+ (pow(t,3) - pow(t,2)) * m2;
+		}
+		}
+	}
+
+	static void compareToReference(const AutomationPattern& p)
+	{
+		for (int time = -10; time <= 250; ++time)
+		{
+			QVERIFY2(qAbs(p.valueAt(time) - referenceValueAt(p, time)) < 1e-5f,
+				qPrintable(QString("at tick %1").arg(time)));
+		}
+	}
+
+	static void testReferenceAfterEdits(AutomationPattern::ProgressionTypes type)
+	{
+		AutomationPattern p(nullptr);
+		p.setProgressionType(type);
+		p.putValue(0, 0.2, false);
+		p.putValue(48, 0.9, false);
+		p.putValue(100, 0.4, false);
+		p.putValue(200, 0.6, false);
+		compareToReference(p);
+
+		// every edit has to be seen by the next valueAt()
+		p.putValue(150, 0.1, false);
+		compareToReference(p);
+		p.removeValue(48);
+		compareToReference(p);
+		p.setTension("0.5");
+		compareToReference(p);
+		p.setDragValue(100, 0.8, false);
+		p.applyDragValue();
+		compareToReference(p);
+		p.clear();
+		compareToReference(p);
+	}
+
 private slots:
 	void initTestCase()
 	{
@@ -74,6 +145,33 @@ private slots:
 		QCOMPARE(p.valueAt(150), 1.0f);
 	}
 
+	void testPatternDiscreteAfterEdits()
+	{
+		testReferenceAfterEdits(AutomationPattern::DiscreteProgression);
+	}
+
+	void testPatternLinearAfterEdits()
+	{
+		testReferenceAfterEdits(AutomationPattern::LinearProgression);
+	}
+
+	void testPatternCubicAfterEdits()
+	{
+		testReferenceAfterEdits(AutomationPattern::CubicHermiteProgression);
+	}
+
+	void testProgressionChange()
+	{
+		AutomationPattern p(nullptr);
+		p.setProgressionType(AutomationPattern::DiscreteProgression);
+		p.putValue(0, 0.0, false);
+		p.putValue(100, 1.0, false);
+		QCOMPARE(p.valueAt(50), 0.0f);
+
+		p.setProgressionType(AutomationPattern::LinearProgression);
+		QCOMPARE(p.valueAt(50), 0.5f);
+	}
+
 	void testPatterns()
 	{
 		FloatModel model;
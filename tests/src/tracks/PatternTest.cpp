@@ -0,0 +1,93 @@
+/*
+ * PatternTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "InstrumentTrack.h"
+#include "Pattern.h"
+
+#include "Engine.h"
+#include "Song.h"
+
+class PatternTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void testFirstNoteFrom()
+	{
+		auto song = Engine::getSong();
+		InstrumentTrack* track =
+				dynamic_cast<InstrumentTrack*>(Track::create(Track::InstrumentTrack, song));
+		Pattern* p = dynamic_cast<Pattern*>(track->createTCO(0));
+
+		p->addNote(Note(MidiTime(0, 4), MidiTime(0, 8), 60), false);
+		p->addNote(Note(MidiTime(0, 4), MidiTime(0, 8), 64), false);
+		p->addNote(Note(MidiTime(0, 4), MidiTime(0, 16), 67), false);
+
+		const NoteVector & notes = p->notes();
+		QVERIFY(p->firstNoteFrom(0) == notes.begin());
+		QVERIFY(p->firstNoteFrom(8) == notes.begin());
+		QVERIFY(p->firstNoteFrom(9) == notes.begin() + 2);
+		QVERIFY(p->firstNoteFrom(16) == notes.begin() + 2);
+		QVERIFY(p->firstNoteFrom(17) == notes.end());
+
+		delete track;
+	}
+
+	// Looks up the notes starting at every tick of a dense pattern like
+	// InstrumentTrack::play() does, e.g. for an imported MIDI piano track
+	void benchmarkDensePattern()
+	{
+		auto song = Engine::getSong();
+		InstrumentTrack* track =
+				dynamic_cast<InstrumentTrack*>(Track::create(Track::InstrumentTrack, song));
+		Pattern* p = dynamic_cast<Pattern*>(track->createTCO(0));
+
+		const int numNotes = 10000;
+		for (int i = 0; i < numNotes; ++i)
+		{
+			// chords of four notes on every 1/32 step
+			p->addNote(Note(MidiTime(0, 3), MidiTime(i / 4 * 3), 48 + i % 4 * 5), false);
+		}
+		const int lastTick = p->notes().last()->pos();
+
+		int played = 0;
+		QBENCHMARK
+		{
+			played = 0;
+			for (int tick = 0; tick <= lastTick; ++tick)
+			{
+				NoteVector::ConstIterator it = p->firstNoteFrom(tick);
+				while (it != p->notes().end() && (*it)->pos() == tick)
+				{
+					++played;
+					++it;
+				}
+			}
+		}
+		QCOMPARE(played, numNotes);
+
+		delete track;
+	}
+} PatternTest;
+
+#include "PatternTest.moc"